@@ -17,6 +17,7 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>  // for snprintf
 #include <stdlib.h>
@@ -50,6 +51,16 @@ extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale)
     dec->squareDevn = cos(50 * (M_PI / 180));
     dec->sizeIdxExpected = DmtxSymbolShapeAuto;
     dec->edgeThresh = 10;
+    dec->lumaPlane = DmtxFalse;
+    dec->binarize = DmtxBinarizeNone;
+    dec->binarizeRadius = DmtxUndefined;
+    dec->edgeThreshAuto = DmtxFalse;
+    dec->edgeThreshPrev = DmtxUndefined;
+    dec->presenceLevel = 0;
+    dec->presenceState = DmtxUndefined;
+    dec->scanOrder = DmtxScanOrderRaster;
+    dec->moduleRetry = DmtxTrue;
+    dec->expected.sizeIdx = DmtxUndefined;
 
     dec->xMin = 0;
     dec->xMax = width - 1;
@@ -63,12 +74,218 @@ extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale)
         return NULL;
     }
 
+    dec->deadline.cancel = (volatile int *)calloc(1, sizeof(int));
+    if (dec->deadline.cancel == NULL) {
+        free(dec->cache);
+        free(dec);
+        return NULL;
+    }
+
     dec->image = img;
-    dec->grid = initScanGrid(dec);
+    resetScanOrder(dec);
 
     return dec;
 }
 
+/**
+ * \brief 让解码器处理下一帧图像
+ *
+ * 复用缓存与解码选项，并保留跨帧状态（如自动边缘阈值的滞回）。
+ * 新图像尺寸不同时重新分配缓存，并将 ROI 重置为整幅图像。
+ *
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeSetImage(DmtxDecode *dec, DmtxImage *img)
+{
+    int width, height;
+    unsigned char *cache;
+
+    if (dec == NULL || img == NULL) {
+        return DmtxFail;
+    }
+
+    width = dmtxImageGetProp(img, DmtxPropWidth) / dec->scale;
+    height = dmtxImageGetProp(img, DmtxPropHeight) / dec->scale;
+
+    /* 缓存即将清空，上一帧未完成的候选区域无需清理 */
+    dec->step.stage = DmtxScanStageSeed;
+    dec->step.work = 0;
+
+    if (width != dmtxDecodeGetProp(dec, DmtxPropWidth) || height != dmtxDecodeGetProp(dec, DmtxPropHeight)) {
+        cache = (unsigned char *)calloc((size_t)width * height, sizeof(unsigned char));
+        if (cache == NULL) {
+            return DmtxFail;
+        }
+        free(dec->cache);
+        dec->cache = cache;
+        free(dec->luma);
+        dec->luma = NULL;
+
+        dec->xMin = 0;
+        dec->xMax = width - 1;
+        dec->yMin = 0;
+        dec->yMax = height - 1;
+    } else {
+        memset(dec->cache, 0x00, (size_t)width * height);
+    }
+
+    dec->image = img;
+    dec->edgeThreshValid = DmtxFalse;
+    dec->presenceState = DmtxUndefined;
+    dec->deadline.expired = DmtxFalse;
+    dec->deadline.abandoned = DmtxFalse;
+    DmtxAtomicStore(dec->deadline.cancel, 0);
+
+    if (decodeUpdatePlane(dec) == DmtxFail) {
+        return DmtxFail;
+    }
+
+    resetScanOrder(dec);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 设置解码截止时间
+ *
+ * 截止时间作用于之后所有的寻找与解码调用（dmtxRegionFindNext、
+ * dmtxDecodeMatrixRegion 等），在寻边、拟合、尺寸判定和采样的循环内检查，
+ * 超时后这些调用尽快返回失败。时间基准与 dmtxTimeNow() 相同（单调时钟）。
+ * DmtxPropDeadlineExpired 随之清零。
+ *
+ * \param deadline 截止时间，NULL 表示取消限制
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeSetDeadline(DmtxDecode *dec, DmtxTime *deadline)
+{
+    if (dec == NULL) {
+        return DmtxFail;
+    }
+
+    decodeApplyDeadline(dec, deadline);
+    dec->deadline.abandoned = DmtxFalse;
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 替换生效的截止时间，不改变 DmtxPropDeadlineExpired
+ *
+ * dmtxRegionFindNext() 用它临时收紧并恢复截止时间，这样本次调用超时的结果
+ * 在恢复之后仍然可以读到。
+ */
+static void decodeApplyDeadline(DmtxDecode *dec, DmtxTime *deadline)
+{
+    if (deadline != NULL) {
+        dec->deadline.time = *deadline;
+        dec->deadline.active = DmtxTrue;
+    } else {
+        dec->deadline.active = DmtxFalse;
+    }
+    dec->deadline.expired = (DmtxAtomicLoad(dec->deadline.cancel) != 0) ? DmtxTrue : DmtxFalse;
+    dec->deadline.countdown = 0;
+}
+
+/**
+ * \brief 取消正在进行的解码
+ *
+ * 可以在其他线程中调用。正在运行的寻找或解码会在下一次检查时返回失败，
+ * 之后的调用也立即失败，直到 dmtxDecodeSetImage() 提交下一帧。
+ *
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeCancel(DmtxDecode *dec)
+{
+    if (dec == NULL) {
+        return DmtxFail;
+    }
+
+    DmtxAtomicStore(dec->deadline.cancel, 1);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 检查解码截止时间与取消标志
+ *
+ * 供各耗时阶段的循环内调用：取消标志每次都读，时钟在累计开销达到
+ * DmtxDeadlineStride 后才读一次。一旦超时或被取消，结果保持为真，直到重新
+ * 设置截止时间或换帧。返回真时调用者必须放弃当前阶段，因此同时记下
+ * DmtxPropDeadlineExpired。
+ *
+ * \param cost 本次检查代表的工作量，细粒度循环每步为 1，粗粒度循环传
+ *             DmtxDeadlineStride 以每次都读时钟
+ * \return DmtxTrue 表示应立即放弃当前阶段
+ */
+static DmtxBoolean decodeDeadlineExceeded(DmtxDecode *dec, int cost)
+{
+    DmtxDeadline *dl = &dec->deadline;
+
+    if (dl->expired == DmtxFalse) {
+        if (DmtxAtomicLoad(dl->cancel) == 0) {
+            if (dl->active == DmtxFalse || (dl->countdown -= cost) > 0) {
+                return DmtxFalse;
+            }
+            dl->countdown = DmtxDeadlineStride;
+
+            if (!dmtxTimeExceeded(dl->time)) {
+                return DmtxFalse;
+            }
+        }
+        dl->expired = DmtxTrue;
+    }
+
+    dl->abandoned = DmtxTrue;
+
+    return DmtxTrue;
+}
+
+/**
+ * \brief 让解码结果直接写入调用者的缓冲区
+ *
+ * 之后每个解码成功的消息依次占用缓冲区中紧接着的一段，msg->output 指向这一段，
+ * 销毁消息时不释放；剩余空间不足以容纳某个符号的输出时该符号解码失败。
+ * 重新调用本函数会从缓冲区开头重新使用。
+ *
+ * \param buf 输出缓冲区，NULL 表示恢复为每个消息自行分配
+ * \param size buf 的字节数
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeSetOutputBuffer(DmtxDecode *dec, unsigned char *buf, size_t size)
+{
+    if (dec == NULL || (buf == NULL && size != 0)) {
+        return DmtxFail;
+    }
+
+    dec->outputBuf = buf;
+    dec->outputBufSize = (buf != NULL) ? size : 0;
+    dec->outputBufUsed = 0;
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 设置解码输出回调
+ *
+ * dmtxDecodeMatrixRegion()、dmtxDecodeMosaicRegion() 和 dmtxDecodeAll() 每解码成功一个符号，
+ * 在返回前以完整的输出调用一次 sink；重试过程中的中间结果不会传给 sink。
+ *
+ * \param sink 输出回调，NULL 表示不回调
+ * \param userData 原样传给 sink
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeSetOutputSink(DmtxDecode *dec, DmtxOutputSink sink, void *userData)
+{
+    if (dec == NULL) {
+        return DmtxFail;
+    }
+
+    dec->outputSink = sink;
+    dec->outputSinkData = userData;
+
+    return DmtxPass;
+}
+
 /**
  * \brief Deinitialize decode struct
  * \param dec
@@ -84,6 +301,12 @@ extern DmtxPassFail dmtxDecodeDestroy(DmtxDecode **dec)
         free((*dec)->cache);
     }
 
+    free((*dec)->luma);
+    free((*dec)->scanCells);
+    resultCacheFree(&(*dec)->resultCache);
+    free((*dec)->expected.array);
+    free((void *)(*dec)->deadline.cancel);
+
     free(*dec);
 
     *dec = NULL;
@@ -122,6 +345,55 @@ extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
         case DmtxPropEdgeThresh:
             dec->edgeThresh = value;
             break;
+        case DmtxPropLumaPlane:
+            dec->lumaPlane = (value) ? DmtxTrue : DmtxFalse;
+            if (decodeUpdatePlane(dec) == DmtxFail) {
+                return DmtxFail;
+            }
+            break;
+        case DmtxPropBinarize:
+            if (value < DmtxBinarizeNone || value > DmtxBinarizeSauvola) {
+                return DmtxFail;
+            }
+            dec->binarize = value;
+            if (decodeUpdatePlane(dec) == DmtxFail) {
+                return DmtxFail;
+            }
+            break;
+        case DmtxPropBinarizeRadius:
+            if (value < 1 && value != DmtxUndefined) {
+                return DmtxFail;
+            }
+            dec->binarizeRadius = value;
+            if (dec->binarize != DmtxBinarizeNone && decodeUpdatePlane(dec) == DmtxFail) {
+                return DmtxFail;
+            }
+            break;
+        case DmtxPropEdgeThreshAuto:
+            dec->edgeThreshAuto = (value) ? DmtxTrue : DmtxFalse;
+            dec->edgeThreshValid = DmtxFalse;
+            break;
+        case DmtxPropPresenceLevel:
+            if (value < 0 || value > 100) {
+                return DmtxFail;
+            }
+            dec->presenceLevel = value;
+            dec->presenceState = DmtxUndefined;
+            break;
+        case DmtxPropScanOrder:
+            if (value < DmtxScanOrderRaster || value > DmtxScanOrderTiled) {
+                return DmtxFail;
+            }
+            dec->scanOrder = value;
+            break;
+        case DmtxPropModuleRetry:
+            dec->moduleRetry = (value) ? DmtxTrue : DmtxFalse;
+            break;
+        case DmtxPropResultCacheSize:
+            if (resultCacheSetCapacity(&dec->resultCache, value) == DmtxFail) {
+                return DmtxFail;
+            }
+            break;
         /* Min and Max values arrive unscaled */
         case DmtxPropXmin:
             dec->xMin = value / dec->scale;
@@ -152,7 +424,7 @@ extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
     }
 
     /* Reinitialize scangrid in case any inputs changed */
-    dec->grid = initScanGrid(dec);
+    resetScanOrder(dec);
 
     return DmtxPass;
 }
@@ -179,7 +451,36 @@ extern int dmtxDecodeGetProp(DmtxDecode *dec, int prop)
         case DmtxPropSymbolSize:
             return dec->sizeIdxExpected;
         case DmtxPropEdgeThresh:
+            if (dec->edgeThreshAuto == DmtxTrue && dec->edgeThreshValid == DmtxFalse) {
+                decodeSurveyEdgeThresh(dec);
+            }
             return dec->edgeThresh;
+        case DmtxPropEdgeThreshAuto:
+            return dec->edgeThreshAuto;
+        case DmtxPropPresenceLevel:
+            return dec->presenceLevel;
+        case DmtxPropScanOrder:
+            return dec->scanOrder;
+        case DmtxPropModuleRetry:
+            return dec->moduleRetry;
+        case DmtxPropResultCacheSize:
+            return dec->resultCache.capacity;
+        case DmtxPropResultCacheHits:
+            return (int)min(dec->resultCache.hits, INT_MAX);
+        case DmtxPropResultCacheMisses:
+            return (int)min(dec->resultCache.misses, INT_MAX);
+        case DmtxPropDeadlineExpired:
+            return dec->deadline.abandoned;
+        case DmtxPropScanProgress:
+            return getScanProgress(dec);
+        case DmtxPropScanWork:
+            return (int)min(dec->step.work, INT_MAX);
+        case DmtxPropLumaPlane:
+            return dec->lumaPlane;
+        case DmtxPropBinarize:
+            return dec->binarize;
+        case DmtxPropBinarizeRadius:
+            return dec->binarizeRadius;
         case DmtxPropXmin:
             return dec->xMin;
         case DmtxPropXmax:
@@ -233,8 +534,19 @@ extern unsigned char *dmtxDecodeGetCache(DmtxDecode *dec, int x, int y)
 extern DmtxPassFail dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int channel, OUT int *value)
 {
     int xUnscaled, yUnscaled;
+    int width, height;
     DmtxPassFail err;
 
+    if (channel == DmtxPlaneLuma) {
+        width = dec->image->width / dec->scale;
+        height = dec->image->height / dec->scale;
+        if (x < 0 || x >= width || y < 0 || y >= height) {
+            return DmtxFail;
+        }
+        *value = dec->luma[y * width + x];
+        return DmtxPass;
+    }
+
     xUnscaled = x * dec->scale;
     yUnscaled = y * dec->scale;
 
@@ -266,6 +578,19 @@ extern DmtxPassFail dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int c
     return err;
 }
 
+/**
+ * \brief 将按 8 位像素标定的强度阈值换算到指定通道的实际位深
+ *
+ * 梯度幅值与对比度阈值（例如 edgeThresh）均以 0~255 的像素值为基准，
+ * 对于高位深图像（如 12 位 Mono16）需要按比例放大，保证阈值语义不变。
+ */
+static int scaleIntensityThreshold(DmtxDecode *dec, int channel, int threshold)
+{
+    int bits = (channel == DmtxPlaneLuma) ? 8 : dec->image->bitsPerChannel[channel];
+
+    return (bits > 8) ? threshold << (bits - 8) : threshold;
+}
+
 /**
  * \brief Fill the region covered by the quadrilateral given by (p0,p1,p2,p3) in the cache.
  */
@@ -334,54 +659,130 @@ static void cacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, Dmt
  * \brief 解码拟合的二维码区域
  */
 extern DmtxMessage *dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix /*DmtxUndefined*/)
+{
+    DmtxMessage *msg;
+
+    msg = decodeMatrixRegion(dec, reg, fix, DmtxTrue);
+    if (msg != NULL) {
+        decodeDeliverOutput(dec, msg);
+    }
+
+    return msg;
+}
+
+/**
+ * \brief dmtxDecodeMatrixRegion() 的实现，不调用输出回调
+ *
+ * \param useOutputBuffer 是否把输出写入 dmtxDecodeSetOutputBuffer() 提供的缓冲区
+ * \return 解码成功的消息，失败时返回 NULL
+ */
+static DmtxMessage *decodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxBoolean useOutputBuffer)
 {
     // dmtxLogDebug("libdmtx::dmtxDecodeMatrixRegion()");
     DmtxMessage *msg;
+    DmtxModuleSamples samples;
+
+    if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+        return NULL;
+    }
 
-    msg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMatrix);
+    if (useOutputBuffer == DmtxTrue && dec->outputBuf != NULL) {
+        msg = messageCreate(reg->sizeIdx, DmtxFormatMatrix, dec->outputBuf + dec->outputBufUsed,
+                            dec->outputBufSize - dec->outputBufUsed);
+    } else {
+        msg = messageCreate(reg->sizeIdx, DmtxFormatMatrix, NULL, 0);
+    }
     if (msg == NULL) {
         return NULL;
     }
 
-    if (populateArrayFromMatrix(dec, reg, msg) != DmtxPass) {
+    /* 每个模块只采样一次，之后所有判定策略都从缓存的颜色进行 */
+    if (sampleModuleColors(dec, reg, &samples) != DmtxPass) {
         dmtxMessageDestroy(&msg);
         return NULL;
     }
 
     msg->fnc1 = dec->fnc1;
 
-    {
-        DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
-        DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
+    cacheFillRegion(dec, reg);
+
+    if (decodeModuleSamples(dec, reg, &samples, fix, msg) == DmtxFail) {
+        dmtxMessageDestroy(&msg);
+    }
+    free(samples.color);
+
+    return msg;
+}
+
+/**
+ * \brief 将区域（外扩 0.1 个符号宽度）标记为已扫描，之后的寻找不再进入
+ */
+static void cacheFillRegion(DmtxDecode *dec, DmtxRegion *reg)
+{
+    DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
+    DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
+
+    topLeft.x = bottomLeft.x = topLeft.y = topRight.y = -0.1;
+    topRight.x = bottomRight.x = bottomLeft.y = bottomRight.y = 1.1;
+
+    dmtxMatrix3VMultiplyBy(&topLeft, reg->fit2raw);
+    dmtxMatrix3VMultiplyBy(&topRight, reg->fit2raw);
+    dmtxMatrix3VMultiplyBy(&bottomLeft, reg->fit2raw);
+    dmtxMatrix3VMultiplyBy(&bottomRight, reg->fit2raw);
+
+    pxTopLeft.x = (int)(0.5 + topLeft.x);
+    pxTopLeft.y = (int)(0.5 + topLeft.y);
+    pxBottomLeft.x = (int)(0.5 + bottomLeft.x);
+    pxBottomLeft.y = (int)(0.5 + bottomLeft.y);
+    pxTopRight.x = (int)(0.5 + topRight.x);
+    pxTopRight.y = (int)(0.5 + topRight.y);
+    pxBottomRight.x = (int)(0.5 + bottomRight.x);
+    pxBottomRight.y = (int)(0.5 + bottomRight.y);
+
+    cacheFillQuad(dec, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
+}
+
+/**
+ * \brief 从缓存的模块颜色解码一个颜色平面
+ *
+ * 默认策略失败后按 DmtxModuleThresh 的顺序逐个重试，不再读取图像。
+ *
+ * \param[in] samples 该平面已缓存的模块颜色
+ * \param[in,out] msg 解码消息，成功时输出写入 msg->output
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail decodeModuleSamples(DmtxDecode *dec, DmtxRegion *reg, const DmtxModuleSamples *samples, int fix,
+                                        INOUT DmtxMessage *msg)
+{
+    int policy, policyCount;
+
+    policyCount = (dec->moduleRetry == DmtxTrue) ? DmtxModuleThreshCount : 1;
 
-        topLeft.x = bottomLeft.x = topLeft.y = topRight.y = -0.1;
-        topRight.x = bottomRight.x = bottomLeft.y = bottomRight.y = 1.1;
+    for (policy = DmtxModuleThreshTally; policy < policyCount; policy++) {
+        if (policy != DmtxModuleThreshTally && decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+            break;
+        }
 
-        dmtxMatrix3VMultiplyBy(&topLeft, reg->fit2raw);
-        dmtxMatrix3VMultiplyBy(&topRight, reg->fit2raw);
-        dmtxMatrix3VMultiplyBy(&bottomLeft, reg->fit2raw);
-        dmtxMatrix3VMultiplyBy(&bottomRight, reg->fit2raw);
+        populateArrayFromMatrix(reg, samples, policy, msg);
 
-        pxTopLeft.x = (int)(0.5 + topLeft.x);
-        pxTopLeft.y = (int)(0.5 + topLeft.y);
-        pxBottomLeft.x = (int)(0.5 + bottomLeft.x);
-        pxBottomLeft.y = (int)(0.5 + bottomLeft.y);
-        pxTopRight.x = (int)(0.5 + topRight.x);
-        pxTopRight.y = (int)(0.5 + topRight.y);
-        pxBottomRight.x = (int)(0.5 + bottomRight.x);
-        pxBottomRight.y = (int)(0.5 + bottomRight.y);
+        if (decodeCachedArray(dec, reg->sizeIdx, msg, fix) == DmtxPass) {
+            return DmtxPass;
+        }
 
-        cacheFillQuad(dec, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
+        /* 清除上一次尝试留下的输出，之后的字节从未写过 */
+        memset(msg->output, 0x00, msg->outputIdx);
+        msg->outputIdx = 0;
+        msg->padCount = 0;
     }
 
-    return dmtxDecodePopulatedArray(reg->sizeIdx, msg, fix);
+    return DmtxFail;
 }
 
 /**
  * \brief 从DataMatrix数据区二进制矩阵解码，并将结果写入msg->output
  *
  * \param[in] sizeIdx 数据矩阵的尺寸索引，对应不同的符号大小。
- * \param[in,out] msg 已经填充模块状态的解码消息结构体实例。
+ * \param[in,out] msg 已经填充模块状态的解码消息结构体实例，标记了 DmtxModuleUnsure 的模块所在码字在纠错失败时作为擦除位置。
  * \param[in] fix 纠错级别指示符，指定解码时使用的错误纠正能力, 默认DmtxUndefined
  *
  * \note 使用此函数时，应将msg变量重新赋值为该函数的返回值，因为当返回NULL时，表示msg已被释放，不应再被使用。
@@ -408,22 +809,92 @@ DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, INOUT DmtxMessage *msg, int f
      *
      */
 
-    /* 根据bit数组(array)拼接为code */
-    modulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
-
-    if (rsDecode(msg->code, sizeIdx, fix) == DmtxFail) {
+    if (decodePopulatedArray(sizeIdx, msg, fix) == DmtxFail) {
         dmtxMessageDestroy(&msg);
         msg = NULL;
         return NULL;
     }
 
+    return msg;
+}
+
+/**
+ * \brief dmtxDecodePopulatedArray() 的实现，失败时不释放 msg，以便换用其他判定结果重试
+ *
+ * \param[in] sizeIdx 数据矩阵的尺寸索引
+ * \param[in,out] msg 已经填充模块状态的解码消息
+ * \param[in] fix 纠错级别指示符
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail decodePopulatedArray(int sizeIdx, INOUT DmtxMessage *msg, int fix)
+{
+    DmtxPassFail passFail;
+    unsigned char *erasures;
+
+    /* 根据bit数组(array)拼接为code */
+    modulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
+
+    if (rsDecode(msg->code, sizeIdx, fix, NULL) == DmtxFail) {
+        /* 含有不确定模块的码字作为擦除位置，纠错能力从 2e <= d-1 提高到 2e + s < d-1 */
+        erasures = getCodewordErasures(msg, sizeIdx);
+        if (erasures == NULL) {
+            return DmtxFail;
+        }
+
+        passFail = rsDecode(msg->code, sizeIdx, fix, erasures);
+        free(erasures);
+        if (passFail == DmtxFail) {
+            return DmtxFail;
+        }
+    }
+
     if (decodeDataStream(msg, sizeIdx, NULL) == DmtxFail) {
-        dmtxMessageDestroy(&msg);
-        msg = NULL;
+        return DmtxFail;
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 标记包含 DmtxModuleUnsure 模块的码字
+ *
+ * 用一个只把不确定模块置为 1 的数组重新执行码字排布，得到的“码字”非 0 即表示该码字含有不确定模块。
+ *
+ * \param[in] msg 已经填充模块状态的解码消息
+ * \param[in] sizeIdx 数据矩阵的尺寸索引
+ * \return 与 msg->code 等长的数组，由调用者释放；没有不确定模块或内存不足时返回 NULL
+ */
+static unsigned char *getCodewordErasures(DmtxMessage *msg, int sizeIdx)
+{
+    size_t i;
+    int unsureCount;
+    unsigned char *modules, *erasures;
+
+    modules = (unsigned char *)malloc(msg->arraySize);
+    if (modules == NULL) {
         return NULL;
     }
 
-    return msg;
+    unsureCount = 0;
+    for (i = 0; i < msg->arraySize; i++) {
+        modules[i] = DmtxModuleAssigned;
+        if (msg->array[i] & DmtxModuleUnsure) {
+            modules[i] |= DmtxModuleOnRGB;
+            unsureCount++;
+        }
+    }
+
+    erasures = NULL;
+    if (unsureCount > 0) {
+        erasures = (unsigned char *)calloc(msg->codeSize, sizeof(unsigned char));
+        if (erasures != NULL) {
+            modulePlacementEcc200(modules, erasures, sizeIdx, DmtxModuleOnRGB);
+        }
+    }
+
+    free(modules);
+
+    return erasures;
 }
 
 /**
@@ -435,11 +906,9 @@ DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, INOUT DmtxMessage *msg, int f
  */
 extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 {
-    int offset;
-    int colorPlane;
-    DmtxMessage *oMsg, *rMsg, *gMsg, *bMsg;
-
-    colorPlane = reg->flowBegin.plane;
+    int plane;
+    DmtxMessage *oMsg, *pMsg;
+    DmtxModuleSamples samples[3];
 
     /**
      * Consider performing a color cube fit here to identify exact RGB of
@@ -454,44 +923,180 @@ extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int
      * identify value. An additional method will be required to get actual
      * RGB instead of just a plane in 3D. */
 
-    reg->flowBegin.plane = 0; /* kind of a hack */
-    rMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
-
-    reg->flowBegin.plane = 1; /* kind of a hack */
-    gMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
+    if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+        return NULL;
+    }
 
-    reg->flowBegin.plane = 2; /* kind of a hack */
-    bMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
+    if (dec->outputBuf != NULL) {
+        oMsg = messageCreate(reg->sizeIdx, DmtxFormatMosaic, dec->outputBuf + dec->outputBufUsed,
+                             dec->outputBufSize - dec->outputBufUsed);
+    } else {
+        oMsg = messageCreate(reg->sizeIdx, DmtxFormatMosaic, NULL, 0);
+    }
 
-    reg->flowBegin.plane = colorPlane;
+    if (oMsg == NULL) {
+        return NULL;
+    }
 
-    oMsg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMosaic);
+    /* 三个平面依次复用同一个单平面消息解码，输出直接接在 oMsg->output 已有内容之后 */
+    pMsg = messageCreate(reg->sizeIdx, DmtxFormatMatrix, oMsg->output, oMsg->outputSize);
+    if (pMsg == NULL) {
+        dmtxMessageDestroy(&oMsg);
+        return NULL;
+    }
 
-    if (oMsg == NULL || rMsg == NULL || gMsg == NULL || bMsg == NULL) {
+    /* 每个模块只采样一次，同时读取三个颜色平面 */
+    if (sampleModuleColorPlanes(dec, reg, samples) != DmtxPass) {
         dmtxMessageDestroy(&oMsg);
-        dmtxMessageDestroy(&rMsg);
-        dmtxMessageDestroy(&gMsg);
-        dmtxMessageDestroy(&bMsg);
+        dmtxMessageDestroy(&pMsg);
         return NULL;
     }
 
-    offset = 0;
-    memcpy(oMsg->output + offset, rMsg->output, rMsg->outputIdx);
-    offset += rMsg->outputIdx;
-    memcpy(oMsg->output + offset, gMsg->output, gMsg->outputIdx);
-    offset += gMsg->outputIdx;
-    memcpy(oMsg->output + offset, bMsg->output, bMsg->outputIdx);
-    offset += bMsg->outputIdx;
+    pMsg->fnc1 = dec->fnc1;
+
+    cacheFillRegion(dec, reg);
+
+    for (plane = 0; plane < 3; plane++) {
+        pMsg->output = oMsg->output + oMsg->outputIdx;
+        pMsg->outputSize = oMsg->outputSize - (size_t)oMsg->outputIdx;
+        pMsg->outputIdx = 0;
+        pMsg->padCount = 0;
 
-    oMsg->outputIdx = offset;
+        if (decodeModuleSamples(dec, reg, &samples[plane], fix, pMsg) == DmtxFail) {
+            free(samples[0].color);
+            dmtxMessageDestroy(&oMsg);
+            dmtxMessageDestroy(&pMsg);
+            return NULL;
+        }
+
+        oMsg->outputIdx += pMsg->outputIdx;
+    }
 
-    dmtxMessageDestroy(&rMsg);
-    dmtxMessageDestroy(&gMsg);
-    dmtxMessageDestroy(&bMsg);
+    free(samples[0].color);
+    dmtxMessageDestroy(&pMsg);
+
+    decodeDeliverOutput(dec, oMsg);
 
     return oMsg;
 }
 
+/**
+ * \brief 交付解码成功的消息：在调用者的输出缓冲区中占用其输出，并调用输出回调
+ */
+static void decodeDeliverOutput(DmtxDecode *dec, DmtxMessage *msg)
+{
+    if (msg->outputExternal == DmtxTrue) {
+        dec->outputBufUsed += (size_t)msg->outputIdx;
+    }
+
+    if (dec->outputSink != NULL) {
+        (*dec->outputSink)(dec->outputSinkData, msg->output, (size_t)msg->outputIdx);
+    }
+}
+
+/**
+ * \brief 找出并解码图像中的所有符号
+ *
+ * 每找到一个区域立即解码，解码时该区域被标记为已扫描，后续扫描不会再次进入。
+ * 从解码器当前的扫描进度继续，受 dmtxDecodeSetDeadline() 的截止时间约束。
+ * results 的原有内容会被覆盖，重复使用前先调用 dmtxDecodeResultsFree()。
+ *
+ * \param dec 解码上下文
+ * \param opts 选项，NULL 表示全部取默认值（找出所有符号）
+ * \param results 输出解码成功的符号
+ * \return DmtxPass: 达到期望数量（或未设置期望数量）| DmtxFail
+ */
+extern DmtxPassFail dmtxDecodeAll(DmtxDecode *dec, DmtxDecodeAllOpts *opts, OUT DmtxDecodeResults *results)
+{
+    int maxCount, expectedCount, fix;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    memset(results, 0x00, sizeof(DmtxDecodeResults));
+
+    expectedCount = (opts != NULL) ? opts->expectedCount : DmtxUndefined;
+    maxCount = (opts != NULL && opts->maxCount != DmtxUndefined) ? opts->maxCount : expectedCount;
+    fix = (opts != NULL) ? opts->fix : DmtxUndefined;
+
+    while (maxCount == DmtxUndefined || results->count < maxCount) {
+        reg = dmtxRegionFindNext(dec, NULL);
+        if (reg == NULL) {
+            break;
+        }
+
+        msg = dmtxDecodeMatrixRegion(dec, reg, fix);
+        if (msg == NULL) {
+            dmtxRegionDestroy(&reg);
+            continue;
+        }
+
+        if (decodeResultsAppend(dec, results, reg, msg) == DmtxFail) {
+            dmtxMessageDestroy(&msg);
+            dmtxRegionDestroy(&reg);
+            return DmtxFail;
+        }
+
+        dmtxRegionDestroy(&reg);
+    }
+
+    if (expectedCount != DmtxUndefined && results->count < expectedCount) {
+        return DmtxFail;
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 把解码成功的符号追加到结果列表，msg 归结果列表所有
+ * \return DmtxPass | DmtxFail（内存不足，msg 仍归调用者所有）
+ */
+static DmtxPassFail decodeResultsAppend(DmtxDecode *dec, INOUT DmtxDecodeResults *results, DmtxRegion *reg,
+                                        DmtxMessage *msg)
+{
+    int i;
+    DmtxDecodeResult *result;
+
+    if (results->count == results->capacity) {
+        result = (DmtxDecodeResult *)realloc(results->result, sizeof(DmtxDecodeResult) * (results->capacity * 2 + 4));
+        if (result == NULL) {
+            return DmtxFail;
+        }
+        results->result = result;
+        results->capacity = results->capacity * 2 + 4;
+    }
+
+    result = &results->result[results->count++];
+    result->message = msg;
+    result->region = *reg;
+    for (i = 0; i < 4; i++) {
+        result->corners[i].x = (i == 1 || i == 2) ? 1.0 : 0.0;
+        result->corners[i].y = (i >= 2) ? 1.0 : 0.0;
+        dmtxMatrix3VMultiplyBy(&result->corners[i], reg->fit2raw);
+        dmtxVector2ScaleBy(&result->corners[i], (double)dec->scale);
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 释放 dmtxDecodeAll() 的结果
+ */
+extern void dmtxDecodeResultsFree(DmtxDecodeResults *results)
+{
+    int i;
+
+    if (results == NULL) {
+        return;
+    }
+
+    for (i = 0; i < results->count; i++) {
+        dmtxMessageDestroy(&results->result[i].message);
+    }
+    free(results->result);
+
+    memset(results, 0x00, sizeof(DmtxDecodeResults));
+}
+
 /**
  *
  *
@@ -501,7 +1106,7 @@ extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalByte
     int i, row, col;
     int width, height;
     int widthDigits, heightDigits;
-    int count, channelCount;
+    int count, channelCount, plane;
     int rgb[3];
     double shade;
     unsigned char *pnm, *output, *cache;
@@ -556,12 +1161,11 @@ extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalByte
             } else {
                 shade = (*cache & 0x80) ? 0.0 : 0.7;
                 for (i = 0; i < 3; i++) {
-                    if (i < channelCount) {
-                        dmtxDecodeGetPixelValue(dec, col, row, i, &rgb[i]);
-                    } else {
-                        dmtxDecodeGetPixelValue(dec, col, row, 0, &rgb[i]);
-                    }
+                    plane = (i < channelCount) ? i : 0;
+                    dmtxDecodeGetPixelValue(dec, col, row, plane, &rgb[i]);
 
+                    /* Reduce high bit depth samples to 8 bits for display */
+                    rgb[i] = (rgb[i] * 255) / scaleIntensityThreshold(dec, plane, 255);
                     rgb[i] += (int)(shade * (double)(255 - rgb[i]) + 0.5);
                     if (rgb[i] > 255) {
                         rgb[i] = 255;
@@ -584,17 +1188,18 @@ extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalByte
  * 此函数遍历数据矩阵区域中的模块，根据模块颜色跳变的阈值来累加计数器（tally），
  * 以此推断模块的明暗状态（代表二进制值）。它支持向上、向下、向左、向右四个方向的遍历。
  *
- * \param[in] dec 解码上下文，包含解码配置和辅助函数
  * \param[in] reg 当前处理的数据矩阵区域信息
+ * \param[in] samples 已缓存的模块颜色
  * \param[in,out] tally 二维数组，用于累加模块状态的计数
  * \param[in] xOrigin 起始位置X坐标
  * \param[in] yOrigin 起始位置Y坐标
  * \param[in] mapWidth 单区块码元宽度
  * \param[in] mapHeight 单区块码元高度
  * \param[in] dir 遍历方向
+ * \param[in] jumpRatio 跳变阈值占对比度的比例，默认 0.4
  */
-static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[][24], int xOrigin, int yOrigin,
-                             int mapWidth, int mapHeight, DmtxDirection dir)
+static void tallyModuleJumps(DmtxRegion *reg, const DmtxModuleSamples *samples, INOUT int tally[][24], int xOrigin,
+                             int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir, double jumpRatio)
 {
     int extent, weight;
     int travelStep;
@@ -635,7 +1240,7 @@ static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[]
     }
 
     darkOnLight = (int)(reg->offColor > reg->onColor);
-    jumpThreshold = abs((int)(0.4 * (reg->offColor - reg->onColor) + 0.5));
+    jumpThreshold = abs((int)(jumpRatio * (reg->offColor - reg->onColor) + 0.5));
 
     DmtxAssert(jumpThreshold >= 0);
 
@@ -644,7 +1249,7 @@ static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[]
          * border pattern */
 
         *travel = travelStart;
-        color = readModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
+        color = samples->color[symbolRow * samples->cols + symbolCol];
         tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
         statusModule = (travelStep == 1 || (*line & 0x01) == 0) ? DmtxModuleOnRGB : DmtxModuleOff;
@@ -658,7 +1263,7 @@ static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[]
             /* For normal data-bearing modules capture color and decide module status based on comparison to previous
              * "known" module */
 
-            color = readModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
+            color = samples->color[symbolRow * samples->cols + symbolCol];
             tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
             /* 和上一次的结果数据对比，如果在加减Threshold后满足条件，那么认为确实有一次跳变 */
@@ -691,18 +1296,222 @@ static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[]
     }
 }
 
+/**
+ * \brief 读取区域内所有模块的颜色并缓存，供各判定策略使用
+ *
+ * \param[in] dec 解码上下文
+ * \param[in] reg 当前处理的数据矩阵区域信息
+ * \param[out] samples 模块颜色，成功时由调用者释放 samples->color
+ * \return DmtxPass | DmtxFail: 内存不足或截止时间已过
+ */
+static DmtxPassFail sampleModuleColors(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxModuleSamples *samples)
+{
+    int symbolRow, symbolCol;
+    int *color;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(reg->sizeIdx);
+
+    samples->rows = info->symbolRows;
+    samples->cols = info->symbolCols;
+    samples->color = (int *)malloc(sizeof(int) * samples->rows * samples->cols);
+    if (samples->color == NULL) {
+        return DmtxFail;
+    }
+
+    color = samples->color;
+    for (symbolRow = 0; symbolRow < samples->rows; symbolRow++) {
+        if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+            free(samples->color);
+            samples->color = NULL;
+            return DmtxFail;
+        }
+
+        for (symbolCol = 0; symbolCol < samples->cols; symbolCol++) {
+            *(color++) = readModuleColor(dec, reg, symbolRow, symbolCol, info, reg->flowBegin.plane);
+        }
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 一次遍历缓存 Data Mosaic 区域内每个模块在三个颜色平面上的颜色
+ *
+ * 三个平面共用一块内存，samples[0].color 为其起始地址，由调用者释放。
+ *
+ * \param[in] dec 解码上下文
+ * \param[in] reg 已确定尺寸的区域
+ * \param[out] samples 依次为 0、1、2 平面的模块颜色
+ * \return DmtxPass | DmtxFail（内存不足或超时）
+ */
+static DmtxPassFail sampleModuleColorPlanes(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxModuleSamples samples[3])
+{
+    int plane, idx, count;
+    int symbolRow, symbolCol;
+    int colors[3];
+    int *color;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(reg->sizeIdx);
+
+    count = info->symbolRows * info->symbolCols;
+    color = (int *)malloc(sizeof(int) * 3 * count);
+    if (color == NULL) {
+        return DmtxFail;
+    }
+
+    for (plane = 0; plane < 3; plane++) {
+        samples[plane].rows = info->symbolRows;
+        samples[plane].cols = info->symbolCols;
+        samples[plane].color = color + plane * count;
+    }
+
+    idx = 0;
+    for (symbolRow = 0; symbolRow < info->symbolRows; symbolRow++) {
+        if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+            free(color);
+            samples[0].color = samples[1].color = samples[2].color = NULL;
+            return DmtxFail;
+        }
+
+        for (symbolCol = 0; symbolCol < info->symbolCols; symbolCol++, idx++) {
+            readModuleColorPlanes(dec, reg, symbolRow, symbolCol, info, colors);
+            samples[0].color[idx] = colors[0];
+            samples[1].color[idx] = colors[1];
+            samples[2].color[idx] = colors[2];
+        }
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 按颜色升序比较
+ */
+static int compareModuleColors(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * \brief 对所有数据模块的颜色求 Otsu 阈值
+ *
+ * 颜色不大于阈值的模块属于暗类，其余属于亮类。模块数量最多为 144×144，直接排序后求类间方差最大的分割点。
+ *
+ * \param[in] reg 当前处理的数据矩阵区域信息
+ * \param[in] samples 已缓存的模块颜色
+ * \return 阈值，内存不足时返回 onColor 与 offColor 的中点
+ */
+static int getModuleOtsuThreshold(DmtxRegion *reg, const DmtxModuleSamples *samples)
+{
+    int i, count;
+    int mapWidth, mapHeight;
+    int symbolRow, symbolCol;
+    int threshold;
+    int *sorted;
+    double sumTotal, sumLow, meanLow, meanHigh;
+    double variance, varianceBest;
+
+    mapWidth = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionCols, reg->sizeIdx);
+    mapHeight = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionRows, reg->sizeIdx);
+
+    threshold = (reg->onColor + reg->offColor) / 2;
+
+    sorted = (int *)malloc(sizeof(int) * samples->rows * samples->cols);
+    if (sorted == NULL) {
+        return threshold;
+    }
+
+    /* 只统计数据模块，跳过寻边区和对齐图形 */
+    count = 0;
+    sumTotal = 0.0;
+    for (symbolRow = 0; symbolRow < samples->rows; symbolRow++) {
+        if (symbolRow % (mapHeight + 2) == 0 || symbolRow % (mapHeight + 2) == mapHeight + 1) {
+            continue;
+        }
+        for (symbolCol = 0; symbolCol < samples->cols; symbolCol++) {
+            if (symbolCol % (mapWidth + 2) == 0 || symbolCol % (mapWidth + 2) == mapWidth + 1) {
+                continue;
+            }
+            sorted[count] = samples->color[symbolRow * samples->cols + symbolCol];
+            sumTotal += sorted[count];
+            count++;
+        }
+    }
+
+    qsort(sorted, count, sizeof(int), compareModuleColors);
+
+    sumLow = 0.0;
+    varianceBest = -1.0;
+    for (i = 1; i < count; i++) {
+        sumLow += sorted[i - 1];
+        if (sorted[i] == sorted[i - 1]) {
+            continue;
+        }
+
+        meanLow = sumLow / i;
+        meanHigh = (sumTotal - sumLow) / (count - i);
+        variance = (double)i * (count - i) * (meanHigh - meanLow) * (meanHigh - meanLow);
+        if (variance > varianceBest) {
+            varianceBest = variance;
+            threshold = (sorted[i - 1] + sorted[i]) / 2;
+        }
+    }
+
+    free(sorted);
+
+    return threshold;
+}
+
+/**
+ * \brief 取模块 5x5 邻域（含寻边区和对齐图形）颜色的中值作为局部阈值
+ *
+ * \param[in] reg 当前处理的数据矩阵区域信息
+ * \param[in] samples 已缓存的模块颜色
+ * \param[in] symbolRow 二维码坐标系下的行坐标
+ * \param[in] symbolCol 二维码坐标系下的列坐标
+ * \param[in] globalThreshold 邻域对比度不足一半时（邻域内几乎全亮或全暗）使用的阈值
+ * \return 阈值
+ */
+static int getModuleLocalThreshold(DmtxRegion *reg, const DmtxModuleSamples *samples, int symbolRow, int symbolCol,
+                                   int globalThreshold)
+{
+    int row, col;
+    int rowBeg, rowEnd, colBeg, colEnd;
+    int color, colorMin, colorMax;
+
+    rowBeg = max(symbolRow - 2, 0);
+    rowEnd = min(symbolRow + 2, samples->rows - 1);
+    colBeg = max(symbolCol - 2, 0);
+    colEnd = min(symbolCol + 2, samples->cols - 1);
+
+    colorMin = colorMax = samples->color[symbolRow * samples->cols + symbolCol];
+    for (row = rowBeg; row <= rowEnd; row++) {
+        for (col = colBeg; col <= colEnd; col++) {
+            color = samples->color[row * samples->cols + col];
+            colorMin = min(colorMin, color);
+            colorMax = max(colorMax, color);
+        }
+    }
+
+    if (2 * (colorMax - colorMin) < abs(reg->offColor - reg->onColor)) {
+        return globalThreshold;
+    }
+
+    return (colorMin + colorMax) / 2;
+}
+
 /**
  * \brief 根据模块颜色填充数组以确定码字值。
  *
- * 此函数遍历数据矩阵的各个区域，统计每个模块的颜色跳变，以推断出每个模块是黑（代表1）还是白（代表0）。
- * 这一过程对于解码数据矩阵中的信息至关重要。函数首先计算整个符号的区域数量、区域尺寸等关键属性，
- * 然后根据模块颜色对比和累加的“跳跃”计数来确定每个模块的状态，最后更新消息数组以反映解码结果。
+ * 此函数遍历数据矩阵的各个区域，按指定的判定策略推断每个模块是黑（代表1）还是白（代表0）。
+ * 默认策略统计每个模块的颜色跳变，以累加的“跳跃”计数来确定模块状态；其余策略用于纠错失败后的重试，
+ * 全部基于 sampleModuleColors() 缓存的颜色，不再读取图像。
  *
- * \param[in] dec 解码上下文，包含解码配置和辅助函数。
  * \param[in] reg 当前处理的数据矩阵区域信息。
- * \param[out] msg 根据图像更新array
+ * \param[in] samples 已缓存的模块颜色。
+ * \param[in] policy 判定策略 \ref DmtxModuleThresh
+ * \param[out] msg 根据模块颜色更新array
  */
-static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxMessage *msg)
+static void populateArrayFromMatrix(DmtxRegion *reg, const DmtxModuleSamples *samples, int policy,
+                                    OUT DmtxMessage *msg)
 {
     // dmtxLogDebug("libdmtx::populateArrayFromMatrix()");
     int weightFactor;
@@ -712,10 +1521,11 @@ static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OU
     int xOrigin, yOrigin;
     int mapCol, mapRow;
     int colTmp, rowTmp, idx;
+    int darkOnLight;
+    int color, threshold, globalThreshold, isOn;
+    double jumpRatio, confidence;
     int tally[24][24]; /* 单个区块最大不会超过24×24，直接以最大分配 */
 
-    /* memset(msg->array, 0x00, msg->arraySize); */
-
     /* 获取条形码中两个方向的区块数。当码元数目超过26×26（对于数据，码元数目超过24×24）时，它会划分为区块 */
     xRegionTotal = dmtxGetSymbolAttribute(DmtxSymAttribHorizDataRegions, reg->sizeIdx);
     yRegionTotal = dmtxGetSymbolAttribute(DmtxSymAttribVertDataRegions, reg->sizeIdx);
@@ -727,25 +1537,19 @@ static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OU
     weightFactor = 2 * (mapHeight + mapWidth + 2);
     DmtxAssert(weightFactor > 0);
 
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::reg->sizeIdx: %d", reg->sizeIdx);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::reg->flowBegin.plane: %d", reg->flowBegin.plane);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::reg->onColor: %d", reg->onColor);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::reg->offColor: %d", reg->offColor);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::xRegionTotal: %d", xRegionTotal);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::yRegionTotal: %d", yRegionTotal);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::mapWidth: %d", mapWidth);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::mapHeight: %d", mapHeight);
-    // dmtxLogInfo("libdmtx::populateArrayFromMatrix::weightFactor: %d", weightFactor);
-    // reg->fit2raw[1][0] = 0;
-    // reg->fit2raw[0][1] = 0;
-    // reg->fit2raw[0][2] = 0;
-    // reg->fit2raw[2][2] = 1;
-    // reg->fit2raw[1][2] = 0;
-    // reg->fit2raw[2][0] = 10;  // translation
-    // reg->fit2raw[2][1] = 10;  // translation
-    // reg->fit2raw[0][0] = 60;  // scale
-    // reg->fit2raw[1][1] = 60;  // scale
-    // dmtxMatrix3Print(reg->fit2raw);
+    darkOnLight = (int)(reg->offColor > reg->onColor);
+
+    globalThreshold = 0;
+    if (policy == DmtxModuleThreshOtsu || policy == DmtxModuleThreshLocal) {
+        globalThreshold = getModuleOtsuThreshold(reg, samples);
+    }
+
+    jumpRatio = 0.4;
+    if (policy == DmtxModuleThreshTallyLoose) {
+        jumpRatio = 0.25;
+    } else if (policy == DmtxModuleThreshTallyStrict) {
+        jumpRatio = 0.55;
+    }
 
     /* 每个方向上每个区域的计数模块变化 Tally module changes for each region in each direction */
     for (yRegionCount = 0; yRegionCount < yRegionTotal; yRegionCount++) {
@@ -756,8 +1560,6 @@ static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OU
             /* 在符号坐标中映射区域原点的X位置 X location of mapping region origin in symbol coordinates */
             xOrigin = xRegionCount * (mapWidth + 2) + 1;
 
-            // dmtxLogInfo("libdmtx::populateArrayFromMatrix::xOrigin: %d", xOrigin);
-
             /**
              * 从四个方向对图像满足跳变的点求和
              *
@@ -777,37 +1579,44 @@ static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OU
              * |14      |
              * |   14 14|
              */
-            memset(tally, 0x00, sizeof(int) * 24 * 24);
-            tallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp);
-            tallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft);
-            tallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown);
-            tallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight);
+            if (policy != DmtxModuleThreshOtsu && policy != DmtxModuleThreshLocal) {
+                memset(tally, 0x00, sizeof(int) * 24 * 24);
+                tallyModuleJumps(reg, samples, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp, jumpRatio);
+                tallyModuleJumps(reg, samples, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft, jumpRatio);
+                tallyModuleJumps(reg, samples, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown, jumpRatio);
+                tallyModuleJumps(reg, samples, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight, jumpRatio);
+            }
 
-            /* 根据记录内容(tally)更新array的内容 */
+            /* 根据记录内容(tally)或模块颜色更新array的内容 */
             for (mapRow = 0; mapRow < mapHeight; mapRow++) {
-                // for(mapRow = mapHeight-1; mapRow >= 0; mapRow--) {
                 for (mapCol = 0; mapCol < mapWidth; mapCol++) {
                     rowTmp = (yRegionCount * mapHeight) + mapRow;
                     rowTmp = yRegionTotal * mapHeight - rowTmp - 1;
                     colTmp = (xRegionCount * mapWidth) + mapCol;
                     idx = (rowTmp * xRegionTotal * mapWidth) + colTmp;
 
-                    // printf("%c ", tally[mapRow][mapCol] == DmtxModuleOff ? '0' : '1');
-                    if (tally[mapRow][mapCol] / (double)weightFactor >= 0.5) {
-                        msg->array[idx] = DmtxModuleOnRGB;
-                        // printf("1 ");
+                    if (policy == DmtxModuleThreshOtsu || policy == DmtxModuleThreshLocal) {
+                        color = samples->color[(yOrigin + mapRow) * samples->cols + xOrigin + mapCol];
+                        threshold = (policy == DmtxModuleThreshLocal)
+                                        ? getModuleLocalThreshold(reg, samples, yOrigin + mapRow, xOrigin + mapCol,
+                                                                  globalThreshold)
+                                        : globalThreshold;
+                        isOn = (darkOnLight) ? (color <= threshold) : (color > threshold);
+                        confidence = 2.0 * abs(color - threshold) / (abs(reg->offColor - reg->onColor) + 1);
                     } else {
-                        msg->array[idx] = DmtxModuleOff;
-                        // printf("0 ");
+                        isOn = (tally[mapRow][mapCol] / (double)weightFactor >= 0.5);
+                        confidence = fabs(2.0 * tally[mapRow][mapCol] / weightFactor - 1.0);
                     }
-                    // printf("libdmtx::populateArrayFromMatrix::idx: %d @ (%d,%d)\n", idx, mapCol, mapRow);
 
+                    msg->array[idx] = (isOn) ? DmtxModuleOnRGB : DmtxModuleOff;
                     msg->array[idx] |= DmtxModuleAssigned;  // 标记为已分配
+
+                    /* 判定结果接近阈值的模块，所在码字在纠错失败时作为擦除位置 */
+                    if (confidence < DmtxModuleUnsureLevel) {
+                        msg->array[idx] |= DmtxModuleUnsure;
+                    }
                 }
-                // printf("\n");
             }
         }
     }
-
-    return DmtxPass;
 }
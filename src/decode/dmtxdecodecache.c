@@ -0,0 +1,226 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodecache.c
+ * \brief Decode-result cache keyed by the sampled module matrix
+ *
+ * 同一个符号反复经过相机时，采样并判定得到的模块矩阵（msg->array）往往完全相同。
+ * 以模块矩阵为键保存解码结果，再次遇到时直接取出纠错后的码字和输出，跳过码字排布、纠错与数据解码。
+ * 先比较散列值，再逐字节比较模块矩阵确认命中，不会因散列冲突返回错误的结果。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 设置缓存容量，已保存的结果全部丢弃，命中统计保留
+ *
+ * \param cache 解码结果缓存
+ * \param capacity 最多保存的符号数，0 表示关闭
+ * \return DmtxPass | DmtxFail（参数无效或内存不足，此时缓存被关闭）
+ */
+static DmtxPassFail resultCacheSetCapacity(DmtxResultCache *cache, int capacity)
+{
+    resultCacheClear(cache);
+    free(cache->entry);
+    cache->entry = NULL;
+    cache->capacity = 0;
+
+    if (capacity < 0) {
+        return DmtxFail;
+    }
+
+    if (capacity > 0) {
+        cache->entry = (DmtxResultCacheEntry *)calloc(capacity, sizeof(DmtxResultCacheEntry));
+        if (cache->entry == NULL) {
+            return DmtxFail;
+        }
+    }
+
+    cache->capacity = capacity;
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 丢弃已保存的结果
+ */
+static void resultCacheClear(DmtxResultCache *cache)
+{
+    int i;
+
+    for (i = 0; i < cache->count; i++) {
+        free(cache->entry[i].key);
+    }
+    if (cache->entry != NULL) {
+        memset(cache->entry, 0x00, sizeof(DmtxResultCacheEntry) * cache->capacity);
+    }
+    cache->count = 0;
+}
+
+/**
+ * \brief 释放缓存占用的全部内存
+ */
+static void resultCacheFree(DmtxResultCache *cache)
+{
+    resultCacheClear(cache);
+    free(cache->entry);
+    free(cache->scratch);
+    memset(cache, 0x00, sizeof(DmtxResultCache));
+}
+
+/**
+ * \brief 模块矩阵的散列值（按 4 字节一组的 FNV-1a）
+ */
+static unsigned int resultCacheHash(const unsigned char *array, size_t size)
+{
+    size_t i;
+    unsigned int word;
+    unsigned int hash = 2166136261u;
+
+    for (i = 0; i + sizeof(word) <= size; i += sizeof(word)) {
+        memcpy(&word, array + i, sizeof(word));
+        hash = (hash ^ word) * 16777619u;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ array[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * \brief 查找与 msg->array 相同的符号，找到时把结果写入 msg
+ *
+ * \return DmtxPass: 命中，msg->code、msg->output、msg->outputIdx、msg->padCount 已填好 | DmtxFail: 未命中
+ */
+static DmtxPassFail resultCacheLookup(DmtxResultCache *cache, unsigned int hash, int sizeIdx, int fix,
+                                      INOUT DmtxMessage *msg)
+{
+    int i;
+    DmtxResultCacheEntry *entry;
+
+    for (i = 0; i < cache->count; i++) {
+        entry = &cache->entry[i];
+        if (entry->hash != hash || entry->sizeIdx != sizeIdx || entry->fnc1 != msg->fnc1 || entry->fix != fix ||
+            memcmp(entry->key, msg->array, msg->arraySize) != 0) {
+            continue;
+        }
+
+        /* 输出放不下时与完整解码一样失败，按未命中处理 */
+        if ((size_t)entry->outputIdx > msg->outputSize) {
+            return DmtxFail;
+        }
+
+        memcpy(msg->code, entry->code, msg->codeSize);
+        memcpy(msg->output, entry->output, entry->outputIdx);
+        msg->outputIdx = entry->outputIdx;
+        msg->padCount = entry->padCount;
+
+        entry->lastUse = ++cache->tick;
+
+        return DmtxPass;
+    }
+
+    return DmtxFail;
+}
+
+/**
+ * \brief 保存解码成功的结果，缓存已满时替换最久未用的结果
+ *
+ * \param key 码字排布前的模块矩阵（msg->arraySize 字节）
+ */
+static void resultCacheStore(DmtxResultCache *cache, unsigned int hash, int sizeIdx, int fix, const unsigned char *key,
+                             const DmtxMessage *msg)
+{
+    int i;
+    unsigned char *block;
+    DmtxResultCacheEntry *entry;
+
+    block = (unsigned char *)malloc(msg->arraySize + msg->codeSize + msg->outputIdx);
+    if (block == NULL) {
+        return;
+    }
+
+    if (cache->count < cache->capacity) {
+        entry = &cache->entry[cache->count++];
+    } else {
+        entry = &cache->entry[0];
+        for (i = 1; i < cache->count; i++) {
+            if (cache->entry[i].lastUse < entry->lastUse) {
+                entry = &cache->entry[i];
+            }
+        }
+        free(entry->key);
+    }
+
+    entry->hash = hash;
+    entry->sizeIdx = sizeIdx;
+    entry->fnc1 = msg->fnc1;
+    entry->fix = fix;
+    entry->padCount = msg->padCount;
+    entry->outputIdx = msg->outputIdx;
+    entry->key = block;
+    entry->code = block + msg->arraySize;
+    entry->output = entry->code + msg->codeSize;
+    entry->lastUse = ++cache->tick;
+
+    memcpy(entry->key, key, msg->arraySize);
+    memcpy(entry->code, msg->code, msg->codeSize);
+    memcpy(entry->output, msg->output, msg->outputIdx);
+}
+
+/**
+ * \brief decodePopulatedArray() 加上解码结果缓存
+ *
+ * 缓存关闭时等同于 decodePopulatedArray()。命中时 msg 与完整解码的结果相同，
+ * 只是 msg->array 保持码字排布前的状态。
+ *
+ * \param[in] dec 解码上下文，提供缓存
+ * \param[in] sizeIdx 数据矩阵的尺寸索引
+ * \param[in,out] msg 已经填充模块状态的解码消息
+ * \param[in] fix 纠错级别指示符
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail decodeCachedArray(DmtxDecode *dec, int sizeIdx, INOUT DmtxMessage *msg, int fix)
+{
+    unsigned int hash;
+    unsigned char *scratch;
+    DmtxResultCache *cache = &dec->resultCache;
+
+    if (cache->capacity == 0) {
+        return decodePopulatedArray(sizeIdx, msg, fix);
+    }
+
+    hash = resultCacheHash(msg->array, msg->arraySize);
+    if (resultCacheLookup(cache, hash, sizeIdx, fix, msg) == DmtxPass) {
+        cache->hits++;
+        return DmtxPass;
+    }
+    cache->misses++;
+
+    /* 码字排布会在 msg->array 中做标记，先保存一份作为键 */
+    if (cache->scratchSize < msg->arraySize) {
+        scratch = (unsigned char *)realloc(cache->scratch, msg->arraySize);
+        if (scratch == NULL) {
+            return decodePopulatedArray(sizeIdx, msg, fix);
+        }
+        cache->scratch = scratch;
+        cache->scratchSize = msg->arraySize;
+    }
+    memcpy(cache->scratch, msg->array, msg->arraySize);
+
+    if (decodePopulatedArray(sizeIdx, msg, fix) == DmtxFail) {
+        return DmtxFail;
+    }
+
+    resultCacheStore(cache, hash, sizeIdx, fix, cache->scratch, msg);
+
+    return DmtxPass;
+}
@@ -0,0 +1,300 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodepipeline.c
+ * \brief Overlap region finding and decoding on worker threads
+ *
+ * dmtxDecodeAll() 中寻找区域与解码交替进行。这里调用线程只负责寻找，把候选区域放入有界无锁队列，
+ * 多个解码线程取出区域采样、纠错和数据解码，再经另一个队列把结果交回调用线程。
+ * 每个队列配一个信号量计数其中的区域，队列为空时解码线程和调用线程阻塞等待，而不是忙等。
+ * 区域在交出时就标记为已扫描（与 dmtxDecodeMatrixRegion() 一样在解码前标记），
+ * 所以寻找的路径与 dmtxDecodeAll() 完全相同，正在解码的符号也不会被再次找到。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 与 dmtxDecodeAll() 相同，但解码在 workers 个工作线程中与寻找同时进行
+ *
+ * 结果与 dmtxDecodeAll() 相同，按找到区域的次序排列；输出回调在调用线程中按同样的次序调用。
+ * 解码线程不使用 dmtxDecodeSetOutputBuffer() 的缓冲区和解码结果缓存。
+ * 设置了 maxCount 时，寻找可能已经越过最后一个结果所在的位置。
+ * 无法创建线程时（或定义了 DMTX_NO_THREADS）等同于 dmtxDecodeAll()。
+ *
+ * \param dec 解码上下文
+ * \param workers 解码线程数
+ * \param opts 选项，NULL 表示全部取默认值（找出所有符号）
+ * \param results 输出解码成功的符号
+ * \return DmtxPass: 达到期望数量（或未设置期望数量）| DmtxFail
+ */
+extern DmtxPassFail dmtxDecodePipeline(DmtxDecode *dec, int workers, DmtxDecodeAllOpts *opts,
+                                       OUT DmtxDecodeResults *results)
+{
+    int i, started;
+    int maxCount, expectedCount;
+    long pushed, collected, successes, itemCapacity;
+    void *data;
+    DmtxPassFail status;
+    DmtxRegion *reg;
+    DmtxPipelineRun run;
+    DmtxPipelineWorker *worker;
+    DmtxPipelineItem *item, **items, **itemsNew;
+
+    if (results == NULL) {
+        return DmtxFail;
+    }
+    memset(results, 0x00, sizeof(DmtxDecodeResults));
+
+    if (dec == NULL || workers <= 0) {
+        return DmtxFail;
+    }
+
+    expectedCount = (opts != NULL) ? opts->expectedCount : DmtxUndefined;
+    maxCount = (opts != NULL && opts->maxCount != DmtxUndefined) ? opts->maxCount : expectedCount;
+
+    /*
+     * 每个解码线程约有两个在途的区域。在途区域数（已交出未收回）不超过队列容量，
+     * 所以两个队列都不会满，入队总是成功。
+     */
+    memset(&run, 0x00, sizeof(DmtxPipelineRun));
+    run.dec = dec;
+    run.fix = (opts != NULL) ? opts->fix : DmtxUndefined;
+    if (ringInit(&run.todo, 2 * (long)workers) == DmtxFail) {
+        return DmtxFail;
+    }
+    if (ringInit(&run.done, run.todo.mask + 1) == DmtxFail) {
+        ringFree(&run.todo);
+        return DmtxFail;
+    }
+    if (semaphoreInit(&run.todoSem) == DmtxFail) {
+        ringFree(&run.todo);
+        ringFree(&run.done);
+        return DmtxFail;
+    }
+    if (semaphoreInit(&run.doneSem) == DmtxFail) {
+        semaphoreFree(&run.todoSem);
+        ringFree(&run.todo);
+        ringFree(&run.done);
+        return DmtxFail;
+    }
+
+    worker = (DmtxPipelineWorker *)calloc(workers, sizeof(DmtxPipelineWorker));
+    if (worker == NULL) {
+        pipelineFree(&run);
+        return DmtxFail;
+    }
+
+    started = 0;
+    for (i = 0; i < workers; i++) {
+        /*
+         * 解码线程只读取图像和亮度平面，扫描缓存、输出目的地和结果缓存都只属于调用线程；
+         * 取消标志通过指针与调用者共用，dmtxDecodeCancel() 会让正在解码的副本也尽快放弃
+         */
+        worker[i].dec = *dec;
+        worker[i].dec.cache = NULL;
+        worker[i].dec.outputBuf = NULL;
+        worker[i].dec.outputSink = NULL;
+        memset(&worker[i].dec.resultCache, 0x00, sizeof(DmtxResultCache));
+        memset(&worker[i].dec.expected, 0x00, sizeof(DmtxExpected));
+        worker[i].run = &run;
+        if (threadStart(&worker[i].thread, pipelineWork, &worker[i]) == DmtxPass) {
+            worker[i].started = DmtxTrue;
+            started++;
+        }
+    }
+
+    if (started == 0) {
+        free(worker);
+        pipelineFree(&run);
+        return dmtxDecodeAll(dec, opts, results);
+    }
+
+    status = DmtxPass;
+    items = NULL;
+    itemCapacity = 0;
+    pushed = collected = successes = 0;
+
+    for (;;) {
+        /* 收回已完成的区域；在途区域已占满队列时先等待一个解码完成 */
+        for (;;) {
+            if (semaphoreTryWait(&run.doneSem) == DmtxFalse) {
+                if (pushed - collected <= run.todo.mask) {
+                    break;
+                }
+                semaphoreWait(&run.doneSem);
+            }
+            ringPop(&run.done, &data);
+            items[collected++] = (DmtxPipelineItem *)data;
+            if (((DmtxPipelineItem *)data)->msg != NULL) {
+                successes++;
+            }
+        }
+
+        if (maxCount != DmtxUndefined && successes >= maxCount) {
+            break;
+        }
+
+        reg = dmtxRegionFindNext(dec, NULL);
+        if (reg == NULL) {
+            break;
+        }
+
+        /* 交出前标记为已扫描，与 dmtxDecodeMatrixRegion() 相同，寻找不会再进入这个区域 */
+        cacheFillRegion(dec, reg);
+
+        if (pushed == itemCapacity) {
+            itemsNew = (DmtxPipelineItem **)realloc(items, sizeof(DmtxPipelineItem *) * (itemCapacity * 2 + 16));
+            if (itemsNew == NULL) {
+                dmtxRegionDestroy(&reg);
+                status = DmtxFail;
+                break;
+            }
+            items = itemsNew;
+            itemCapacity = itemCapacity * 2 + 16;
+        }
+
+        item = (DmtxPipelineItem *)malloc(sizeof(DmtxPipelineItem));
+        if (item == NULL) {
+            dmtxRegionDestroy(&reg);
+            status = DmtxFail;
+            break;
+        }
+        item->seq = pushed;
+        item->reg = *reg;
+        item->msg = NULL;
+        dmtxRegionDestroy(&reg);
+
+        ringPush(&run.todo, item);
+        semaphorePost(&run.todoSem, 1);
+        pushed++;
+    }
+
+    /* 每个解码线程再多一个计数，处理完 todo 后取不到区域即退出；等待在途的区域解码完成 */
+    semaphorePost(&run.todoSem, started);
+    while (collected < pushed) {
+        semaphoreWait(&run.doneSem);
+        ringPop(&run.done, &data);
+        items[collected++] = (DmtxPipelineItem *)data;
+    }
+
+    for (i = 0; i < workers; i++) {
+        if (worker[i].started == DmtxTrue) {
+            threadJoin(&worker[i].thread);
+        }
+    }
+    free(worker);
+    pipelineFree(&run);
+
+    /* 按找到的次序交付，与 dmtxDecodeAll() 的结果一致 */
+    if (collected > 0) {
+        qsort(items, collected, sizeof(DmtxPipelineItem *), comparePipelineItems);
+    }
+    for (i = 0; i < collected; i++) {
+        item = items[i];
+        if (item->msg != NULL && status == DmtxPass && (maxCount == DmtxUndefined || results->count < maxCount)) {
+            if (decodeResultsAppend(dec, results, &item->reg, item->msg) == DmtxPass) {
+                decodeDeliverOutput(dec, item->msg);
+                item->msg = NULL;
+            } else {
+                status = DmtxFail;
+            }
+        }
+        if (item->msg != NULL) {
+            dmtxMessageDestroy(&item->msg);
+        }
+        free(item);
+    }
+    free(items);
+
+    if (status == DmtxPass && expectedCount != DmtxUndefined && results->count < expectedCount) {
+        return DmtxFail;
+    }
+
+    return status;
+}
+
+/**
+ * \brief 解码线程：取出区域解码，结果交回调用线程，直到寻找结束且队列为空
+ */
+static void pipelineWork(void *arg)
+{
+    void *data;
+    DmtxPipelineWorker *worker = (DmtxPipelineWorker *)arg;
+    DmtxPipelineRun *run = worker->run;
+    DmtxPipelineItem *item;
+
+    for (;;) {
+        /* 每个计数对应一个区域或一个退出通知；区域都在退出通知之前入队，取不到区域说明队列已空 */
+        semaphoreWait(&run->todoSem);
+        if (ringPop(&run->todo, &data) == DmtxFail) {
+            break;
+        }
+        item = (DmtxPipelineItem *)data;
+
+        item->msg = pipelineDecodeRegion(&worker->dec, &item->reg, run->fix);
+
+        ringPush(&run->done, item);
+        semaphorePost(&run->doneSem, 1);
+    }
+}
+
+/**
+ * \brief 释放 dmtxDecodePipeline() 的队列和信号量，此时解码线程都已结束
+ */
+static void pipelineFree(DmtxPipelineRun *run)
+{
+    semaphoreFree(&run->todoSem);
+    semaphoreFree(&run->doneSem);
+    ringFree(&run->todo);
+    ringFree(&run->done);
+}
+
+/**
+ * \brief 与 dmtxDecodeMatrixRegion() 相同的解码过程，但不标记扫描缓存、不使用输出缓冲区
+ */
+static DmtxMessage *pipelineDecodeRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
+{
+    DmtxMessage *msg;
+    DmtxModuleSamples samples;
+
+    if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+        return NULL;
+    }
+
+    msg = messageCreate(reg->sizeIdx, DmtxFormatMatrix, NULL, 0);
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    if (sampleModuleColors(dec, reg, &samples) != DmtxPass) {
+        dmtxMessageDestroy(&msg);
+        return NULL;
+    }
+
+    msg->fnc1 = dec->fnc1;
+
+    if (decodeModuleSamples(dec, reg, &samples, fix, msg) == DmtxFail) {
+        dmtxMessageDestroy(&msg);
+    }
+    free(samples.color);
+
+    return msg;
+}
+
+/**
+ * \brief 按找到区域的次序排序
+ */
+static int comparePipelineItems(const void *a, const void *b)
+{
+    const DmtxPipelineItem *itemA = *(DmtxPipelineItem *const *)a;
+    const DmtxPipelineItem *itemB = *(DmtxPipelineItem *const *)b;
+
+    return (itemA->seq > itemB->seq) - (itemA->seq < itemB->seq);
+}
@@ -0,0 +1,281 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodeplane.c
+ * \brief Decoder-owned sample planes
+ *
+ * 对彩色（或高位深）图像，解码器可以在扫描前一次性生成一个 8 位亮度平面，
+ * 之后寻边与模块采样只访问该平面，而不是对每个颜色通道分别计算梯度。
+ * 该平面使用缩放后的坐标，与 cache 一一对应，并以虚拟通道 DmtxPlaneLuma 的形式
+ * 提供给 dmtxDecodeGetPixelValue，因此图像自身的各通道仍可单独访问（例如 Mosaic 解码）。
+ *
+ * 对光照不均或低对比度的图像，还可以在亮度平面上做局部自适应二值化
+ * （DmtxPropBinarize），寻边和模块分类随后都在二值化结果上进行。
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 生成缩放分辨率下的 8 位亮度平面
+ *
+ * 8 位 RGB/BGR 类格式使用定点权重 (77R + 150G + 29B) / 256 直接按行计算，
+ * 循环体只有整数乘加，便于编译器自动向量化；其它格式退化为通道均值。
+ *
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail decodeBuildLumaPlane(DmtxDecode *dec)
+{
+    int x, y, i;
+    int width, height;
+    int step, value, sum, shift;
+    int weight[3];
+    int channelCount;
+    unsigned char *row, *out;
+    unsigned char *c0, *c1, *c2;
+    DmtxImage *img = dec->image;
+
+    width = img->width / dec->scale;
+    height = img->height / dec->scale;
+
+    if (dec->luma == NULL) {
+        dec->luma = (unsigned char *)malloc((size_t)width * height);
+        if (dec->luma == NULL) {
+            return DmtxFail;
+        }
+    }
+
+    switch (img->pixelPacking) {
+        case DmtxPack24bppRGB:
+        case DmtxPack32bppRGBX:
+        case DmtxPack32bppXRGB:
+            weight[0] = 77;
+            weight[1] = 150;
+            weight[2] = 29;
+            break;
+        case DmtxPack24bppBGR:
+        case DmtxPack32bppBGRX:
+        case DmtxPack32bppXBGR:
+            weight[0] = 29;
+            weight[1] = 150;
+            weight[2] = 77;
+            break;
+        default:
+            weight[0] = DmtxUndefined;
+            break;
+    }
+
+    if (weight[0] != DmtxUndefined) {
+        step = img->bytesPerPixel * dec->scale;
+        for (y = 0; y < height; y++) {
+            row = img->pxl + getPixelOffset(img, 0, y * dec->scale);
+            c0 = row + img->channelStart[0] / 8;
+            c1 = row + img->channelStart[1] / 8;
+            c2 = row + img->channelStart[2] / 8;
+            out = dec->luma + (size_t)y * width;
+            for (x = 0; x < width; x++) {
+                out[x] = (unsigned char)((weight[0] * c0[x * step] + weight[1] * c1[x * step] +
+                                          weight[2] * c2[x * step] + 128) >> 8);
+            }
+        }
+        return DmtxPass;
+    }
+
+    /* 8 位单通道（灰度、YUV 亮度）按行直接复制 */
+    if (img->channelCount == 1 && img->bitsPerChannel[0] == 8 &&
+        !(img->pixelPacking >= DmtxPackBayerRGGB && img->pixelPacking <= DmtxPackBayerGBRG)) {
+        step = img->bytesPerPixel * dec->scale;
+        for (y = 0; y < height; y++) {
+            c0 = img->pxl + getPixelOffset(img, 0, y * dec->scale) + img->channelStart[0] / 8;
+            out = dec->luma + (size_t)y * width;
+            for (x = 0; x < width; x++) {
+                out[x] = c0[x * step];
+            }
+        }
+        return DmtxPass;
+    }
+
+    /* Generic path: mean of up to three channels reduced to 8 bits */
+    channelCount = min(img->channelCount, 3);
+    shift = max(img->bitsPerChannel[0] - 8, 0);
+    for (y = 0; y < height; y++) {
+        out = dec->luma + (size_t)y * width;
+        for (x = 0; x < width; x++) {
+            for (sum = 0, i = 0; i < channelCount; i++) {
+                dmtxImageGetPixelValue(img, x * dec->scale, y * dec->scale, i, &value);
+                sum += value;
+            }
+            out[x] = (unsigned char)min((sum / channelCount) >> shift, 255);
+        }
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 3x3 均值，抑制传感器噪声后再与阈值比较
+ */
+static int getSmoothedSample(unsigned char *src, int width, int height, int x, int y)
+{
+    int xx, yy, sum, count;
+
+    for (sum = count = 0, yy = max(y - 1, 0); yy <= min(y + 1, height - 1); yy++) {
+        for (xx = max(x - 1, 0); xx <= min(x + 1, width - 1); xx++) {
+            sum += src[yy * width + xx];
+            count++;
+        }
+    }
+
+    return sum / count;
+}
+
+/**
+ * \brief 在亮度平面上原地做局部自适应二值化
+ *
+ * 以 (2 * radius + 1) 的方形窗口计算局部均值 m 与标准差 s，并用 3x3 均值后的像素与阈值比较。窗口和由逐列累加和
+ * 加每行的前缀和（即按行滚动的积分图）得到，内存只与图像宽度成正比。大帧上的窗口和可能超过 32 位，因此累加和用 64 位。
+ *
+ * - DmtxBinarizeLocalMean: I < m - 8 为暗
+ * - DmtxBinarizeSauvola:   I < m * (1 + k * (s / 128 - 1))，k = 0.2 为暗
+ *
+ * 平坦区域（噪声）在两种方式下都会被判为亮，从而不会再产生大量虚假的起始边缘。
+ * 结果为 0/255，后续的梯度计算和模块分类都在该结果上进行。
+ */
+static DmtxPassFail decodeBinarizePlane(DmtxDecode *dec)
+{
+    int x, y, x0, x1, yAdd, ySub;
+    int width, height, radius;
+    int area, value;
+    double mean, var, threshold;
+    uint64_t *colSum, *rowSum;
+    double *colSq, *rowSq;
+    unsigned char *src, *out;
+
+    width = dec->image->width / dec->scale;
+    height = dec->image->height / dec->scale;
+    radius = dec->binarizeRadius;
+    if (radius == DmtxUndefined) {
+        radius = max(min(width, height) / 16, 7);
+    }
+    /* 窗口超出平面后不再变化，限制半径以免 y + radius 溢出 */
+    radius = min(radius, max(width, height));
+
+    /* 原地写回前需要保留一份源数据 */
+    src = (unsigned char *)malloc((size_t)width * height);
+    colSum = (uint64_t *)calloc(width, sizeof(uint64_t));
+    rowSum = (uint64_t *)malloc((width + 1) * sizeof(uint64_t));
+    colSq = (double *)calloc(width, sizeof(double));
+    rowSq = (double *)malloc((width + 1) * sizeof(double));
+    if (src == NULL || colSum == NULL || rowSum == NULL || colSq == NULL || rowSq == NULL) {
+        free(src);
+        free(colSum);
+        free(rowSum);
+        free(colSq);
+        free(rowSq);
+        return DmtxFail;
+    }
+    memcpy(src, dec->luma, (size_t)width * height);
+
+    /* Prime column sums with rows [0, radius - 1] */
+    for (y = 0; y < min(radius, height); y++) {
+        for (x = 0; x < width; x++) {
+            value = src[y * width + x];
+            colSum[x] += value;
+            colSq[x] += value * value;
+        }
+    }
+
+    for (y = 0; y < height; y++) {
+        /* Slide the vertical window to rows [y - radius, y + radius] */
+        yAdd = y + radius;
+        ySub = y - radius - 1;
+        if (yAdd < height) {
+            for (x = 0; x < width; x++) {
+                value = src[yAdd * width + x];
+                colSum[x] += value;
+                colSq[x] += value * value;
+            }
+        }
+        if (ySub >= 0) {
+            for (x = 0; x < width; x++) {
+                value = src[ySub * width + x];
+                colSum[x] -= value;
+                colSq[x] -= value * value;
+            }
+        }
+
+        rowSum[0] = 0;
+        rowSq[0] = 0.0;
+        for (x = 0; x < width; x++) {
+            rowSum[x + 1] = rowSum[x] + colSum[x];
+            rowSq[x + 1] = rowSq[x] + colSq[x];
+        }
+
+        out = dec->luma + (size_t)y * width;
+        for (x = 0; x < width; x++) {
+            x0 = max(x - radius, 0);
+            x1 = min(x + radius + 1, width);
+            area = (x1 - x0) * (min(y + radius, height - 1) - max(y - radius, 0) + 1);
+            mean = (double)(rowSum[x1] - rowSum[x0]) / area;
+
+            if (dec->binarize == DmtxBinarizeSauvola) {
+                var = (rowSq[x1] - rowSq[x0]) / area - mean * mean;
+                threshold = mean * (1.0 + 0.2 * (sqrt(max(var, 0.0)) / 128.0 - 1.0));
+            } else {
+                threshold = mean - 8.0;
+            }
+
+            out[x] = (getSmoothedSample(src, width, height, x, y) < threshold) ? 0 : 255;
+        }
+    }
+
+    free(src);
+    free(colSum);
+    free(rowSum);
+    free(colSq);
+    free(rowSq);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 根据 lumaPlane 与 binarize 选项重新生成（或释放）解码器持有的采样平面
+ *
+ * 单通道 8 位图像本身就是亮度平面，只有需要二值化时才复制一份。
+ */
+static DmtxPassFail decodeUpdatePlane(DmtxDecode *dec)
+{
+    DmtxBoolean needPlane;
+
+    if (dec->binarize != DmtxBinarizeNone) {
+        needPlane = DmtxTrue;
+    } else if (dec->lumaPlane == DmtxTrue) {
+        needPlane = (dec->image->channelCount == 1 && dec->image->bitsPerChannel[0] == 8) ? DmtxFalse : DmtxTrue;
+    } else {
+        needPlane = DmtxFalse;
+    }
+
+    if (needPlane == DmtxFalse) {
+        free(dec->luma);
+        dec->luma = NULL;
+        return DmtxPass;
+    }
+
+    if (decodeBuildLumaPlane(dec) == DmtxFail) {
+        return DmtxFail;
+    }
+
+    if (dec->binarize != DmtxBinarizeNone) {
+        return decodeBinarizePlane(dec);
+    }
+
+    return DmtxPass;
+}
@@ -16,16 +16,80 @@
 #include <assert.h>
 #include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include "dmtx.h"
 #include "dmtxstatic.h"
 
+/* C40/Text/X12 查表结果中的特殊值，非负值即为输出字节 */
+#define DmtxC40TextValueNone -1       /* 不输出，状态不变 */
+#define DmtxC40TextValueShift1 -2     /* 切换到 Shift 1 */
+#define DmtxC40TextValueShift2 -3     /* 切换到 Shift 2 */
+#define DmtxC40TextValueShift3 -4     /* 切换到 Shift 3 */
+#define DmtxC40TextValueFnc1 -5       /* FNC1 */
+#define DmtxC40TextValueUpperShift -6 /* Upper Shift */
+
+/* 三元组拆出的值范围为 -1..40（码字对无效时会越出 0..39），表下标为值加 1 */
+#define DmtxC40TextTableSize 42
+
+/* ASCII 编码 130..229 对应的两位数字 */
+static const char asciiDigitPairs[] = "00010203040506070809"
+                                      "10111213141516171819"
+                                      "20212223242526272829"
+                                      "30313233343536373839"
+                                      "40414243444546474849"
+                                      "50515253545556575859"
+                                      "60616263646566676869"
+                                      "70717273747576777879"
+                                      "80818283848586878889"
+                                      "90919293949596979899";
+
+/* C40/Text 各字符集的值到输出字节的映射，[0] 为 C40，[1] 为 Text */
+static const short c40TextValues[2][4][DmtxC40TextTableSize] = {
+    {
+        /* C40 Basic set: 空格、0-9、A-Z */
+        {-1, -2, -3, -4, 32, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 65, 66, 67, 68, 69, 70,
+         71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, -1},
+        /* Shift 1: ASCII 0-31 */
+        {255, 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+         20,  21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40},
+        /* Shift 2: ASCII 33-47、58-64、91-95，FNC1，Upper Shift */
+        {32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 58, 59, 60, 61, 62,
+         63, 64, 91, 92, 93, 94, 95, -5, -1, -1, -6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+        /* Shift 3: ASCII 96-127 */
+        {95,  96,  97,  98,  99,  100, 101, 102, 103, 104, 105, 106, 107, 108,
+         109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122,
+         123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136},
+    },
+    {
+        /* Text Basic set: 空格、0-9、a-z */
+        {-1,  -2,  -3,  -4,  32,  48,  49,  50,  51,  52,  53,  54,  55,  56,
+         57,  97,  98,  99,  100, 101, 102, 103, 104, 105, 106, 107, 108, 109,
+         110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, -1},
+        /* Shift 1: ASCII 0-31 */
+        {255, 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+         20,  21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40},
+        /* Shift 2: ASCII 33-47、58-64、91-95，FNC1，Upper Shift */
+        {32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 58, 59, 60, 61, 62,
+         63, 64, 91, 92, 93, 94, 95, -5, -1, -1, -6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+        /* Shift 3: `、A-Z、{ | } ~ DEL */
+        {63,  96,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,
+         77,  78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,
+         123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136},
+    },
+};
+
+/* X12 的值到输出字节的映射：CR * > 空格 0-9 A-Z */
+static const unsigned char x12Values[DmtxC40TextTableSize] = {
+    43, 13, 42, 62, 32, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 65, 66, 67, 68, 69, 70,
+    71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91};
+
 /**
  * \brief Translate encoded data stream into final output
  * \param msg
  * \param sizeIdx
  * \param outputStart
- * \return void
+ * \return DmtxPass | DmtxFail (invalid stream, or msg->output too small)
  */
 extern DmtxPassFail decodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned char *outputStart)
 {
@@ -51,7 +115,9 @@ extern DmtxPassFail decodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned cha
 
     /* Print macro header if first codeword triggers it */
     if (*ptr == DmtxValue05Macro || *ptr == DmtxValue06Macro) {
-        pushOutputMacroHeader(msg, *ptr);
+        if (pushOutputMacroHeader(msg, *ptr) == DmtxFail) {
+            return DmtxFail;
+        }
         macro = DmtxTrue;
     }
 
@@ -90,7 +156,9 @@ extern DmtxPassFail decodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned cha
 
     /* Print macro trailer if required */
     if (macro == DmtxTrue) {
-        pushOutputMacroTrailer(msg);
+        if (pushOutputMacroTrailer(msg) == DmtxFail) {
+            return DmtxFail;
+        }
     }
 
     return DmtxPass;
@@ -130,14 +198,28 @@ static int getEncodationScheme(unsigned char cw)
 }
 
 /**
- *
- *
+ * \brief 输出缓冲区是否还能容纳 count 个字节
  */
-static void pushOutputWord(DmtxMessage *msg, int value)
+static DmtxBoolean outputHasRoom(const DmtxMessage *msg, size_t count)
+{
+    return ((size_t)msg->outputIdx + count <= msg->outputSize) ? DmtxTrue : DmtxFalse;
+}
+
+/**
+ * \brief 输出一个字节
+ * \return DmtxPass | DmtxFail（输出缓冲区已满）
+ */
+static DmtxPassFail pushOutputWord(DmtxMessage *msg, int value)
 {
     DmtxAssert(value >= 0 && value < 256);
 
+    if (outputHasRoom(msg, 1) == DmtxFalse) {
+        return DmtxFail;
+    }
+
     msg->output[msg->outputIdx++] = (unsigned char)value;
+
+    return DmtxPass;
 }
 
 /**
@@ -150,13 +232,17 @@ static DmtxBoolean validOutputWord(int value)
 }
 
 /**
- *
- *
+ * \brief 输出一个 C40/Text 字符，并回到 Basic set
+ * \return DmtxPass | DmtxFail（输出缓冲区已满）
  */
-static void pushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value)
+static DmtxPassFail pushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value)
 {
     DmtxAssert(value >= 0 && value < 256);
 
+    if (outputHasRoom(msg, 1) == DmtxFalse) {
+        return DmtxFail;
+    }
+
     msg->output[msg->outputIdx] = (unsigned char)value;
 
     if (state->upperShift == DmtxTrue) {
@@ -168,21 +254,28 @@ static void pushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int val
 
     state->shift = DmtxC40TextBasicSet;
     state->upperShift = DmtxFalse;
+
+    return DmtxPass;
 }
 
 /**
- *
- *
+ * \brief 输出宏头 "[)>" RS "05"/"06" GS
+ * \return DmtxPass | DmtxFail（输出缓冲区已满）
  */
-static void pushOutputMacroHeader(DmtxMessage *msg, int macroType)
+static DmtxPassFail pushOutputMacroHeader(DmtxMessage *msg, int macroType)
 {
+    DmtxAssert(macroType == DmtxValue05Macro || macroType == DmtxValue06Macro);
+
+    if (outputHasRoom(msg, 7) == DmtxFalse) {
+        return DmtxFail;
+    }
+
     pushOutputWord(msg, '[');
     pushOutputWord(msg, ')');
     pushOutputWord(msg, '>');
     pushOutputWord(msg, 30); /* ASCII RS */
     pushOutputWord(msg, '0');
 
-    DmtxAssert(macroType == DmtxValue05Macro || macroType == DmtxValue06Macro);
     if (macroType == DmtxValue05Macro) {
         pushOutputWord(msg, '5');
     } else {
@@ -190,16 +283,24 @@ static void pushOutputMacroHeader(DmtxMessage *msg, int macroType)
     }
 
     pushOutputWord(msg, 29); /* ASCII GS */
+
+    return DmtxPass;
 }
 
 /**
- *
- *
+ * \brief 输出宏尾 RS EOT
+ * \return DmtxPass | DmtxFail（输出缓冲区已满）
  */
-static void pushOutputMacroTrailer(DmtxMessage *msg)
+static DmtxPassFail pushOutputMacroTrailer(DmtxMessage *msg)
 {
+    if (outputHasRoom(msg, 2) == DmtxFalse) {
+        return DmtxFail;
+    }
+
     pushOutputWord(msg, 30); /* ASCII RS */
     pushOutputWord(msg, 4);  /* ASCII EOT */
+
+    return DmtxPass;
 }
 
 /**
@@ -224,10 +325,9 @@ static unsigned char *decodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, un
 
         if (upperShift == DmtxTrue) {
             int pushword = codeword + 127;
-            if (validOutputWord(pushword) != DmtxTrue) {
+            if (validOutputWord(pushword) != DmtxTrue || pushOutputWord(msg, pushword) == DmtxFail) {
                 return NULL;
             }
-            pushOutputWord(msg, pushword);
             upperShift = DmtxFalse;
         } else if (codeword == DmtxValueAsciiUpperShift) {
             upperShift = DmtxTrue;
@@ -239,18 +339,22 @@ static unsigned char *decodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, un
         } else if (codeword == 0 || codeword >= 242) {
             return ptr;
         } else if (codeword <= 128) {
-            pushOutputWord(msg, codeword - 1);
+            if (pushOutputWord(msg, codeword - 1) == DmtxFail) {
+                return NULL;
+            }
         } else if (codeword <= 229) {
-            int digits = codeword - 130;
-            pushOutputWord(msg, digits / 10 + '0');
-            pushOutputWord(msg, digits - (digits / 10) * 10 + '0');
+            /* 两位数字直接查表 */
+            if (outputHasRoom(msg, 2) == DmtxFalse) {
+                return NULL;
+            }
+            memcpy(msg->output + msg->outputIdx, asciiDigitPairs + 2 * (codeword - 130), 2);
+            msg->outputIdx += 2;
         } else if (codeword == DmtxValueFNC1) {
             if (msg->fnc1 != DmtxUndefined) {
                 int pushword = msg->fnc1;
-                if (validOutputWord(pushword) != DmtxTrue) {
+                if (validOutputWord(pushword) != DmtxTrue || pushOutputWord(msg, pushword) == DmtxFail) {
                     return NULL;
                 }
-                pushOutputWord(msg, pushword);
             }
         }
     }
@@ -258,6 +362,22 @@ static unsigned char *decodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, un
     return ptr;
 }
 
+/**
+ * \brief 把 C40/Text/X12 的一对码字拆成三个值
+ *
+ * 合法码字对的打包值为 1..64000，对应三个 0..39 的值；其他码字对拆出的值可能为 -1 或 40。
+ */
+static void unpackC40TextTriplet(const unsigned char *ptr, int values[3])
+{
+    int packed, rem;
+
+    packed = ((*ptr << 8) | *(ptr + 1)) - 1;
+    values[0] = packed / 1600;
+    rem = packed - values[0] * 1600;
+    values[1] = rem / 40;
+    values[2] = rem - values[1] * 40;
+}
+
 /**
  * \brief Decode stream assuming C40 or Text encodation
  * \param msg
@@ -265,19 +385,25 @@ static unsigned char *decodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, un
  * \param dataEnd
  * \param encScheme
  * \return Pointer to next undecoded codeword
+ *         NULL if the output buffer is too small
  */
 static unsigned char *decodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd,
                                           DmtxScheme encScheme)
 {
     int i;
-    int packed;
+    int value;
+    int c40Count;
     int c40Values[3];
+    int basic[3];
+    unsigned char *output;
+    const short(*sets)[DmtxC40TextTableSize];
     C40TextState state;
 
     state.shift = DmtxC40TextBasicSet;
     state.upperShift = DmtxFalse;
 
     DmtxAssert(encScheme == DmtxSchemeC40 || encScheme == DmtxSchemeText);
+    sets = c40TextValues[(encScheme == DmtxSchemeC40) ? 0 : 1];
 
     /* Unlatch is implied if only one codeword remains */
     if (dataEnd - ptr < 2) {
@@ -286,56 +412,60 @@ static unsigned char *decodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr,
 
     while (ptr < dataEnd) {
         /* FIXME Also check that ptr+1 is safe to access */
-        packed = (*ptr << 8) | *(ptr + 1);
-        c40Values[0] = ((packed - 1) / 1600);
-        c40Values[1] = ((packed - 1) / 40) % 40;
-        c40Values[2] = (packed - 1) % 40;
+        unpackC40TextTriplet(ptr, c40Values);
         ptr += 2;
 
-        for (i = 0; i < 3; i++) {
-            if (state.shift == DmtxC40TextBasicSet) { /* Basic set */
-                if (c40Values[i] <= 2) {
-                    state.shift = c40Values[i] + 1;
-                } else if (c40Values[i] == 3) {
-                    pushOutputC40TextWord(msg, &state, ' ');
-                } else if (c40Values[i] <= 13) {
-                    pushOutputC40TextWord(msg, &state, c40Values[i] - 13 + '9'); /* 0-9 */
-                } else if (c40Values[i] <= 39) {
-                    if (encScheme == DmtxSchemeC40) {
-                        pushOutputC40TextWord(msg, &state, c40Values[i] - 39 + 'Z'); /* A-Z */
-                    } else if (encScheme == DmtxSchemeText) {
-                        pushOutputC40TextWord(msg, &state, c40Values[i] - 39 + 'z'); /* a-z */
-                    }
+        /* 最常见的情况：三个值都是 Basic set 中的普通字符，直接查表输出 */
+        if (state.shift == DmtxC40TextBasicSet && state.upperShift == DmtxFalse && outputHasRoom(msg, 3) == DmtxTrue) {
+            basic[0] = sets[DmtxC40TextBasicSet][c40Values[0] + 1];
+            basic[1] = sets[DmtxC40TextBasicSet][c40Values[1] + 1];
+            basic[2] = sets[DmtxC40TextBasicSet][c40Values[2] + 1];
+            if ((basic[0] | basic[1] | basic[2]) >= 0) {
+                output = msg->output + msg->outputIdx;
+                output[0] = (unsigned char)basic[0];
+                output[1] = (unsigned char)basic[1];
+                output[2] = (unsigned char)basic[2];
+                msg->outputIdx += 3;
+                c40Count = 0;
+            } else {
+                c40Count = 3;
+            }
+        } else {
+            c40Count = 3;
+        }
+
+        for (i = 0; i < c40Count; i++) {
+            value = sets[state.shift][c40Values[i] + 1];
+
+            if (value >= 0) {
+                if (pushOutputC40TextWord(msg, &state, value) == DmtxFail) {
+                    return NULL;
                 }
-            } else if (state.shift == DmtxC40TextShift1) {        /* Shift 1 set */
-                pushOutputC40TextWord(msg, &state, c40Values[i]); /* ASCII 0 - 31 */
-            } else if (state.shift == DmtxC40TextShift2) {        /* Shift 2 set */
-                if (c40Values[i] <= 14) {
-                    pushOutputC40TextWord(msg, &state, c40Values[i] + 33); /* ASCII 33 - 47 */
-                } else if (c40Values[i] <= 21) {
-                    pushOutputC40TextWord(msg, &state, c40Values[i] + 43); /* ASCII 58 - 64 */
-                } else if (c40Values[i] <= 26) {
-                    pushOutputC40TextWord(msg, &state, c40Values[i] + 69); /* ASCII 91 - 95 */
-                } else if (c40Values[i] == 27) {
-                    if (msg->fnc1 != DmtxUndefined) {
-                        pushOutputC40TextWord(msg, &state, msg->fnc1);
+                continue;
+            }
+
+            switch (value) {
+                case DmtxC40TextValueShift1:
+                    state.shift = DmtxC40TextShift1;
+                    break;
+                case DmtxC40TextValueShift2:
+                    state.shift = DmtxC40TextShift2;
+                    break;
+                case DmtxC40TextValueShift3:
+                    state.shift = DmtxC40TextShift3;
+                    break;
+                case DmtxC40TextValueFnc1:
+                    if (msg->fnc1 != DmtxUndefined && pushOutputC40TextWord(msg, &state, msg->fnc1) == DmtxFail) {
+                        return NULL;
                     }
-                } else if (c40Values[i] == 30) {
+                    break;
+                case DmtxC40TextValueUpperShift:
                     state.upperShift = DmtxTrue;
                     state.shift = DmtxC40TextBasicSet;
-                }
-            } else if (state.shift == DmtxC40TextShift3) { /* Shift 3 set */
-                if (encScheme == DmtxSchemeC40) {
-                    pushOutputC40TextWord(msg, &state, c40Values[i] + 96);
-                } else if (encScheme == DmtxSchemeText) {
-                    if (c40Values[i] == 0) {
-                        pushOutputC40TextWord(msg, &state, c40Values[i] + 96);
-                    } else if (c40Values[i] <= 26) {
-                        pushOutputC40TextWord(msg, &state, c40Values[i] - 26 + 'Z'); /* A-Z */
-                    } else {
-                        pushOutputC40TextWord(msg, &state, c40Values[i] - 31 + 127); /* { | } ~ DEL */
-                    }
-                }
+                    break;
+                case DmtxC40TextValueNone:
+                default:
+                    break;
             }
         }
 
@@ -359,12 +489,12 @@ static unsigned char *decodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr,
  * \param ptr
  * \param dataEnd
  * \return Pointer to next undecoded codeword
+ *         NULL if the output buffer is too small
  */
 static unsigned char *decodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
 {
-    int i;
-    int packed;
-    int x12Values[3];
+    int x12Triplet[3];
+    unsigned char *output;
 
     /* Unlatch is implied if only one codeword remains */
     if (dataEnd - ptr < 2) {
@@ -372,28 +502,20 @@ static unsigned char *decodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsi
     }
 
     while (ptr < dataEnd) {
+        /* X12 没有切换字符，每对码字固定输出三个字节 */
+        if (outputHasRoom(msg, 3) == DmtxFalse) {
+            return NULL;
+        }
+
         /* FIXME Also check that ptr+1 is safe to access */
-        packed = (*ptr << 8) | *(ptr + 1);
-        x12Values[0] = ((packed - 1) / 1600);
-        x12Values[1] = ((packed - 1) / 40) % 40;
-        x12Values[2] = (packed - 1) % 40;
+        unpackC40TextTriplet(ptr, x12Triplet);
         ptr += 2;
 
-        for (i = 0; i < 3; i++) {
-            if (x12Values[i] == 0) {
-                pushOutputWord(msg, 13);
-            } else if (x12Values[i] == 1) {
-                pushOutputWord(msg, 42);
-            } else if (x12Values[i] == 2) {
-                pushOutputWord(msg, 62);
-            } else if (x12Values[i] == 3) {
-                pushOutputWord(msg, 32);
-            } else if (x12Values[i] <= 13) {
-                pushOutputWord(msg, x12Values[i] + 44);
-            } else if (x12Values[i] <= 90) {
-                pushOutputWord(msg, x12Values[i] + 51);
-            }
-        }
+        output = msg->output + msg->outputIdx;
+        output[0] = x12Values[x12Triplet[0] + 1];
+        output[1] = x12Values[x12Triplet[1] + 1];
+        output[2] = x12Values[x12Triplet[2] + 1];
+        msg->outputIdx += 3;
 
         /* Unlatch if codeword 254 follows 2 codewords in C40/Text encodation */
         if (*ptr == DmtxValueCTXUnlatch) {
@@ -415,6 +537,7 @@ static unsigned char *decodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsi
  * \param ptr
  * \param dataEnd
  * \return Pointer to next undecoded codeword
+ *         NULL if the output buffer is too small
  */
 static unsigned char *decodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
 {
@@ -443,11 +566,12 @@ static unsigned char *decodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr,
 
             /* Test for unlatch condition */
             if (unpacked[i] == DmtxValueEdifactUnlatch) {
-                DmtxAssert(msg->output[msg->outputIdx] == 0); /* XXX dirty why? */
                 return ptr;
             }
 
-            pushOutputWord(msg, unpacked[i] ^ (((unpacked[i] & 0x20) ^ 0x20) << 1));
+            if (pushOutputWord(msg, unpacked[i] ^ (((unpacked[i] & 0x20) ^ 0x20) << 1)) == DmtxFail) {
+                return NULL;
+            }
         }
 
         /* Unlatch is implied if fewer than 3 codewords remain */
@@ -497,13 +621,15 @@ static unsigned char *decodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr,
  * \param ptr
  * \param dataEnd
  * \return Pointer to next undecoded codeword,
- *         NULL if an error was detected in the stream
+ *         NULL if an error was detected in the stream or the output buffer is too small
  */
 static unsigned char *decodeSchemeBase256(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
 {
     int d0, d1;
     int idx;
+    int pseudoRandom;
     unsigned char *ptrEnd;
+    unsigned char *output;
 
     /* Find positional index used for unrandomizing */
     DmtxAssert(ptr + 1 >= msg->code);
@@ -524,8 +650,26 @@ static unsigned char *decodeSchemeBase256(DmtxMessage *msg, unsigned char *ptr,
         return NULL;
     }
 
+    /* 长度字节本身可能已越过 ptrEnd，此时没有数据 */
+    if (ptr >= ptrEnd) {
+        return ptr;
+    }
+
+    if (outputHasRoom(msg, (size_t)(ptrEnd - ptr)) == DmtxFalse) {
+        return NULL;
+    }
+
+    /* 与 unRandomize255State() 相同，伪随机数 ((149 * idx) % 255) + 1 随 idx 递推，省去逐字节的取模 */
+    pseudoRandom = (149 * idx) % 255;
+    output = msg->output + msg->outputIdx;
+    msg->outputIdx += (int)(ptrEnd - ptr);
+
     while (ptr < ptrEnd) {
-        pushOutputWord(msg, unRandomize255State(*(ptr++), idx++));
+        *(output++) = (unsigned char)(*(ptr++) - pseudoRandom - 1);
+        pseudoRandom += 149;
+        if (pseudoRandom >= 255) {
+            pseudoRandom -= 255;
+        }
     }
 
     return ptr;
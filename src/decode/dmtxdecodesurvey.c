@@ -0,0 +1,238 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodesurvey.c
+ * \brief Coarse frame survey run before scanning
+ *
+ * 在正式扫描之前，以稀疏网格对 ROI 做一次粗略的梯度统计，用于自动选择边缘阈值、
+ * 空帧快速判定以及按显著性排序扫描单元。
+ * 采样复用 getPointFlow，因此统计值与寻边时使用的梯度幅值完全一致。
+ */
+
+#include <stdlib.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+#define DmtxSurveyBins 101
+
+/**
+ * \brief 返回采样点处各通道（或亮度平面）中最强的梯度，幅值按 8 位像素标定
+ */
+static DmtxPointFlow surveyFlow(DmtxDecode *dec, DmtxPixelLoc loc)
+{
+    int i;
+    DmtxPointFlow flow, flowMax;
+
+    if (dec->luma != NULL) {
+        return getPointFlow(dec, DmtxPlaneLuma, loc, dmtxNeighborNone);
+    }
+
+    flowMax = dmtxBlankEdge;
+    flowMax.mag = 0;
+    for (i = 0; i < dec->image->channelCount; i++) {
+        flow = getPointFlow(dec, i, loc, dmtxNeighborNone);
+        flow.mag = (flow.mag * 255) / scaleIntensityThreshold(dec, i, 255);
+        if (flow.mag > flowMax.mag) {
+            flowMax = flow;
+        }
+    }
+
+    return flowMax;
+}
+
+/**
+ * \brief 根据梯度直方图自动选择本帧的边缘阈值
+ *
+ * 在 ROI 内按约 96x96 的稀疏网格采样梯度幅值，换算成 edgeThresh 单位（幅值 / 7.65）
+ * 后建立直方图，用 Otsu 方法在“平坦/噪声”与“边缘”两类之间取分割点作为候选阈值。
+ * 同一解码器处理连续帧时（dmtxDecodeSetImage），候选值与上一帧阈值相差不大时保持不变，
+ * 否则向候选值移动一半，避免阈值随光照抖动。
+ */
+static void decodeSurveyEdgeThresh(DmtxDecode *dec)
+{
+    int x, y, i, step;
+    int bin, count, total;
+    int candidate, previous;
+    int hist[DmtxSurveyBins] = {0};
+    double sum, sumBelow, weightBelow;
+    double meanBelow, meanAbove, between, betweenMax;
+    DmtxPixelLoc loc;
+
+    step = max(min(dec->xMax - dec->xMin, dec->yMax - dec->yMin) / 96, 2);
+
+    total = 0;
+    for (y = dec->yMin + 1; y < dec->yMax; y += step) {
+        for (x = dec->xMin + 1; x < dec->xMax; x += step) {
+            loc.x = x;
+            loc.y = y;
+            bin = (surveyFlow(dec, loc).mag * 100 + 382) / 765;
+            hist[min(bin, DmtxSurveyBins - 1)]++;
+            total++;
+        }
+    }
+
+    dec->edgeThreshValid = DmtxTrue;
+    if (total == 0) {
+        return;
+    }
+
+    /* Otsu: maximize between-class variance */
+    for (sum = 0.0, i = 0; i < DmtxSurveyBins; i++) {
+        sum += (double)i * hist[i];
+    }
+
+    candidate = dec->edgeThresh;
+    betweenMax = 0.0;
+    sumBelow = weightBelow = 0.0;
+    for (i = 0; i < DmtxSurveyBins - 1; i++) {
+        weightBelow += hist[i];
+        sumBelow += (double)i * hist[i];
+        count = total - (int)weightBelow;
+        if (weightBelow == 0.0 || count == 0) {
+            continue;
+        }
+        meanBelow = sumBelow / weightBelow;
+        meanAbove = (sum - sumBelow) / count;
+        between = weightBelow * count * (meanBelow - meanAbove) * (meanBelow - meanAbove);
+        if (between > betweenMax) {
+            betweenMax = between;
+            candidate = i + 1;
+        }
+    }
+    candidate = min(max(candidate, 1), 100);
+
+    /* Hysteresis across frames */
+    previous = dec->edgeThreshPrev;
+    if (previous != DmtxUndefined && abs(candidate - previous) <= max(2, previous / 5)) {
+        candidate = previous;
+    } else if (previous != DmtxUndefined) {
+        candidate = (previous + candidate + 1) / 2;
+    }
+
+    dec->edgeThresh = candidate;
+    dec->edgeThreshPrev = candidate;
+}
+
+/**
+ * \brief 以 step 为间隔采样 ROI，统计每个单元中超过寻边阈值的边缘点的方向直方图
+ *
+ * 单元边长为 cellSize 像素，超出 cellCols x cellRows 的余量并入最后一行/列。
+ * 方向按 getPointFlow 的 4 个罗盘方向（0/45/90/135 度）计数。
+ *
+ * \return 长度为 cellCols * cellRows * 4 的数组（调用者释放），内存不足返回 NULL
+ */
+static int *surveyCellHistogram(DmtxDecode *dec, int step, int cellSize, int cellCols, int cellRows)
+{
+    int x, y;
+    int cellX, cellY, magMin;
+    int *hist;
+    DmtxPixelLoc loc;
+    DmtxPointFlow flow;
+
+    magMin = (int)(dec->edgeThresh * 7.65 + 0.5);
+
+    hist = (int *)calloc((size_t)cellCols * cellRows * 4, sizeof(int));
+    if (hist == NULL) {
+        return NULL;
+    }
+
+    for (y = dec->yMin + 1; y < dec->yMax; y += step) {
+        cellY = min((y - dec->yMin) / cellSize, cellRows - 1);
+        for (x = dec->xMin + 1; x < dec->xMax; x += step) {
+            loc.x = x;
+            loc.y = y;
+            flow = surveyFlow(dec, loc);
+            if (flow.mag >= magMin) {
+                cellX = min((x - dec->xMin) / cellSize, cellCols - 1);
+                hist[(cellY * cellCols + cellX) * 4 + flow.depart % 4]++;
+            }
+        }
+    }
+
+    return hist;
+}
+
+/**
+ * \brief 快速判断当前帧是否可能包含二维码
+ *
+ * 在 ROI 内每隔 2 个像素采样梯度，按 16x16 个采样点划分单元，统计每个单元中超过
+ * 寻边阈值的边缘点数量以及方向直方图。Data Matrix 的 'L' 形边和数据区都由两组互相
+ * 垂直的边缘组成，因此只有同时满足边缘密度和“正交性”（相互垂直的两个方向都有足够的
+ * 边缘点）的单元才被视为候选。
+ *
+ * presenceLevel（1~100）同时决定两个门限：密度 >= level / 400，正交比例 >= level / 200。
+ * 取值越大拒绝越激进，漏检（false negative）的概率也越高。
+ *
+ * \return DmtxTrue 可能存在二维码 | DmtxFalse 几乎可以肯定不存在
+ */
+static DmtxBoolean decodeSurveyPresence(DmtxDecode *dec)
+{
+    int i, step, cellSamples;
+    int cellCols, cellRows;
+    int edges, orth;
+    int *hist;
+    DmtxBoolean present;
+
+    step = 2;
+    cellSamples = 16;
+    cellCols = (dec->xMax - dec->xMin) / (step * cellSamples) + 1;
+    cellRows = (dec->yMax - dec->yMin) / (step * cellSamples) + 1;
+
+    hist = surveyCellHistogram(dec, step, step * cellSamples, cellCols, cellRows);
+    if (hist == NULL) {
+        return DmtxTrue;
+    }
+
+    present = DmtxFalse;
+    for (i = 0; i < cellCols * cellRows && present == DmtxFalse; i++) {
+        edges = hist[i * 4] + hist[i * 4 + 1] + hist[i * 4 + 2] + hist[i * 4 + 3];
+        orth = max(min(hist[i * 4], hist[i * 4 + 2]), min(hist[i * 4 + 1], hist[i * 4 + 3]));
+        if (edges * 400 >= dec->presenceLevel * cellSamples * cellSamples &&
+            orth * 2 * 200 >= dec->presenceLevel * edges) {
+            present = DmtxTrue;
+        }
+    }
+
+    free(hist);
+
+    return present;
+}
+
+/**
+ * \brief 计算扫描单元（dec->scanCellSize）的粗略显著性
+ *
+ * 每隔 4 个像素采样，显著性 = 边缘点数 + 4 * 正交边缘响应（相互垂直的两个方向中较少的一方），
+ * 'L' 形角点和数据区这样同时含有两组垂直边缘的单元排在只有单向边缘的单元之前。
+ *
+ * \return 长度为 scanCellCols * scanCellRows 的数组（调用者释放），内存不足返回 NULL
+ */
+static int *decodeSurveySaliency(DmtxDecode *dec)
+{
+    int i, cellCount;
+    int edges, orth;
+    int *hist, *score;
+
+    cellCount = dec->scanCellCols * dec->scanCellRows;
+
+    hist = surveyCellHistogram(dec, 4, dec->scanCellSize, dec->scanCellCols, dec->scanCellRows);
+    score = (int *)malloc(cellCount * sizeof(int));
+    if (hist == NULL || score == NULL) {
+        free(hist);
+        free(score);
+        return NULL;
+    }
+
+    for (i = 0; i < cellCount; i++) {
+        edges = hist[i * 4] + hist[i * 4 + 1] + hist[i * 4 + 2] + hist[i * 4 + 3];
+        orth = max(min(hist[i * 4], hist[i * 4 + 2]), min(hist[i * 4 + 1], hist[i * 4 + 3]));
+        score[i] = edges + 4 * orth;
+    }
+
+    free(hist);
+
+    return score;
+}
@@ -0,0 +1,157 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodevariant.c
+ * \brief Decode one image with several decoder configurations concurrently
+ *
+ * 难读的符号常常要换几组参数（edgeThresh、scanGap、scale、squareDevn、亮度平面等）逐一尝试。
+ * 这里每组参数由一个配置好的解码器表示，各自在工作线程中对同一幅只读图像执行 dmtxDecodeAll()，
+ * 最先找齐所需符号的变体胜出并取消其余变体，总耗时取决于最快成功的变体而不是所有变体之和。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 用多组解码参数同时解码同一幅图像，最先成功的变体胜出
+ *
+ * 每个变体是一个已设置好属性的解码器（dmtxDecodeCreate() 的 scale 也可以不同），不能重复出现。
+ * 函数对每个解码器调用 dmtxDecodeSetImage(img)，然后在各自的工作线程中执行 dmtxDecodeAll()。
+ * 某个变体找齐 opts->expectedCount 个符号（未设置时为 1 个）即为成功，其余变体随即被取消。
+ * 图像在返回前不能被修改；设置了输出回调的解码器会在工作线程中调用回调。
+ * 无法创建线程时（或定义了 DMTX_NO_THREADS）依次在当前线程执行，成功后不再执行后面的变体。
+ *
+ * \param img 图像，所有变体只读共享
+ * \param dec count 个解码器
+ * \param count 变体数
+ * \param opts 传给 dmtxDecodeAll() 的选项，NULL 表示默认
+ * \param results 胜出变体的结果；没有变体成功时为解码出符号最多的变体的结果。由 dmtxDecodeResultsFree() 释放
+ * \param winner 输出 results 所属的变体下标，没有任何符号时为 DmtxUndefined，可以为 NULL
+ * \return DmtxPass: 有变体成功 | DmtxFail（没有变体成功，或参数无效：解码器为 NULL 或重复出现）
+ */
+extern DmtxPassFail dmtxDecodeVariants(DmtxImage *img, DmtxDecode **dec, int count, DmtxDecodeAllOpts *opts,
+                                       OUT DmtxDecodeResults *results, OUT int *winner)
+{
+    int i, j, best;
+    DmtxVariantRun run;
+    DmtxVariantJob *job;
+
+    if (winner != NULL) {
+        *winner = DmtxUndefined;
+    }
+    if (results == NULL) {
+        return DmtxFail;
+    }
+    memset(results, 0x00, sizeof(DmtxDecodeResults));
+
+    if (img == NULL || dec == NULL || count <= 0) {
+        return DmtxFail;
+    }
+    /* 同一个解码器出现两次会被两个线程同时使用 */
+    for (i = 0; i < count; i++) {
+        if (dec[i] == NULL) {
+            return DmtxFail;
+        }
+        for (j = 0; j < i; j++) {
+            if (dec[j] == dec[i]) {
+                return DmtxFail;
+            }
+        }
+    }
+
+    job = (DmtxVariantJob *)calloc(count, sizeof(DmtxVariantJob));
+    if (job == NULL) {
+        return DmtxFail;
+    }
+
+    run.img = img;
+    run.dec = dec;
+    run.opts = opts;
+    run.count = count;
+    run.required = (opts != NULL && opts->expectedCount > 0) ? opts->expectedCount : 1;
+    run.winner = DmtxUndefined;
+
+    for (i = 0; i < count; i++) {
+        job[i].idx = i;
+        job[i].run = &run;
+        job[i].started = (threadStart(&job[i].thread, variantRun, &job[i]) == DmtxPass) ? DmtxTrue : DmtxFalse;
+    }
+
+    /* 没能创建线程的变体在当前线程执行 */
+    for (i = 0; i < count; i++) {
+        if (job[i].started == DmtxFalse) {
+            variantRun(&job[i]);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (job[i].started == DmtxTrue) {
+            threadJoin(&job[i].thread);
+        }
+    }
+
+    best = (int)run.winner;
+    if (best == DmtxUndefined) {
+        for (i = 0; i < count; i++) {
+            if (job[i].results.count > 0 && (best == DmtxUndefined || job[i].results.count > job[best].results.count)) {
+                best = i;
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (i == best) {
+            *results = job[i].results;
+        } else {
+            dmtxDecodeResultsFree(&job[i].results);
+        }
+    }
+    free(job);
+
+    if (winner != NULL) {
+        *winner = best;
+    }
+
+    return (run.winner != DmtxUndefined) ? DmtxPass : DmtxFail;
+}
+
+/**
+ * \brief 执行一个变体，成功且是第一个成功的变体时取消其余变体
+ */
+static void variantRun(void *arg)
+{
+    int i;
+    DmtxVariantJob *job = (DmtxVariantJob *)arg;
+    DmtxVariantRun *run = job->run;
+    DmtxDecode *dec = run->dec[job->idx];
+
+    if (dmtxDecodeSetImage(dec, run->img) == DmtxFail) {
+        return;
+    }
+
+    /*
+     * dmtxDecodeSetImage() 会清除取消标志，胜出者可能在此之前已经发出取消。
+     * 用 CAS 读取 winner（完整的内存屏障），保证要么看到胜出者，要么胜出者的取消在清除之后生效。
+     */
+    if (!DmtxAtomicCasLong(&run->winner, DmtxUndefined, DmtxUndefined)) {
+        return;
+    }
+
+    dmtxDecodeAll(dec, run->opts, &job->results);
+
+    if (job->results.count < run->required || !DmtxAtomicCasLong(&run->winner, DmtxUndefined, job->idx)) {
+        return;
+    }
+
+    for (i = 0; i < run->count; i++) {
+        if (i != job->idx) {
+            dmtxDecodeCancel(run->dec[i]);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxdecodeverify.c
+ * \brief Verify captured symbols against an expected payload
+ *
+ * 打印校验时内容事先已知：把期望内容用编码器编码一次，得到期望的模块矩阵，
+ * 之后每个区域只需采样判定模块并逐个比较，不做码字排布、纠错和数据解码。
+ * 不一致的模块数和分布可以反映打印质量的退化。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 设置期望内容，之后可用 dmtxDecodeVerifyRegion() 校验区域
+ *
+ * 期望内容按 dec 的 fnc1 设置编码，须与打印时的编码参数一致，否则模块矩阵不同。
+ *
+ * \param dec 解码上下文
+ * \param inputSize 期望内容的字节数
+ * \param inputString 期望内容，NULL 表示清除
+ * \param sizeIdxRequest 尺寸索引，或 DmtxSymbolSquareAuto / DmtxSymbolRectAuto
+ * \param scheme 编码方案，打印时未指定则为 DmtxSchemeAscii
+ * \return DmtxPass | DmtxFail（无法编码或内存不足，此时期望内容被清除）
+ */
+extern DmtxPassFail dmtxDecodeSetExpected(DmtxDecode *dec, int inputSize, unsigned char *inputString,
+                                          int sizeIdxRequest, int scheme)
+{
+    int sizeIdx;
+    DmtxByte outputStorage[4096];
+    DmtxByteList input, output;
+    DmtxMessage *msg;
+
+    if (dec == NULL) {
+        return DmtxFail;
+    }
+
+    free(dec->expected.array);
+    dec->expected.array = NULL;
+    dec->expected.arraySize = 0;
+    dec->expected.sizeIdx = DmtxUndefined;
+
+    if (inputString == NULL) {
+        return DmtxPass;
+    }
+    if (inputSize <= 0) {
+        return DmtxFail;
+    }
+
+    input = dmtxByteListBuild(inputString, inputSize);
+    input.length = inputSize;
+    output = dmtxByteListBuild(outputStorage, sizeof(outputStorage));
+
+    sizeIdx = encodeDataCodewords(&input, &output, sizeIdxRequest, (DmtxScheme)scheme, dec->fnc1);
+    if (sizeIdx == DmtxUndefined || output.length <= 0) {
+        return DmtxFail;
+    }
+
+    msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+    if (msg == NULL) {
+        return DmtxFail;
+    }
+
+    memcpy(msg->code, output.b, output.length);
+    rsEncode(msg, sizeIdx);
+    modulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRGB);
+
+    /* 只保留模块矩阵 */
+    dec->expected.array = msg->array;
+    dec->expected.arraySize = msg->arraySize;
+    dec->expected.sizeIdx = sizeIdx;
+    msg->array = NULL;
+    dmtxMessageDestroy(&msg);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 逐个模块比较区域与期望内容
+ *
+ * 模块按解码时的默认方式（DmtxModuleThreshTally）判定。判定需要整个区域的采样结果，
+ * 因此总是比较全部模块，mismatchCount 与 map 都是完整的，maxMismatch 只决定返回值。
+ * 校验失败时不一定是打印错误，调用者可以再用 dmtxDecodeMatrixRegion() 解码确认。
+ *
+ * \param dec 解码上下文，须已调用 dmtxDecodeSetExpected()
+ * \param reg 区域
+ * \param maxMismatch 允许不一致的模块数
+ * \param result 比较结果，map 由 dmtxVerifyResultFree() 释放
+ * \return DmtxPass: 不一致的模块数不超过 maxMismatch | DmtxFail: 超过、尺寸不同或无法比较
+ */
+extern DmtxPassFail dmtxDecodeVerifyRegion(DmtxDecode *dec, DmtxRegion *reg, int maxMismatch,
+                                           OUT DmtxVerifyResult *result)
+{
+    size_t i;
+    unsigned char *expected;
+    DmtxMessage array;
+    DmtxModuleSamples samples;
+
+    if (result == NULL) {
+        return DmtxFail;
+    }
+    memset(result, 0x00, sizeof(DmtxVerifyResult));
+    result->sizeIdx = DmtxUndefined;
+    result->mismatchCount = DmtxUndefined;
+
+    if (dec == NULL || reg == NULL || dec->expected.array == NULL || maxMismatch < 0) {
+        return DmtxFail;
+    }
+
+    result->sizeIdx = dec->expected.sizeIdx;
+    if (reg->sizeIdx != dec->expected.sizeIdx) {
+        return DmtxFail;
+    }
+
+    if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+        return DmtxFail;
+    }
+
+    result->map = (unsigned char *)malloc(dec->expected.arraySize);
+    if (result->map == NULL) {
+        return DmtxFail;
+    }
+    result->mapRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, reg->sizeIdx);
+    result->mapCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, reg->sizeIdx);
+
+    if (sampleModuleColors(dec, reg, &samples) != DmtxPass) {
+        dmtxVerifyResultFree(result);
+        return DmtxFail;
+    }
+
+    cacheFillRegion(dec, reg);
+
+    /* 判定结果直接写入 map，比较时原地改写为不一致标记 */
+    memset(&array, 0x00, sizeof(DmtxMessage));
+    array.array = result->map;
+    array.arraySize = dec->expected.arraySize;
+    populateArrayFromMatrix(reg, &samples, DmtxModuleThreshTally, &array);
+    free(samples.color);
+
+    expected = dec->expected.array;
+    result->mismatchCount = 0;
+    for (i = 0; i < array.arraySize; i++) {
+        if (((result->map[i] & DmtxModuleOnRGB) != 0) != ((expected[i] & DmtxModuleOnRGB) != 0)) {
+            result->map[i] = 1;
+            result->mismatchCount++;
+        } else {
+            result->map[i] = 0;
+        }
+    }
+
+    return (result->mismatchCount <= maxMismatch) ? DmtxPass : DmtxFail;
+}
+
+/**
+ * \brief 释放 dmtxDecodeVerifyRegion() 分配的不一致分布
+ */
+extern void dmtxVerifyResultFree(DmtxVerifyResult *result)
+{
+    if (result == NULL) {
+        return;
+    }
+
+    free(result->map);
+    result->map = NULL;
+}
@@ -39,7 +39,13 @@
  */
 
 #include "decode/dmtxdecode.c"
+#include "decode/dmtxdecodecache.c"
+#include "decode/dmtxdecodeverify.c"
+#include "decode/dmtxdecodepipeline.c"
+#include "decode/dmtxdecodeplane.c"
 #include "decode/dmtxdecodescheme.c"
+#include "decode/dmtxdecodesurvey.c"
+#include "decode/dmtxdecodevariant.c"
 #include "dmtxcallback.c"
 #include "dmtxmessage.c"
 #include "dmtxplacemod.c"
@@ -59,6 +65,8 @@
 #include "utils/dmtximage.c"
 #include "utils/dmtxlog.c"
 #include "utils/dmtxmatrix3.c"
+#include "utils/dmtxring.c"
+#include "utils/dmtxthread.c"
 #include "utils/dmtxtime.c"
 #include "utils/dmtxvector2.c"
 
@@ -59,7 +59,7 @@ extern "C"
 #define DmtxModuleOnBlue 0x04        /**< 蓝 */
 #define DmtxModuleOnRGB 0x07         /**< OnRed | OnGreen | OnBlue */
 #define DmtxModuleOn DmtxModuleOnRGB /**< bit1 */
-#define DmtxModuleUnsure 0x08        /**< 不确定 */
+#define DmtxModuleUnsure 0x08        /**< 不确定，所在码字在纠错失败时作为擦除位置 */
 #define DmtxModuleAssigned 0x10      /**< 已分配 */
 #define DmtxModuleVisited 0x20       /**< 已访问 */
 #define DmtxModuleData 0x40
@@ -191,6 +191,19 @@ extern "C"
         DmtxPropSquareDevn,    /**<  */
         DmtxPropSymbolSize,    /**<  */
         DmtxPropEdgeThresh,    /**<  */
+        DmtxPropLumaPlane,     /**< 1: 预先生成 8 位亮度平面，只在该平面上寻边和采样（彩色图像提速） */
+        DmtxPropBinarize,      /**< 扫描前的局部自适应二值化方式 \ref DmtxBinarize */
+        DmtxPropBinarizeRadius, /**< 二值化窗口半径（缩放后像素，至少为 1），默认 DmtxUndefined 表示按图像尺寸自动选择 */
+        DmtxPropEdgeThreshAuto, /**< 1: 每帧根据梯度直方图自动选择 edgeThresh，结果通过 DmtxPropEdgeThresh 读取 */
+        DmtxPropPresenceLevel,  /**< 扫描前的空帧快速判定，0 关闭，1~100 越大拒绝越激进（漏检率越高） */
+        DmtxPropScanOrder,      /**< 扫描位置的访问顺序 \ref DmtxScanOrder */
+        DmtxPropDeadlineExpired, /**< 只读：最近的寻找或解码因截止时间或取消而放弃时为 1 */
+        DmtxPropScanProgress,    /**< 只读：本帧扫描位置的完成度，0~1000 */
+        DmtxPropScanWork,        /**< 只读：本帧 dmtxDecodeStep() 已完成的工作量 */
+        DmtxPropModuleRetry,     /**< 1: 纠错失败时用缓存的模块颜色换用其他阈值策略重试（默认），0: 关闭 */
+        DmtxPropResultCacheSize, /**< 解码结果缓存最多保存的符号数，0 表示关闭（默认） */
+        DmtxPropResultCacheHits,   /**< 只读：解码结果缓存的命中次数 */
+        DmtxPropResultCacheMisses, /**< 只读：解码结果缓存的未命中次数 */
 
         /* 图像属性 \ref DmtxImage */
         DmtxPropWidth = 300,   /**< 图像宽度 */
@@ -199,9 +212,10 @@ extern "C"
         DmtxPropBitsPerPixel,  /**< 每像素所需要的bit数 */
         DmtxPropBytesPerPixel, /**< 每像素所需要的byte数 */
         DmtxPropRowPadBytes,   /**< 每行像素在内存中的填充或对齐字节数 */
-        DmtxPropRowSizeBytes,  /**< 每一行（包括填充）在内存中的总字节数 */
+        DmtxPropRowSizeBytes,  /**< 每一行（包括填充）在内存中的总字节数，即行跨度（stride） */
         DmtxPropImageFlip,     /**< 图像是否需要翻转，通常用于处理上下颠倒的图像 \ref DmtxFlip */
         DmtxPropChannelCount,  /**< 图像通道数 */
+        DmtxPropSignificantBits, /**< 16 位灰度图像每像素的有效位数（9~16，低位对齐） */
 
         /* Image modifiers */
         DmtxPropXmin = 400, /**< ROI X坐标最小值(如果未设置则为0) */
@@ -227,6 +241,8 @@ extern "C"
         DmtxPack16bppBGRX,
         DmtxPack16bppXBGR,
         DmtxPack16bppYCbCr,
+        DmtxPack16bppK,   /**< 16 bpp grayscale, little endian */
+        DmtxPack16bppKBE, /**< 16 bpp grayscale, big endian */
         /* 24 bpp formats */
         DmtxPack24bppRGB = 500,
         DmtxPack24bppBGR,
@@ -236,9 +252,42 @@ extern "C"
         DmtxPack32bppXRGB,
         DmtxPack32bppBGRX,
         DmtxPack32bppXBGR,
-        DmtxPack32bppCMYK
+        DmtxPack32bppCMYK,
+        /* YUV formats (only the luma plane is read, pxl points to Y) */
+        DmtxPackYUYV = 700, /**< packed 4:2:2, Y0 U Y1 V, 2 bytes per pixel */
+        DmtxPackUYVY,       /**< packed 4:2:2, U Y0 V Y1, 2 bytes per pixel */
+        DmtxPackNV12,       /**< semi-planar 4:2:0, Y plane followed by interleaved UV */
+        DmtxPackNV21,       /**< semi-planar 4:2:0, Y plane followed by interleaved VU */
+        DmtxPackI420,       /**< planar 4:2:0, Y, U, V planes */
+        DmtxPackYV12,       /**< planar 4:2:0, Y, V, U planes */
+        /* 8 bpp raw Bayer mosaics (named by the top-left 2x2 cell) */
+        DmtxPackBayerRGGB = 800,
+        DmtxPackBayerBGGR,
+        DmtxPackBayerGRBG,
+        DmtxPackBayerGBRG
     } DmtxPackOrder;
 
+    typedef enum DmtxBinarize_enum
+    {
+        DmtxBinarizeNone,      /**< 不做二值化（默认） */
+        DmtxBinarizeLocalMean, /**< 低于局部均值一定偏移的像素判为暗 */
+        DmtxBinarizeSauvola    /**< Sauvola 阈值，m * (1 + k * (s / R - 1)) */
+    } DmtxBinarize;
+
+    typedef enum DmtxScanOrder_enum
+    {
+        DmtxScanOrderRaster,  /**< 整个 ROI 由粗到细的十字网格（默认） */
+        DmtxScanOrderSaliency, /**< 按粗略显著性图从高到低逐个单元扫描，覆盖范围不变 */
+        DmtxScanOrderTiled     /**< 按 Morton 顺序逐块扫描，适合大图像（cache 友好），覆盖范围不变 */
+    } DmtxScanOrder;
+
+    typedef enum DmtxStepStatus_enum
+    {
+        DmtxStepYield, /**< 工作量已用完，再次调用 dmtxDecodeStep() 从中断处继续 */
+        DmtxStepFound, /**< 找到一个区域 */
+        DmtxStepDone   /**< 本帧已扫描完，或截止时间已过/已被取消（见 DmtxPropDeadlineExpired） */
+    } DmtxStepStatus;
+
     typedef enum DmtxFlip_enum
     {
         DmtxFlipNone = 0x00,
@@ -305,6 +354,27 @@ extern "C"
         DmtxByte *b;
     } DmtxByteList;
 
+    /**
+     * \brief 一种符号尺寸的全部属性，字段与 DmtxSymAttribute 一一对应，见 dmtxGetSymbolInfo()
+     */
+    typedef struct DmtxSymbolInfo_struct
+    {
+        int symbolRows;           /**< 二维码码元总行数（包括L形框和点线）*/
+        int symbolCols;           /**< 二维码码元总列数（包括L形框和点线）*/
+        int dataRegionRows;       /**< 单区块二维码数据区码元行数 */
+        int dataRegionCols;       /**< 单区块二维码数据区码元列数 */
+        int horizDataRegions;     /**< 水平方向区块个数 */
+        int vertDataRegions;      /**< 垂直方向区块个数 */
+        int mappingRows;          /**< 二维码数据区码元总行数 */
+        int mappingCols;          /**< 二维码数据区码元总列数 */
+        int interleavedBlocks;    /**< 交织的纠错码块数 */
+        int blockErrorWords;      /**< 每个码块的纠错码字数 */
+        int blockMaxCorrectable;  /**< 每个码块最多可纠正的码字数 */
+        int symbolDataWords;      /**< 数据码字总数 */
+        int symbolErrorWords;     /**< 纠错码字总数 */
+        int symbolMaxCorrectable; /**< 最多可纠正的码字总数 */
+    } DmtxSymbolInfo;
+
     typedef struct DmtxEncodeStream_struct
     {
         int currentScheme;         /* Current encodation scheme */
@@ -428,8 +498,39 @@ extern "C"
         unsigned char *array;  /**< 指向DataMatrix数据区二进制矩阵的指针 */
         unsigned char *code;   /**< 指向码字（数据字和纠错字）的指针 */
         unsigned char *output; /**< 指向二维码码值的指针 */
+        int outputExternal;    /**< output 位于 dmtxDecodeSetOutputBuffer() 提供的缓冲区，销毁消息时不释放 */
     } DmtxMessage;
 
+    /**
+     * \brief dmtxDecodeAll() 的选项
+     */
+    typedef struct DmtxDecodeAllOpts_struct
+    {
+        int maxCount;      /**< 解码成功这么多个符号后停止，DmtxUndefined 表示取 expectedCount */
+        int expectedCount; /**< 期望的符号数，不足时返回 DmtxFail，DmtxUndefined 表示不检查 */
+        int fix;           /**< 传给 dmtxDecodeMatrixRegion() 的纠错上限，DmtxUndefined 表示不限 */
+    } DmtxDecodeAllOpts;
+
+    /**
+     * \brief dmtxDecodeAll() 解码出的一个符号
+     */
+    typedef struct DmtxDecodeResult_struct
+    {
+        DmtxMessage *message;    /**< 解码内容，由 dmtxDecodeResultsFree() 释放 */
+        DmtxRegion region;       /**< 符号所在区域 */
+        DmtxVector2 corners[4];  /**< 原图坐标中的四个角，依次为二维码坐标 (0,0) (1,0) (1,1) (0,1) */
+    } DmtxDecodeResult;
+
+    /**
+     * \brief dmtxDecodeAll() 的结果列表
+     */
+    typedef struct DmtxDecodeResults_struct
+    {
+        int count;                /**< 解码成功的符号数 */
+        int capacity;             /**< result 数组的容量 */
+        DmtxDecodeResult *result; /**< 按找到的先后排列 */
+    } DmtxDecodeResults;
+
     /**
      * \struct DmtxScanGrid
      * \brief DmtxScanGrid
@@ -469,6 +570,129 @@ extern "C"
         unsigned long usec;
     } DmtxTime;
 
+    /**
+     * \struct DmtxDeadline
+     * \brief 解码截止时间与取消标志，在各耗时阶段的循环内定期检查
+     */
+    typedef struct DmtxDeadline_struct
+    {
+        DmtxTime time;        /* 截止时间（单调时钟），active 时有效 */
+        int active;           /* 是否设置了截止时间 */
+        int expired;          /* 已超时或已取消，置位后保持到重新设置 */
+        int abandoned;        /* 有阶段因超时或取消而放弃，即 DmtxPropDeadlineExpired */
+        int countdown;        /* 距离下一次读取时钟的剩余检查次数 */
+        volatile int *cancel; /* 跨线程取消标志，单独分配以便解码副本共用，由 dmtxDecodeCancel() 置位 */
+    } DmtxDeadline;
+
+    /**
+     * \struct DmtxTrailBlaze
+     * \brief 连续寻边的中间状态，可以分多次推进
+     */
+    typedef struct DmtxTrailBlaze_struct
+    {
+        int sign;                /* 当前方向，+1 正向，-1 负向，小于 -1 表示两个方向都已完成 */
+        int steps;               /* 当前方向已走的步数 */
+        int posAssigns;          /* 正向标记的像素数 */
+        int negAssigns;          /* 负向标记的像素数 */
+        int magMin;              /* 继续寻边所需的最小梯度 */
+        int maxDiagonal;         /* 包围框对角线上限，DmtxUndefined 表示不限 */
+        unsigned char *cache;    /* 当前位置的缓存 */
+        unsigned char *cacheBeg; /* 起点的缓存 */
+        DmtxPointFlow flow;      /* 当前位置 */
+    } DmtxTrailBlaze;
+
+    /**
+     * \struct DmtxSizeSearch
+     * \brief 符号尺寸搜索的中间状态，每次推进测试一个模板
+     */
+    typedef struct DmtxSizeSearch_struct
+    {
+        int sizeIdx;         /* 下一个要测试的模板 */
+        int sizeIdxEnd;      /* 测试范围的结束（不含） */
+        int contrastMin;     /* 模板有效所需的最小对比度 */
+        int bestSizeIdx;     /* 目前对比度最大的模板 */
+        int bestContrast;    /* */
+        int bestColorOnAvg;  /* */
+        int bestColorOffAvg; /* */
+    } DmtxSizeSearch;
+
+    /**
+     * \struct DmtxScanState
+     * \brief dmtxDecodeStep() 在两次调用之间保存的候选区域进度
+     */
+    typedef struct DmtxScanState_struct
+    {
+        int stage;            /* 当前阶段（内部使用） */
+        long work;            /* 本帧已完成的工作量 */
+        DmtxRegion reg;       /* 正在拟合的候选区域 */
+        DmtxTrailBlaze blaze; /* */
+        DmtxSizeSearch size;  /* */
+    } DmtxScanState;
+
+    /**
+     * \struct DmtxResultCacheEntry
+     * \brief 解码结果缓存中的一个符号
+     */
+    typedef struct DmtxResultCacheEntry_struct
+    {
+        unsigned int hash;     /* key 的散列值 */
+        int sizeIdx;           /* 符号尺寸 */
+        int fnc1;              /* 解码时的 FNC1 替代字符 */
+        int fix;               /* 解码时的纠错级别 */
+        long lastUse;          /* 最近一次使用时的 tick，用于淘汰最久未用的结果 */
+        int padCount;          /* */
+        int outputIdx;         /* 输出的字节数 */
+        unsigned char *key;    /* 码字排布前的模块矩阵（arraySize 字节），code 与 output 紧随其后 */
+        unsigned char *code;   /* 纠错后的码字（codeSize 字节） */
+        unsigned char *output; /* 解码输出（outputIdx 字节） */
+    } DmtxResultCacheEntry;
+
+    /**
+     * \struct DmtxResultCache
+     * \brief 以采样得到的模块矩阵为键的解码结果缓存，相同的符号再次出现时跳过码字排布、纠错和数据解码
+     */
+    typedef struct DmtxResultCache_struct
+    {
+        int capacity;                /* 最多保存的符号数，0 表示关闭 */
+        int count;                   /* 已保存的符号数 */
+        long tick;                   /* 每次命中或保存加 1 */
+        long hits;                   /* 命中次数 */
+        long misses;                 /* 未命中次数 */
+        size_t scratchSize;          /* scratch 的字节数 */
+        unsigned char *scratch;      /* 解码前的模块矩阵副本，解码成功后作为新结果的 key */
+        DmtxResultCacheEntry *entry; /* capacity 个结果 */
+    } DmtxResultCache;
+
+    /**
+     * \struct DmtxExpected
+     * \brief dmtxDecodeSetExpected() 编码得到的期望模块矩阵
+     */
+    typedef struct DmtxExpected_struct
+    {
+        int sizeIdx;          /* 期望的尺寸索引，DmtxUndefined 表示未设置 */
+        size_t arraySize;     /* array 的字节数 */
+        unsigned char *array; /* 码字排布后的模块矩阵，DmtxModuleOnRGB 位表示深色模块 */
+    } DmtxExpected;
+
+    /**
+     * \brief dmtxDecodeVerifyRegion() 的比较结果
+     */
+    typedef struct DmtxVerifyResult_struct
+    {
+        int sizeIdx;        /**< 期望的尺寸索引 */
+        int mapRows;        /**< map 的行数（映射矩阵行数，不含 L 形框和点线） */
+        int mapCols;        /**< map 的列数 */
+        int mismatchCount;  /**< 不一致的模块数，DmtxUndefined 表示未比较 */
+        unsigned char *map; /**< 与 msg->array 同序，1 表示该模块不一致，由 dmtxVerifyResultFree() 释放 */
+    } DmtxVerifyResult;
+
+    /**
+     * \brief 解码输出回调，每个解码成功的符号调用一次
+     *
+     * data 指向消息的输出（即 msg->output），length 为输出字节数，回调返回后数据仍归消息所有。
+     */
+    typedef void (*DmtxOutputSink)(void *userData, const unsigned char *data, size_t length);
+
     /**
      * \struct DmtxDecode
      * \brief DmtxDecode
@@ -483,6 +707,20 @@ extern "C"
         double squareDevn;
         int sizeIdxExpected;
         int edgeThresh;
+        int lumaPlane;
+        int binarize;
+        int binarizeRadius;
+        int edgeThreshAuto;
+        int presenceLevel;
+        int scanOrder;
+        int moduleRetry;
+
+        /* Output destination */
+        unsigned char *outputBuf;  /* 调用者提供的输出缓冲区，NULL 表示每个消息自行分配 */
+        size_t outputBufSize;      /* outputBuf 的总字节数 */
+        size_t outputBufUsed;      /* 已被解码成功的消息占用的字节数 */
+        DmtxOutputSink outputSink; /* 解码成功后的输出回调，NULL 表示不回调 */
+        void *outputSinkData;      /* 传给 outputSink 的用户数据 */
 
         /* Image modifiers */
         int xMin;
@@ -494,6 +732,20 @@ extern "C"
         /* Internals */
         /* int             cacheComplete; */
         unsigned char *cache;
+        unsigned char *luma; /* 缩放分辨率下的亮度平面，未启用时为 NULL */
+        int edgeThreshValid; /* 自动阈值已为当前帧计算 */
+        int edgeThreshPrev;  /* 上一帧的自动阈值，用于滞回 */
+        int presenceState;   /* 空帧判定结果，DmtxUndefined 表示当前帧尚未判定 */
+        int *scanCells;      /* 按单元扫描时的单元访问顺序 */
+        int scanCellCount;   /* 单元数量，0 表示尚未生成，DmtxUndefined 表示本帧生成失败 */
+        int scanCellIdx;     /* 当前扫描的单元在 scanCells 中的位置 */
+        int scanCellCols;
+        int scanCellRows;
+        int scanCellSize;
+        DmtxDeadline deadline;
+        DmtxResultCache resultCache;
+        DmtxExpected expected;
+        DmtxScanState step;
         DmtxImage *image;
         DmtxScanGrid grid;
     } DmtxDecode;
@@ -580,6 +832,11 @@ extern "C"
     /* dmtxdecode.c */
     extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale);
     extern DmtxPassFail dmtxDecodeDestroy(DmtxDecode **dec);
+    extern DmtxPassFail dmtxDecodeSetImage(DmtxDecode *dec, DmtxImage *img);
+    extern DmtxPassFail dmtxDecodeSetDeadline(DmtxDecode *dec, DmtxTime *deadline);
+    extern DmtxPassFail dmtxDecodeCancel(DmtxDecode *dec);
+    extern DmtxPassFail dmtxDecodeSetOutputBuffer(DmtxDecode *dec, unsigned char *buf, size_t size);
+    extern DmtxPassFail dmtxDecodeSetOutputSink(DmtxDecode *dec, DmtxOutputSink sink, void *userData);
     extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value);
     extern int dmtxDecodeGetProp(DmtxDecode *dec, int prop);
     extern /*@exposed@*/ unsigned char *dmtxDecodeGetCache(DmtxDecode *dec, int x, int y);
@@ -587,13 +844,31 @@ extern "C"
     extern DmtxMessage *dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
     extern DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, INOUT DmtxMessage *msg, int fix);
     extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
+    extern DmtxPassFail dmtxDecodeAll(DmtxDecode *dec, DmtxDecodeAllOpts *opts, OUT DmtxDecodeResults *results);
+    extern void dmtxDecodeResultsFree(DmtxDecodeResults *results);
     extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, OUT int *totalBytes, OUT int *headerBytes,
                                                      int style);
 
+    /* dmtxdecodepipeline.c */
+    extern DmtxPassFail dmtxDecodePipeline(DmtxDecode *dec, int workers, DmtxDecodeAllOpts *opts,
+                                           OUT DmtxDecodeResults *results);
+
+    /* dmtxdecodevariant.c */
+    extern DmtxPassFail dmtxDecodeVariants(DmtxImage *img, DmtxDecode **dec, int count, DmtxDecodeAllOpts *opts,
+                                           OUT DmtxDecodeResults *results, OUT int *winner);
+
+    /* dmtxdecodeverify.c */
+    extern DmtxPassFail dmtxDecodeSetExpected(DmtxDecode *dec, int inputSize, unsigned char *inputString,
+                                              int sizeIdxRequest, int scheme);
+    extern DmtxPassFail dmtxDecodeVerifyRegion(DmtxDecode *dec, DmtxRegion *reg, int maxMismatch,
+                                               OUT DmtxVerifyResult *result);
+    extern void dmtxVerifyResultFree(DmtxVerifyResult *result);
+
     /* dmtxregion.c */
     extern DmtxRegion *dmtxRegionCreate(DmtxRegion *reg);
     extern DmtxPassFail dmtxRegionDestroy(DmtxRegion **reg);
     extern DmtxRegion *dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout);
+    extern int dmtxDecodeStep(DmtxDecode *dec, int workUnits, OUT DmtxRegion **reg);
     extern DmtxRegion *dmtxRegionScanPixel(DmtxDecode *dec, int x, int y);
     extern DmtxPassFail dmtxRegionUpdateCorners(DmtxDecode *dec, DmtxRegion *reg, DmtxVector2 p00, DmtxVector2 p10,
                                                 DmtxVector2 p11, DmtxVector2 p01);
@@ -605,6 +880,7 @@ extern "C"
 
     /* dmtximage.c */
     extern DmtxImage *dmtxImageCreate(unsigned char *pxl, int width, int height, int pack);
+    extern DmtxImage *dmtxImageCreateView(unsigned char *pxl, int width, int height, int strideBytes, int pack);
     extern DmtxPassFail dmtxImageDestroy(DmtxImage **img);
     extern DmtxPassFail dmtxImageSetChannel(DmtxImage *img, int channelStart, int bitsPerChannel);
     extern DmtxPassFail dmtxImageSetProp(DmtxImage *img, int prop, int value);
@@ -650,6 +926,7 @@ extern "C"
 
     /* dmtxsymbol.c */
     extern int dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int symbolCol);
+    extern const DmtxSymbolInfo *dmtxGetSymbolInfo(int sizeIdx);
     extern int dmtxGetSymbolAttribute(int attribute, int sizeIdx);
     extern int dmtxGetBlockDataSize(int sizeIdx, int blockIdx);
     extern int getSizeIdxFromSymbolDimension(int rows, int cols);
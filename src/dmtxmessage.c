@@ -28,6 +28,19 @@
  * \return Address of allocated memory
  */
 extern DmtxMessage *dmtxMessageCreate(int sizeIdx, int symbolFormat)
+{
+    return messageCreate(sizeIdx, symbolFormat, NULL, 0);
+}
+
+/**
+ * \brief dmtxMessageCreate() 的实现，可以让输出直接写入调用者的缓冲区
+ * \param sizeIdx
+ * \param symbolFormat DmtxFormatMatrix | DmtxFormatMosaic
+ * \param output 调用者提供的输出缓冲区，NULL 表示自行分配；消息销毁时不释放调用者的缓冲区
+ * \param outputSize output 的字节数
+ * \return Address of allocated memory
+ */
+static DmtxMessage *messageCreate(int sizeIdx, int symbolFormat, unsigned char *output, size_t outputSize)
 {
     DmtxMessage *message;
     int mappingRows, mappingCols;
@@ -65,6 +78,13 @@ extern DmtxMessage *dmtxMessageCreate(int sizeIdx, int symbolFormat)
         return NULL;
     }
 
+    if (output != NULL) {
+        message->outputSize = outputSize;
+        message->output = output;
+        message->outputExternal = DmtxTrue;
+        return message;
+    }
+
     /* XXX not sure if this is the right place or even the right approach.
        Trying to allocate memory for the decoded data stream and will
        initially assume that decoded data will not be larger than 2x encoded data */
@@ -98,7 +118,7 @@ extern DmtxPassFail dmtxMessageDestroy(DmtxMessage **msg)
         free((*msg)->code);
     }
 
-    if ((*msg)->output != NULL) {
+    if ((*msg)->output != NULL && (*msg)->outputExternal != DmtxTrue) {
         free((*msg)->output);
     }
 
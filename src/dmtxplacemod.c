@@ -33,11 +33,12 @@ int dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int
     int mappingRow, mappingCol;
     int dataRegionRows, dataRegionCols;
     int symbolRows, mappingCols;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(sizeIdx);
 
-    dataRegionRows = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionRows, sizeIdx);
-    dataRegionCols = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionCols, sizeIdx);
-    symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-    mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+    dataRegionRows = info->dataRegionRows;
+    dataRegionCols = info->dataRegionCols;
+    symbolRows = info->symbolRows;
+    mappingCols = info->mappingCols;
 
     symbolRowReverse = symbolRows - symbolRow - 1;
     mappingRow = symbolRowReverse - 1 - 2 * (symbolRowReverse / (dataRegionRows + 2));
@@ -62,24 +63,134 @@ int dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int
     return (message->array[mappingRow * mappingCols + mappingCol] | DmtxModuleData);
 }
 
+/* 每种符号尺寸的码字排布表，首次使用时生成，之后只读并在线程间共享 */
+static DmtxPlacementMap *volatile placementMaps[DmtxSymbolSquareCount + DmtxSymbolRectCount];
+
 /**
  * \brief 通过DataMatrix数据区的二进制矩阵，根据DataMatrix的排列规则，得到码字(codewords)
  *
+ * 码字的每一位对应哪个模块由 getPlacementMap() 预先生成的排布表给出，这里只是按表读取（解码）或写入（编码）。
+ * 模块已带有 DmtxModuleAssigned 时从模块读取该位，否则把该位写入模块并标记 DmtxModuleAssigned。
+ *
  * \param[in,out] modules DataMatrix数据区矩阵
  * \param[out] codewords 存储码字的数组
  * \param[in] sizeIdx DataMatrix符号种类索引
  * \param[in] moduleOnColor 指定模块颜色属性的标志，如红色、绿色或蓝色
+ * \return 读写的码字数
  */
 static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char *codewords, int sizeIdx,
                                  int moduleOnColor)
+{
+    int chr, bit, mask, lastIdx;
+    const unsigned short *moduleIdx;
+    const DmtxPlacementMap *map;
+    unsigned char *module;
+
+    DmtxAssert(moduleOnColor & (DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue));
+
+    map = getPlacementMap(sizeIdx);
+    if (map == NULL) {
+        return 0;
+    }
+
+    for (chr = 0, moduleIdx = map->moduleIdx; chr < map->codewordCount; chr++) {
+        for (bit = 0, mask = DmtxMaskBit1; bit < 8; bit++, mask >>= 1) {
+            module = &modules[*moduleIdx++];
+
+            if ((*module & DmtxModuleAssigned) != 0) { /* 解码 */
+                if ((*module & moduleOnColor) != 0) {
+                    codewords[chr] |= mask;
+                } else {
+                    codewords[chr] &= (0xff ^ mask);
+                }
+            } else { /* 编码 */
+                if ((codewords[chr] & mask) != 0x00) {
+                    *module |= moduleOnColor;
+                }
+
+                *module |= DmtxModuleAssigned;
+            }
+
+            *module |= DmtxModuleVisited;
+        }
+    }
+
+    /* 处理右下角的固定模式 */
+    lastIdx = map->mappingRows * map->mappingCols - 1;
+    if (!(modules[lastIdx] & DmtxModuleVisited)) {
+        modules[lastIdx] |= moduleOnColor;
+        modules[lastIdx - map->mappingCols - 1] |= moduleOnColor;
+    } /* XXX should this fixed pattern also be used in reading somehow? */
+
+    return map->codewordCount;
+}
+
+/**
+ * \brief 取符号尺寸对应的码字排布表，第一次使用时生成
+ *
+ * 生成后的排布表只读，不再释放。多个线程同时首次使用同一尺寸时各自生成，只有一份被发布，其余的释放掉。
+ *
+ * \param sizeIdx DataMatrix符号种类索引
+ * \return 排布表，sizeIdx 无效或内存不足时返回 NULL
+ */
+static const DmtxPlacementMap *getPlacementMap(int sizeIdx)
+{
+    DmtxPlacementMap *map;
+
+    if (sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount) {
+        return NULL;
+    }
+
+    map = DmtxAtomicLoad(&placementMaps[sizeIdx]);
+    if (map != NULL) {
+        return map;
+    }
+
+    map = buildPlacementMap(sizeIdx);
+    if (map == NULL) {
+        return NULL;
+    }
+
+    if (!DmtxAtomicCasPtr(&placementMaps[sizeIdx], NULL, map)) {
+        /* 其他线程已经发布了相同的排布表 */
+        free(map);
+        map = DmtxAtomicLoad(&placementMaps[sizeIdx]);
+    }
+
+    return map;
+}
+
+/**
+ * \brief 按ECC200的排列规则（对角线之字形扫描加四种角落特殊排布）生成码字排布表
+ * \param sizeIdx DataMatrix符号种类索引
+ * \return 排布表，由调用者释放；内存不足时返回 NULL
+ */
+static DmtxPlacementMap *buildPlacementMap(int sizeIdx)
 {
     int row, col, chr;
     int mappingRows, mappingCols;
+    unsigned char *visited;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(sizeIdx);
+    DmtxPlacementMap *map;
 
-    DmtxAssert(moduleOnColor & (DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue));
+    mappingRows = info->mappingRows;
+    mappingCols = info->mappingCols;
+    if (mappingRows < 6 || mappingCols < 6) {
+        return NULL;
+    }
+
+    /* 码字的位数不超过模块数，排布表与结构体一起分配 */
+    map = (DmtxPlacementMap *)malloc(sizeof(DmtxPlacementMap) + sizeof(unsigned short) * mappingRows * mappingCols);
+    visited = (unsigned char *)calloc(mappingRows * mappingCols, sizeof(unsigned char));
+    if (map == NULL || visited == NULL) {
+        free(map);
+        free(visited);
+        return NULL;
+    }
 
-    mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx);
-    mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+    map->mappingRows = mappingRows;
+    map->mappingCols = mappingCols;
+    map->moduleIdx = (unsigned short *)(map + 1);
 
     /* 初始化：寻找第一个字符的第8位的起始位置 */
     chr = 0;
@@ -89,19 +200,19 @@ static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char
     do {
         /* 检查并处理四个特殊角落的码字排布模式 */
         if ((row == mappingRows) && (col == 0)) {
-            patternShapeSpecial1(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+            patternShapeSpecial1(map, visited, chr++);
         } else if ((row == mappingRows - 2) && (col == 0) && (mappingCols % 4 != 0)) {
-            patternShapeSpecial2(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+            patternShapeSpecial2(map, visited, chr++);
         } else if ((row == mappingRows - 2) && (col == 0) && (mappingCols % 8 == 4)) {
-            patternShapeSpecial3(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+            patternShapeSpecial3(map, visited, chr++);
         } else if ((row == mappingRows + 4) && (col == 2) && (mappingCols % 8 == 0)) {
-            patternShapeSpecial4(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+            patternShapeSpecial4(map, visited, chr++);
         }
 
         /* 以对角线方式斜向上扫描并插入字符 */
         do {
-            if ((row < mappingRows) && (col >= 0) && !(modules[row * mappingCols + col] & DmtxModuleVisited)) {
-                patternShapeStandard(modules, mappingRows, mappingCols, row, col, &(codewords[chr++]), moduleOnColor);
+            if ((row < mappingRows) && (col >= 0) && !visited[row * mappingCols + col]) {
+                patternShapeStandard(map, visited, chr++, row, col);
             }
             row -= 2;
             col += 2;
@@ -111,8 +222,8 @@ static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char
 
         /* 同样以对角线方式向下扫描并插入字符 */
         do {
-            if ((row >= 0) && (col < mappingCols) && !(modules[row * mappingCols + col] & DmtxModuleVisited)) {
-                patternShapeStandard(modules, mappingRows, mappingCols, row, col, &(codewords[chr++]), moduleOnColor);
+            if ((row >= 0) && (col < mappingCols) && !visited[row * mappingCols + col]) {
+                patternShapeStandard(map, visited, chr++, row, col);
             }
             row += 2;
             col -= 2;
@@ -122,14 +233,12 @@ static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char
         /* 重复此过程，直到扫描完整个modules数组 */
     } while ((row < mappingRows) || (col < mappingCols));
 
-    /* 处理右下角的固定模式 */
-    if (!(modules[mappingRows * mappingCols - 1] & DmtxModuleVisited)) {
-        modules[mappingRows * mappingCols - 1] |= moduleOnColor;
-        modules[(mappingRows * mappingCols) - mappingCols - 2] |= moduleOnColor;
-    } /* XXX should this fixed pattern also be used in reading somehow? */
+    map->codewordCount = chr;
+    free(visited);
+
+    DmtxAssert(chr == info->symbolDataWords + info->symbolErrorWords);
 
-    /* XXX compare that chr == region->dataSize here */
-    return chr; /* XXX number of codewords read off */
+    return map;
 }
 
 /**
@@ -141,25 +250,22 @@ static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char
  * |6|7|8|
  * ```
  *
- * \param modules 指向存储模块数据的二维数组的指针
- * \param mappingRows 模块映射的行数
- * \param mappingCols 模块映射的列数
+ * \param map 生成中的排布表
+ * \param visited 已占用的模块
+ * \param chr 码字序号
  * \param row 标准码字第8位所在的行坐标
  * \param col 标准码字第8位所在的列坐标
- * \param codeword 码字
- * \param moduleOnColor 表示模块开启颜色的整数值
  */
-static void patternShapeStandard(unsigned char *modules, int mappingRows, int mappingCols, int row, int col,
-                                 unsigned char *codeword, int moduleOnColor)
+static void patternShapeStandard(DmtxPlacementMap *map, unsigned char *visited, int chr, int row, int col)
 {
-    placeModule(modules, mappingRows, mappingCols, row - 2, col - 2, codeword, DmtxMaskBit1, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row - 2, col - 1, codeword, DmtxMaskBit2, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row - 1, col - 2, codeword, DmtxMaskBit3, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row - 1, col - 1, codeword, DmtxMaskBit4, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row - 1, col, codeword, DmtxMaskBit5, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row, col - 2, codeword, DmtxMaskBit6, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row, col - 1, codeword, DmtxMaskBit7, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, row, col, codeword, DmtxMaskBit8, moduleOnColor);
+    placeModule(map, visited, row - 2, col - 2, chr, 0);
+    placeModule(map, visited, row - 2, col - 1, chr, 1);
+    placeModule(map, visited, row - 1, col - 2, chr, 2);
+    placeModule(map, visited, row - 1, col - 1, chr, 3);
+    placeModule(map, visited, row - 1, col, chr, 4);
+    placeModule(map, visited, row, col - 2, chr, 5);
+    placeModule(map, visited, row, col - 1, chr, 6);
+    placeModule(map, visited, row, col, chr, 7);
 }
 
 /**
@@ -177,23 +283,23 @@ static void patternShapeStandard(unsigned char *modules, int mappingRows, int ma
  *   |7|
  *   |8|
  * ```
- * \param  modules
- * \param  mappingRows
- * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  map
+ * \param  visited
+ * \param  chr
  */
-static void patternShapeSpecial1(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor)
+static void patternShapeSpecial1(DmtxPlacementMap *map, unsigned char *visited, int chr)
 {
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 0, codeword, DmtxMaskBit1, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 1, codeword, DmtxMaskBit2, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 2, codeword, DmtxMaskBit3, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 2, codeword, DmtxMaskBit4, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 1, codeword, DmtxMaskBit5, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 1, codeword, DmtxMaskBit6, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 2, mappingCols - 1, codeword, DmtxMaskBit7, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 3, mappingCols - 1, codeword, DmtxMaskBit8, moduleOnColor);
+    int mappingRows = map->mappingRows;
+    int mappingCols = map->mappingCols;
+
+    placeModule(map, visited, mappingRows - 1, 0, chr, 0);
+    placeModule(map, visited, mappingRows - 1, 1, chr, 1);
+    placeModule(map, visited, mappingRows - 1, 2, chr, 2);
+    placeModule(map, visited, 0, mappingCols - 2, chr, 3);
+    placeModule(map, visited, 0, mappingCols - 1, chr, 4);
+    placeModule(map, visited, 1, mappingCols - 1, chr, 5);
+    placeModule(map, visited, 2, mappingCols - 1, chr, 6);
+    placeModule(map, visited, 3, mappingCols - 1, chr, 7);
 }
 
 /**
@@ -212,23 +318,23 @@ static void patternShapeSpecial1(unsigned char *modules, int mappingRows, int ma
  *       |8|
  * ```
  *
- * \param  modules
- * \param  mappingRows
- * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  map
+ * \param  visited
+ * \param  chr
  */
-static void patternShapeSpecial2(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor)
+static void patternShapeSpecial2(DmtxPlacementMap *map, unsigned char *visited, int chr)
 {
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 3, 0, codeword, DmtxMaskBit1, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 2, 0, codeword, DmtxMaskBit2, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 0, codeword, DmtxMaskBit3, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 4, codeword, DmtxMaskBit4, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 3, codeword, DmtxMaskBit5, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 2, codeword, DmtxMaskBit6, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 1, codeword, DmtxMaskBit7, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 1, codeword, DmtxMaskBit8, moduleOnColor);
+    int mappingRows = map->mappingRows;
+    int mappingCols = map->mappingCols;
+
+    placeModule(map, visited, mappingRows - 3, 0, chr, 0);
+    placeModule(map, visited, mappingRows - 2, 0, chr, 1);
+    placeModule(map, visited, mappingRows - 1, 0, chr, 2);
+    placeModule(map, visited, 0, mappingCols - 4, chr, 3);
+    placeModule(map, visited, 0, mappingCols - 3, chr, 4);
+    placeModule(map, visited, 0, mappingCols - 2, chr, 5);
+    placeModule(map, visited, 0, mappingCols - 1, chr, 6);
+    placeModule(map, visited, 1, mappingCols - 1, chr, 7);
 }
 
 /**
@@ -248,23 +354,23 @@ static void patternShapeSpecial2(unsigned char *modules, int mappingRows, int ma
  *   |7|
  *   |8|
  * ```
- * \param  modules
- * \param  mappingRows
- * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  map
+ * \param  visited
+ * \param  chr
  */
-static void patternShapeSpecial3(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor)
+static void patternShapeSpecial3(DmtxPlacementMap *map, unsigned char *visited, int chr)
 {
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 3, 0, codeword, DmtxMaskBit1, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 2, 0, codeword, DmtxMaskBit2, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 0, codeword, DmtxMaskBit3, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 2, codeword, DmtxMaskBit4, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 1, codeword, DmtxMaskBit5, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 1, codeword, DmtxMaskBit6, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 2, mappingCols - 1, codeword, DmtxMaskBit7, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 3, mappingCols - 1, codeword, DmtxMaskBit8, moduleOnColor);
+    int mappingRows = map->mappingRows;
+    int mappingCols = map->mappingCols;
+
+    placeModule(map, visited, mappingRows - 3, 0, chr, 0);
+    placeModule(map, visited, mappingRows - 2, 0, chr, 1);
+    placeModule(map, visited, mappingRows - 1, 0, chr, 2);
+    placeModule(map, visited, 0, mappingCols - 2, chr, 3);
+    placeModule(map, visited, 0, mappingCols - 1, chr, 4);
+    placeModule(map, visited, 1, mappingCols - 1, chr, 5);
+    placeModule(map, visited, 2, mappingCols - 1, chr, 6);
+    placeModule(map, visited, 3, mappingCols - 1, chr, 7);
 }
 
 /**
@@ -286,44 +392,42 @@ static void patternShapeSpecial3(unsigned char *modules, int mappingRows, int ma
  * |6|7|8|
  * ```
  *
- * \param  modules
- * \param  mappingRows
- * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  map
+ * \param  visited
+ * \param  chr
  */
-static void patternShapeSpecial4(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor)
+static void patternShapeSpecial4(DmtxPlacementMap *map, unsigned char *visited, int chr)
 {
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, 0, codeword, DmtxMaskBit1, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, mappingRows - 1, mappingCols - 1, codeword, DmtxMaskBit2,
-                moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 3, codeword, DmtxMaskBit3, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 2, codeword, DmtxMaskBit4, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 0, mappingCols - 1, codeword, DmtxMaskBit5, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 3, codeword, DmtxMaskBit6, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 2, codeword, DmtxMaskBit7, moduleOnColor);
-    placeModule(modules, mappingRows, mappingCols, 1, mappingCols - 1, codeword, DmtxMaskBit8, moduleOnColor);
+    int mappingRows = map->mappingRows;
+    int mappingCols = map->mappingCols;
+
+    placeModule(map, visited, mappingRows - 1, 0, chr, 0);
+    placeModule(map, visited, mappingRows - 1, mappingCols - 1, chr, 1);
+    placeModule(map, visited, 0, mappingCols - 3, chr, 2);
+    placeModule(map, visited, 0, mappingCols - 2, chr, 3);
+    placeModule(map, visited, 0, mappingCols - 1, chr, 4);
+    placeModule(map, visited, 1, mappingCols - 3, chr, 5);
+    placeModule(map, visited, 1, mappingCols - 2, chr, 6);
+    placeModule(map, visited, 1, mappingCols - 1, chr, 7);
 }
 
 /**
  * \brief 位模块放置
  *
- * 此函数负责在Data Matrix码的模块矩阵中放置或读取单个位模块，取决于当前操作是编码还是解码过程。
- * 它处理边界 wrap-around 逻辑，并根据给定的编码字和模块颜色更新模块状态。
+ * 记录码字的某一位落在模块矩阵中的哪个模块，并处理边界 wrap-around 逻辑。
  *
- * \param modules 指向包含模块信息的一维数组，按行优先顺序排列
- * \param mappingRows 数据矩阵映射区域的行数
- * \param mappingCols 数据矩阵映射区域的列数
+ * \param map 生成中的排布表
+ * \param visited 已占用的模块，按行优先顺序排列
  * \param row 当前处理模块的行索引
  * \param col 当前处理模块的列索引
- * \param codeword 指向当前处理的编码字的指针，用于解码时读取或编码时设置模块状态
- * \param mask 用于位操作的掩码，帮助区分编码字中的特定位
- * \param moduleOnColor 指定放置模块的颜色属性标记
+ * \param chr 码字序号
+ * \param bit 码字中的位序号，0 对应 DmtxMaskBit1（最高位），7 对应 DmtxMaskBit8
  */
-static void placeModule(unsigned char *modules, int mappingRows, int mappingCols, int row, int col,
-                        unsigned char *codeword, int mask, int moduleOnColor)
+static void placeModule(DmtxPlacementMap *map, unsigned char *visited, int row, int col, int chr, int bit)
 {
+    int mappingRows = map->mappingRows;
+    int mappingCols = map->mappingCols;
+
     if (row < 0) {
         row += mappingRows;
         col += 4 - ((mappingRows + 4) % 8);
@@ -333,19 +437,6 @@ static void placeModule(unsigned char *modules, int mappingRows, int mappingCols
         row += 4 - ((mappingCols + 4) % 8);
     }
 
-    if ((modules[row * mappingCols + col] & DmtxModuleAssigned) != 0) { /* 解码 */
-        if ((modules[row * mappingCols + col] & moduleOnColor) != 0) {
-            *codeword |= mask;
-        } else {
-            *codeword &= (0xff ^ mask);
-        }
-    } else { /* 编码 */
-        if ((*codeword & mask) != 0x00) {
-            modules[row * mappingCols + col] |= moduleOnColor;
-        }
-
-        modules[row * mappingCols + col] |= DmtxModuleAssigned;
-    }
-
-    modules[row * mappingCols + col] |= DmtxModuleVisited;
+    map->moduleIdx[chr * 8 + bit] = (unsigned short)(row * mappingCols + col);
+    visited[row * mappingCols + col] = 1;
 }
@@ -24,18 +24,16 @@
 #include "dmtxstatic.h"
 
 #define NN 255
-#define MAX_ERROR_WORD_COUNT 68
-
-#define DMTX_CHECK_BOUNDS(l, i) DmtxAssert((i) >= 0 && (i) < (l)->length && (l)->length <= (l)->capacity)
+#define MAX_ERROR_WORD_COUNT DmtxMaxBlockErrorWords
 
 /* GF add (a + b) */
 #define GfAdd(a, b) ((a) ^ (b))
 
-/* GF multiply (a * b) */
-#define GfMult(a, b) (((a) == 0 || (b) == 0) ? 0 : antilog301[(log301[(a)] + log301[(b)]) % NN])
+/* GF multiply (a * b)，antilog301 重复了两个周期，两个对数之和无需取模 */
+#define GfMult(a, b) (((a) == 0 || (b) == 0) ? 0 : antilog301[log301[(a)] + log301[(b)]])
 
-/* GF multiply by antilog (a * alpha**b) */
-#define GfMultAntilog(a, b) (((a) == 0) ? 0 : antilog301[(log301[(a)] + (b)) % NN])
+/* GF multiply by antilog (a * alpha**b)，要求 0 <= b <= NN */
+#define GfMultAntilog(a, b) (((a) == 0) ? 0 : antilog301[log301[(a)] + (b)])
 
 /* GF(256) log values using primitive polynomial 301 */
 static DmtxByte log301[] = {
@@ -52,8 +50,8 @@ static DmtxByte log301[] = {
     51,  238, 208, 131, 58,  69,  148, 18,  15,  16,  68,  17,  121, 149, 129, 19,  155, 59,  249, 70,  214, 250,
     168, 71,  201, 156, 64,  60,  237, 130, 111, 20,  93,  122, 177, 150};
 
-/* GF(256) antilog values using primitive polynomial 301 */
-static DmtxByte antilog301[] = {
+/* GF(256) antilog values using primitive polynomial 301, antilog301[i] == antilog301[i + NN] */
+static DmtxByte antilog301[2 * NN] = {
     1,   2,   4,   8,   16,  32,  64,  128, 45,  90,  180, 69,  138, 57,  114, 228, 229, 231, 227, 235, 251, 219,
     155, 27,  54,  108, 216, 157, 23,  46,  92,  184, 93,  186, 89,  178, 73,  146, 9,   18,  36,  72,  144, 13,
     26,  52,  104, 208, 141, 55,  110, 220, 149, 7,   14,  28,  56,  112, 224, 237, 247, 195, 171, 123, 246, 193,
@@ -65,14 +63,97 @@ static DmtxByte antilog301[] = {
     127, 254, 209, 143, 51,  102, 204, 181, 71,  142, 49,  98,  196, 165, 103, 206, 177, 79,  158, 17,  34,  68,
     136, 61,  122, 244, 197, 167, 99,  198, 161, 111, 222, 145, 15,  30,  60,  120, 240, 205, 183, 67,  134, 33,
     66,  132, 37,  74,  148, 5,   10,  20,  40,  80,  160, 109, 218, 153, 31,  62,  124, 248, 221, 151, 3,   6,
-    12,  24,  48,  96,  192, 173, 119, 238, 241, 207, 179, 75,  150, 0};
+    12,  24,  48,  96,  192, 173, 119, 238, 241, 207, 179, 75,  150, 1,   2,   4,   8,   16,  32,  64,  128, 45,
+    90,  180, 69,  138, 57,  114, 228, 229, 231, 227, 235, 251, 219, 155, 27,  54,  108, 216, 157, 23,  46,  92,
+    184, 93,  186, 89,  178, 73,  146, 9,   18,  36,  72,  144, 13,  26,  52,  104, 208, 141, 55,  110, 220, 149,
+    7,   14,  28,  56,  112, 224, 237, 247, 195, 171, 123, 246, 193, 175, 115, 230, 225, 239, 243, 203, 187, 91,
+    182, 65,  130, 41,  82,  164, 101, 202, 185, 95,  190, 81,  162, 105, 210, 137, 63,  126, 252, 213, 135, 35,
+    70,  140, 53,  106, 212, 133, 39,  78,  156, 21,  42,  84,  168, 125, 250, 217, 159, 19,  38,  76,  152, 29,
+    58,  116, 232, 253, 215, 131, 43,  86,  172, 117, 234, 249, 223, 147, 11,  22,  44,  88,  176, 77,  154, 25,
+    50,  100, 200, 189, 87,  174, 113, 226, 233, 255, 211, 139, 59,  118, 236, 245, 199, 163, 107, 214, 129, 47,
+    94,  188, 85,  170, 121, 242, 201, 191, 83,  166, 97,  194, 169, 127, 254, 209, 143, 51,  102, 204, 181, 71,
+    142, 49,  98,  196, 165, 103, 206, 177, 79,  158, 17,  34,  68,  136, 61,  122, 244, 197, 167, 99,  198, 161,
+    111, 222, 145, 15,  30,  60,  120, 240, 205, 183, 67,  134, 33,  66,  132, 37,  74,  148, 5,   10,  20,  40,
+    80,  160, 109, 218, 153, 31,  62,  124, 248, 221, 151, 3,   6,   12,  24,  48,  96,  192, 173, 119, 238, 241,
+    207, 179, 75,  150};
 
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFail;      \
+/**
+ * 生成多项式 g(x) = (x + α)(x + α^2)...(x + α^E) 的系数（x^0 ~ x^(E-1)，首项 x^E 的系数为 1）取对数后的值，
+ * 每种纠错码字数 E 一组，起始位置见 rsGenPolyIndex。生成多项式的系数都不为 0。
+ */
+static const DmtxByte rsGenPolyLog[] = {
+    15,  244, 210, 207, 235, 28,  197, 42,  218, 214, 30,  177, 55,  243, 83,  172, 131, 237, 120, 150, 50,  199,
+    66,  12,  215, 242, 174, 109, 103, 156, 212, 173, 213, 78,  233, 194, 74,  199, 107, 185, 94,  173, 35,  142,
+    168, 105, 173, 246, 93,  84,  38,  27,  248, 12,  8,   39,  33,  171, 83,  171, 61,  142, 103, 164, 253, 220,
+    199, 250, 94,  231, 161, 163, 177, 69,  244, 9,   164, 210, 61,  201, 38,  149, 184, 109, 1,   164, 230, 233,
+    209, 122, 193, 25,  79,  23,  146, 33,  127, 45,  85,  136, 215, 231, 103, 137, 106, 22,  202, 20,  131, 22,
+    106, 225, 127, 177, 236, 242, 183, 31,  245, 141, 65,  151, 17,  125, 173, 184, 245, 190, 146, 222, 239, 166,
+    99,  253, 196, 130, 167, 195, 12,  50,  94,  48,  198, 213, 239, 149, 109, 32,  150, 156, 176, 168, 232, 77,
+    111, 87,  183, 181, 213, 108, 252, 51,  20,  229, 75,  16,  39,  1,   2,   197, 219, 81,  90,  84,  248, 67,
+    135, 66,  31,  153, 140, 69,  187, 86,  57,  138, 65,  90,  234, 114, 115, 134, 233, 60,  88,  200, 1,   156,
+    102, 168, 3,   66,  84,  142, 38,  203, 88,  160, 207, 13,  167, 106, 0,   122, 13,  24,  81,  237, 82,  11,
+    141, 254, 192, 148, 225, 38,  225, 156, 221, 127, 131, 245, 5,   128, 134, 249, 102, 249, 17,  215, 164, 59,
+    145, 170, 100, 4,   132, 154, 28,  222, 9,   166, 215, 124, 136, 213, 142, 220, 12,  33,  214, 79,  135, 137,
+    145, 73,  132, 230, 66,  11,  94,  30,  122, 69,  114, 66,  38,  131, 249, 242, 195, 51,  47,  142, 118, 66,
+    166, 68,  246, 123, 19,  254, 113, 40,  131, 115, 143, 221, 24,  15,  37,  232, 129, 128, 72,  118, 121, 42,
+    249, 134, 254, 169, 128, 235, 251, 80,  43,  90,  156, 176, 217, 60,  55,  22,  125, 72,  159, 149, 99,  179,
+    29,  168, 32,  175, 141, 42,  89,  103, 154, 82,  164, 169, 144, 179, 25,  188, 222, 83,  57,  218, 68,  156,
+    91,  202, 85,  111, 100, 83,  238, 66,  6,   14,  184, 206, 135, 132, 241, 23,  232, 180, 91,  145, 226, 228,
+    77,  164, 195, 158, 234, 137, 166, 2,   159, 121, 53,  163, 172, 58,  236, 126, 162, 133, 182, 51,  15,  247,
+    34,  20,  52,  113, 56,  34,  219, 132, 201, 139, 40,  36,  176, 94,  198, 237, 10,  129, 202, 194, 192, 197,
+    200, 32,  94,  210, 230, 18,  155, 220, 152, 233, 83,  82,  203, 252, 140, 51,  121, 245, 89,  17,  198, 131,
+    70,  183, 250, 153, 45,  127, 140, 186, 121, 151, 144, 6,   24,  25,  233, 221, 91,  245, 190, 79,  33};
+
+/* {纠错码字数, 在 rsGenPolyLog 中的起始位置} */
+static const int rsGenPolyIndex[][2] = {{5, 0},    {7, 5},    {10, 12},  {11, 22},  {12, 33},  {14, 45},
+                                        {18, 59},  {20, 77},  {24, 97},  {28, 121}, {36, 149}, {42, 185},
+                                        {48, 227}, {56, 275}, {62, 331}, {68, 393}};
+
+/**
+ * \brief 取纠错码字数对应的生成多项式
+ * \param errorWordCount
+ * \return 系数的对数，按 x^0 ~ x^(errorWordCount-1) 排列；不是合法的纠错码字数时返回 NULL
+ */
+static const DmtxByte *rsGetGenPolyLog(int errorWordCount)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(rsGenPolyIndex) / sizeof(rsGenPolyIndex[0])); i++) {
+        if (rsGenPolyIndex[i][0] == errorWordCount) {
+            return rsGenPolyLog + rsGenPolyIndex[i][1];
+        }
     }
+
+    return NULL;
+}
+
+/**
+ * \brief 把一个码字移入余式寄存器（除以生成多项式的 LFSR）
+ * \param rem 余式，rem[j] 为 x^j 的系数
+ * \param genLog 生成多项式系数的对数，见 rsGetGenPolyLog
+ * \param errorWordCount
+ * \param word
+ */
+static void rsShiftRemainder(DmtxByte *rem, const DmtxByte *genLog, int errorWordCount, DmtxByte word)
+{
+    int j, valLog;
+    DmtxByte val;
+
+    val = GfAdd(rem[errorWordCount - 1], word);
+
+    if (val == 0) {
+        memmove(rem + 1, rem, errorWordCount - 1);
+        rem[0] = 0;
+        return;
+    }
+
+    valLog = log301[val];
+    for (j = errorWordCount - 1; j > 0; j--) {
+        rem[j] = GfAdd(rem[j - 1], antilog301[genLog[j] + valLog]);
+    }
+    rem[0] = antilog301[genLog[0] + valLog];
+}
+
 /**
  * \brief Encode xyz.
  * More detailed description.
@@ -85,137 +166,142 @@ static DmtxPassFail rsEncode(DmtxMessage *message, int sizeIdx)
     int i, j;
     int blockStride, blockIdx;
     int blockErrorWords, symbolDataWords, symbolErrorWords, symbolTotalWords;
-    DmtxPassFail passFail;
-    DmtxByte val, *eccPtr;
-    DmtxByte genStorage[MAX_ERROR_WORD_COUNT];
-    DmtxByte eccStorage[MAX_ERROR_WORD_COUNT];
-    DmtxByteList gen = dmtxByteListBuild(genStorage, sizeof(genStorage));
-    DmtxByteList ecc = dmtxByteListBuild(eccStorage, sizeof(eccStorage));
-
-    blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
-    blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
-    symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-    symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+    const DmtxByte *genLog;
+    const DmtxSymbolInfo *info;
+    DmtxByte ecc[MAX_ERROR_WORD_COUNT];
+
+    info = dmtxGetSymbolInfo(sizeIdx);
+    if (info == NULL) {
+        return DmtxFail;
+    }
+
+    blockStride = info->interleavedBlocks;
+    blockErrorWords = info->blockErrorWords;
+    symbolDataWords = info->symbolDataWords;
+    symbolErrorWords = info->symbolErrorWords;
     symbolTotalWords = symbolDataWords + symbolErrorWords;
 
-    /* Populate generator polynomial */
-    rsGenPoly(&gen, blockErrorWords);
+    /* Look up generator polynomial */
+    genLog = rsGetGenPolyLog(blockErrorWords);
+    if (genLog == NULL) {
+        return DmtxFail;
+    }
 
     /* For each interleaved block... */
     for (blockIdx = 0; blockIdx < blockStride; blockIdx++) {
         /* Generate error codewords */
-        dmtxByteListInit(&ecc, blockErrorWords, 0, &passFail);
-        CHKPASS;
+        memset(ecc, 0x00, sizeof(ecc));
         for (i = blockIdx; i < symbolDataWords; i += blockStride) {
-            val = GfAdd(ecc.b[blockErrorWords - 1], message->code[i]);
-
-            for (j = blockErrorWords - 1; j > 0; j--) {
-                DMTX_CHECK_BOUNDS(&ecc, j);
-                DMTX_CHECK_BOUNDS(&ecc, j - 1);
-                DMTX_CHECK_BOUNDS(&gen, j);
-                ecc.b[j] = GfAdd(ecc.b[j - 1], GfMult(gen.b[j], val));
-            }
-
-            ecc.b[0] = GfMult(gen.b[0], val);
+            rsShiftRemainder(ecc, genLog, blockErrorWords, message->code[i]);
         }
 
         /* Copy to output message */
-        eccPtr = ecc.b + blockErrorWords;
+        j = blockErrorWords;
         for (i = symbolDataWords + blockIdx; i < symbolTotalWords; i += blockStride) {
-            message->code[i] = *(--eccPtr);
+            message->code[i] = ecc[--j];
         }
 
-        DmtxAssert(ecc.b == eccPtr);
+        DmtxAssert(j == 0);
     }
 
     return DmtxPass;
 }
 
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFail;      \
-    }
 /**
  * \brief Decode xyz.
  * More detailed description.
  * \param code
  * \param sizeIdx
  * \param fix
+ * \param erasures 与 code 等长，非 0 表示该码字可信度低；仅纠错失败时才作为擦除位置重试，NULL 表示不使用
  * \return Function success (DmtxPass|DmtxFail)
  */
-static DmtxPassFail rsDecode(unsigned char *code, int sizeIdx, int fix)
+static DmtxPassFail rsDecode(unsigned char *code, int sizeIdx, int fix, const unsigned char *erasures)
 {
     int i;
     int blockStride, blockIdx;
     int blockDataWords, blockErrorWords, blockMaxCorrectable;
-    //   int blockDataWords, blockErrorWords, blockTotalWords, blockMaxCorrectable;
     int symbolDataWords, symbolErrorWords, symbolTotalWords;
-    DmtxBoolean error, repairable;
-    DmtxPassFail passFail;
+    int recLength, lambda, locLength;
+    int eraCount, eraPos[NN];
+    DmtxBoolean repairable;
     unsigned char *word;
-    DmtxByte elpStorage[MAX_ERROR_WORD_COUNT];
-    DmtxByte synStorage[MAX_ERROR_WORD_COUNT + 1];
-    DmtxByte recStorage[NN];
-    DmtxByte locStorage[NN];
-    DmtxByteList elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
-    DmtxByteList syn = dmtxByteListBuild(synStorage, sizeof(synStorage));
-    DmtxByteList rec = dmtxByteListBuild(recStorage, sizeof(recStorage));
-    DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
-
-    blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
-    blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
-    blockMaxCorrectable = dmtxGetSymbolAttribute(DmtxSymAttribBlockMaxCorrectable, sizeIdx);
-    symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-    symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+    DmtxByte elp[MAX_ERROR_WORD_COUNT];
+    DmtxByte syn[DmtxMaxInterleavedBlocks][MAX_ERROR_WORD_COUNT + 1];
+    DmtxByte rec[NN];
+    DmtxByte loc[NN];
+    const DmtxSymbolInfo *info;
+
+    info = dmtxGetSymbolInfo(sizeIdx);
+    if (info == NULL) {
+        return DmtxFail;
+    }
+
+    blockStride = info->interleavedBlocks;
+    blockErrorWords = info->blockErrorWords;
+    blockMaxCorrectable = info->blockMaxCorrectable;
+    symbolDataWords = info->symbolDataWords;
+    symbolErrorWords = info->symbolErrorWords;
     symbolTotalWords = symbolDataWords + symbolErrorWords;
 
+    /* Compute syndromes (syn) of every block straight from the interleaved codewords */
+    if (!rsComputeBlockSyndromes(syn, code, info)) {
+        return DmtxPass;
+    }
+
     /* For each interleaved block */
     for (blockIdx = 0; blockIdx < blockStride; blockIdx++) {
+        /* 伴随式全为 0 的码块没有错误，无需展开 */
+        for (i = 1; i <= blockErrorWords && syn[blockIdx][i] == 0; i++) {
+        }
+        if (i > blockErrorWords) {
+            continue;
+        }
+
         /* Data word count depends on blockIdx due to special case at 144x144 */
         blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
-        //      blockTotalWords = blockErrorWords + blockDataWords;
 
-        /* Populate received list (rec) with data and error codewords */
-        dmtxByteListInit(&rec, 0, 0, &passFail);
-        CHKPASS;
+        /* Populate received list (rec) with data and error codewords, rec[j] 为 x^j 的系数 */
+        recLength = 0;
+        eraCount = 0;
 
         /* Start with final error word and work backward */
         word = code + symbolTotalWords + blockIdx - blockStride;
         for (i = 0; i < blockErrorWords; i++) {
-            dmtxByteListPush(&rec, *word, &passFail);
-            CHKPASS;
+            if (erasures != NULL && erasures[word - code] != 0) {
+                eraPos[eraCount++] = recLength;
+            }
+            rec[recLength++] = *word;
             word -= blockStride;
         }
 
         /* Start with final data word and work backward */
         word = code + blockIdx + (blockStride * (blockDataWords - 1));
         for (i = 0; i < blockDataWords; i++) {
-            dmtxByteListPush(&rec, *word, &passFail);
-            CHKPASS;
+            if (erasures != NULL && erasures[word - code] != 0) {
+                eraPos[eraCount++] = recLength;
+            }
+            rec[recLength++] = *word;
             word -= blockStride;
         }
 
-        /* Compute syndromes (syn) */
-        error = rsComputeSyndromes(&syn, &rec, blockErrorWords);
-
         /* Error(s) detected: Attempt repair */
-        if (error) {
-            /* Find error locator polynomial (elp) */
-            repairable = rsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
-            if (!repairable) {
-                return DmtxFail;
-            }
 
-            /* Find error positions (loc) */
-            repairable = rsFindErrorLocations(&loc, &elp);
-            if (!repairable) {
-                return DmtxFail;
-            }
+        /* Find error locator polynomial (elp) */
+        repairable = rsFindErrorLocatorPoly(elp, &lambda, syn[blockIdx], blockErrorWords, blockMaxCorrectable);
 
+        /* Find error positions (loc) */
+        if (repairable) {
+            repairable = rsFindErrorLocations(loc, &locLength, elp, lambda);
+        }
+
+        if (repairable) {
             /* Find error values and repair */
-            rsRepairErrors(&rec, &loc, &elp, &syn);
+            rsRepairErrors(rec, loc, elp, lambda, syn[blockIdx]);
+        } else if (eraCount == 0 ||
+                   !rsRepairErasures(rec, recLength, syn[blockIdx], eraPos, eraCount, blockErrorWords)) {
+            /* 纠错失败时，已知的低可信度码字作为擦除位置再试：2e + s < blockErrorWords */
+            return DmtxFail;
         }
 
         /*
@@ -225,249 +311,251 @@ static DmtxPassFail rsDecode(unsigned char *code, int sizeIdx, int fix)
         /* Start with first data word and work forward */
         word = code + blockIdx;
         for (i = 0; i < blockDataWords; i++) {
-            *word = dmtxByteListPop(&rec, &passFail);
-            CHKPASS;
+            *word = rec[--recLength];
             word += blockStride;
         }
 
         /* Start with first error word and work forward */
         word = code + symbolDataWords + blockIdx;
         for (i = 0; i < blockErrorWords; i++) {
-            *word = dmtxByteListPop(&rec, &passFail);
-            CHKPASS;
+            *word = rec[--recLength];
             word += blockStride;
         }
+
+        DmtxAssert(recLength == 0);
     }
 
     return DmtxPass;
 }
 
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFail;      \
-    }
 /**
- * \brief Populate generator polynomial.
- * More detailed description.
- * \param gen
+ * \brief 把 value * alpha**(i*j)（i = 1..errorWordCount）累加到各个伴随式
+ * 只查一次对数，指数随 i 递增 j，各伴随式之间没有依赖。
+ * \param syn 伴随式，syn[1..errorWordCount]
+ * \param value 码字
+ * \param j 码字在码块中的位置（x^j 的系数）
  * \param errorWordCount
- * \return Function success (DmtxPass|DmtxFail)
  */
-static DmtxPassFail rsGenPoly(DmtxByteList *gen, int errorWordCount)
+static void rsAddSyndromeTerms(DmtxByte *syn, DmtxByte value, int j, int errorWordCount)
 {
-    int i, j;
-    DmtxPassFail passFail;
-
-    /* Initialize all coefficients to 1 */
-    dmtxByteListInit(gen, errorWordCount, 1, &passFail);
-    CHKPASS;
-
-    /* Generate polynomial */
-    for (i = 0; i < gen->length; i++) {
-        for (j = i; j >= 0; j--) {
-            gen->b[j] = GfMultAntilog(gen->b[j], i + 1);
-            if (j > 0) {
-                gen->b[j] = GfAdd(gen->b[j], gen->b[j - 1]);
+    int i, exp;
+
+    if (value == 0) {
+        return;
+    }
+
+    for (exp = log301[value], i = 1; i <= errorWordCount; i++) {
+        exp += j;
+        if (exp >= NN) {
+            exp -= NN;
+        }
+        syn[i] = GfAdd(syn[i], antilog301[exp]);
+    }
+}
+
+/**
+ * \brief 一次计算符号中所有交织码块的伴随式
+ * 直接按交织排列读取 code，不需要先把码块展开到 rec。每个码块先用编码器的 LFSR 求出接收多项式 r(x) 除以生成多项式
+ * g(x) 的余式 R(x)（数据码字重新编码后与收到的纠错码字相加），因为 g(alpha**i) = 0，伴随式 S_i = r(alpha**i) = R(alpha**i)。
+ * 余式为 0 的码块没有错误，伴随式只对有错误的码块计算，且只需 errorWords 项。
+ * \param syn 各码块的伴随式，syn[blockIdx][1..blockErrorWords]，无错误的码块全为 0
+ * \param code 交织排列的码字（数据码字在前，纠错码字在后）
+ * \param info 符号尺寸的属性
+ * \return Are error(s) present in any block? (DmtxTrue|DmtxFalse)
+ */
+static DmtxBoolean rsComputeBlockSyndromes(DmtxByte syn[][MAX_ERROR_WORD_COUNT + 1], const unsigned char *code,
+                                           const DmtxSymbolInfo *info)
+{
+    int j, k, blockIdx;
+    int blockStride, blockErrorWords, symbolDataWords;
+    const DmtxByte *genLog;
+    DmtxByte rem[MAX_ERROR_WORD_COUNT];
+    DmtxBoolean blockError, error = DmtxFalse;
+
+    blockStride = info->interleavedBlocks;
+    blockErrorWords = info->blockErrorWords;
+    symbolDataWords = info->symbolDataWords;
+
+    DmtxAssert(blockStride <= DmtxMaxInterleavedBlocks);
+
+    genLog = rsGetGenPolyLog(blockErrorWords);
+    if (genLog == NULL) {
+        return DmtxFalse;
+    }
+
+    for (blockIdx = 0; blockIdx < blockStride; blockIdx++) {
+        /* Remainder of data words * x**E, rem[j] 为 x^j 的系数 */
+        memset(rem, 0x00, sizeof(rem));
+        for (k = blockIdx; k < symbolDataWords; k += blockStride) {
+            rsShiftRemainder(rem, genLog, blockErrorWords, code[k]);
+        }
+
+        /* Add received error words: first error word is x**(E-1) */
+        blockError = DmtxFalse;
+        for (j = blockErrorWords - 1, k = symbolDataWords + blockIdx; j >= 0; j--, k += blockStride) {
+            rem[j] = GfAdd(rem[j], code[k]);
+            if (rem[j] != 0) {
+                blockError = DmtxTrue;
             }
         }
+
+        memset(syn[blockIdx], 0x00, blockErrorWords + 1);
+        if (blockError) {
+            for (j = 0; j < blockErrorWords; j++) {
+                rsAddSyndromeTerms(syn[blockIdx], rem[j], j, blockErrorWords);
+            }
+            error = DmtxTrue;
+        }
     }
 
-    return DmtxPass;
+    return error;
 }
 
-/* XXX this CHKPASS isn't doing what we want ... really need a error reporting strategy */
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxTrue;      \
-    }
 /**
- * \brief Populate generator polynomial.
+ * \brief Compute syndromes.
  * Assume we have received bits grouped into mm-bit symbols in rec[i],
- * i=0..(nn-1),  and rec[i] is index form (ie as powers of alpha). We first
- * compute the 2*tt syndromes by substituting alpha**i into rec(X) and
- * evaluating, storing the syndromes in syn[i], i=1..2tt (leave syn[0] zero).
+ * i=0..(nn-1). We compute the 2*tt syndromes by substituting alpha**i into
+ * rec(X), storing the syndromes in syn[i], i=1..2tt (leave syn[0] zero).
  * \param syn
  * \param rec
+ * \param recLength
  * \param blockErrorWords
- * \return Are error(s) present? (DmtxPass|DmtxFail)
+ * \return Are error(s) present? (DmtxTrue|DmtxFalse)
  */
-static DmtxBoolean rsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords)
+static DmtxBoolean rsComputeSyndromes(DmtxByte *syn, const DmtxByte *rec, int recLength, int blockErrorWords)
 {
     int i, j;
-    DmtxPassFail passFail;
-    DmtxBoolean error = DmtxFalse;
 
-    /* Initialize all coefficients to 0 */
-    dmtxByteListInit(syn, blockErrorWords + 1, 0, &passFail);
-    CHKPASS;
+    memset(syn, 0x00, blockErrorWords + 1);
 
-    for (i = 1; i < syn->length; i++) {
-        /* Calculate syndrome at i */
-        for (j = 0; j < rec->length; j++) { /* alternatively: j < blockTotalWords */
-            syn->b[i] = GfAdd(syn->b[i], GfMultAntilog(rec->b[j], i * j));
-        }
+    for (j = 0; j < recLength; j++) {
+        rsAddSyndromeTerms(syn, rec[j], j, blockErrorWords);
+    }
 
-        /* Non-zero syndrome indicates presence of error(s) */
-        if (syn->b[i] != 0) {
-            error = DmtxTrue;
+    /* Non-zero syndrome indicates presence of error(s) */
+    for (i = 1; i <= blockErrorWords; i++) {
+        if (syn[i] != 0) {
+            return DmtxTrue;
         }
     }
 
-    return error;
+    return DmtxFalse;
 }
 
-/* XXX this CHKPASS isn't doing what we want ... really need a error reporting strategy */
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFalse;     \
-    }
 /**
  * \brief Find the error location polynomial using Berlekamp-Massey.
  * More detailed description.
- * \param elpOut
+ * \param elpOut 错误位置多项式，长度为 MAX_ERROR_WORD_COUNT
+ * \param lambdaOut 错误位置多项式的次数
  * \param syn
  * \param errorWordCount
  * \param maxCorrectable
  * \return Is block repairable? (DmtxTrue|DmtxFalse)
  */
-static DmtxBoolean rsFindErrorLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, int errorWordCount,
+static DmtxBoolean rsFindErrorLocatorPoly(DmtxByte *elpOut, int *lambdaOut, const DmtxByte *syn, int errorWordCount,
                                           int maxCorrectable)
 {
     int i, iNext, j;
     int m, mCmp, lambda;
-    DmtxByte disTmp, disStorage[MAX_ERROR_WORD_COUNT + 1];
-    DmtxByte elpStorage[MAX_ERROR_WORD_COUNT + 2][MAX_ERROR_WORD_COUNT];
-    DmtxByteList dis, elp[MAX_ERROR_WORD_COUNT + 2];
-    DmtxPassFail passFail;
-
-    dis = dmtxByteListBuild(disStorage, sizeof(disStorage));
-    dmtxByteListInit(&dis, 0, 0, &passFail);
-    CHKPASS;
-
-    for (i = 0; i < MAX_ERROR_WORD_COUNT + 2; i++) {
-        elp[i] = dmtxByteListBuild(elpStorage[i], sizeof(elpStorage[i]));
-        dmtxByteListInit(&elp[i], 0, 0, &passFail);
-        CHKPASS;
-    }
+    DmtxByte disTmp, dis[MAX_ERROR_WORD_COUNT + 1];
+    DmtxByte elp[MAX_ERROR_WORD_COUNT + 2][MAX_ERROR_WORD_COUNT];
+    int elpLength[MAX_ERROR_WORD_COUNT + 2];
+
+    memset(dis, 0x00, sizeof(dis));
+    memset(elp, 0x00, sizeof(elp));
+    memset(elpLength, 0x00, sizeof(elpLength));
 
     /* iNext = 0 */
-    dmtxByteListPush(&elp[0], 1, &passFail);
-    CHKPASS;
-    dmtxByteListPush(&dis, 1, &passFail);
-    CHKPASS;
+    elp[0][0] = 1;
+    elpLength[0] = 1;
+    dis[0] = 1;
 
     /* iNext = 1 */
-    dmtxByteListPush(&elp[1], 1, &passFail);
-    CHKPASS;
-    dmtxByteListPush(&dis, syn->b[1], &passFail);
-    CHKPASS;
+    elp[1][0] = 1;
+    elpLength[1] = 1;
+    dis[1] = syn[1];
 
     for (iNext = 2, i = 1; /* explicit break */; i = iNext++) {
-        if (dis.b[i] == 0) {
+        if (dis[i] == 0) {
             /* Simple case: Copy directly from previous iteration */
-            dmtxByteListCopy(&elp[iNext], &elp[i], &passFail);
-            CHKPASS;
+            memcpy(elp[iNext], elp[i], sizeof(elp[i]));
+            elpLength[iNext] = elpLength[i];
         } else {
             /* Find earlier iteration (m) that provides maximal (m - lambda) */
             for (m = 0, mCmp = 1; mCmp < i; mCmp++) {
-                if (dis.b[mCmp] != 0 && (mCmp - elp[mCmp].length) >= (m - elp[m].length)) {
+                if (dis[mCmp] != 0 && (mCmp - elpLength[mCmp]) >= (m - elpLength[m])) {
                     m = mCmp;
                 }
             }
 
             /* Calculate error location polynomial elp[i] (set 1st term) */
-            for (lambda = elp[m].length - 1, j = 0; j <= lambda; j++) {
-                elp[iNext].b[j + i - m] =
-                    (elp[i - 1].b[j] == 0)
-                        ? 0
-                        : antilog301[(NN - log301[dis.b[m]] + log301[dis.b[i]] + log301[elp[m].b[j]]) % NN];
+            for (lambda = elpLength[m] - 1, j = 0; j <= lambda; j++) {
+                elp[iNext][j + i - m] =
+                    (elp[i - 1][j] == 0) ? 0
+                                         : antilog301[(NN - log301[dis[m]] + log301[dis[i]] + log301[elp[m][j]]) % NN];
             }
 
             /* Calculate error location polynomial elp[i] (add 2nd term) */
-            for (lambda = elp[i].length - 1, j = 0; j <= lambda; j++) {
-                elp[iNext].b[j] = GfAdd(elp[iNext].b[j], elp[i].b[j]);
+            for (lambda = elpLength[i] - 1, j = 0; j <= lambda; j++) {
+                elp[iNext][j] = GfAdd(elp[iNext][j], elp[i][j]);
             }
 
-            elp[iNext].length = max(elp[i].length, elp[m].length + i - m);
+            elpLength[iNext] = max(elpLength[i], elpLength[m] + i - m);
         }
 
-        lambda = elp[iNext].length - 1;
+        lambda = elpLength[iNext] - 1;
         if (i == errorWordCount || i >= lambda + maxCorrectable) {
             break;
         }
 
-        /* Calculate discrepancy dis.b[i] */
-        for (disTmp = syn->b[iNext], j = 1; j <= lambda; j++) {
-            disTmp = GfAdd(disTmp, GfMult(syn->b[iNext - j], elp[iNext].b[j]));
+        /* Calculate discrepancy dis[i] */
+        for (disTmp = syn[iNext], j = 1; j <= lambda; j++) {
+            disTmp = GfAdd(disTmp, GfMult(syn[iNext - j], elp[iNext][j]));
         }
 
-        DmtxAssert(dis.length == iNext);
-        dmtxByteListPush(&dis, disTmp, &passFail);
-        CHKPASS;
+        dis[iNext] = disTmp;
     }
 
-    dmtxByteListCopy(elpOut, &elp[iNext], &passFail);
-    CHKPASS;
+    memcpy(elpOut, elp[iNext], MAX_ERROR_WORD_COUNT);
+    *lambdaOut = lambda;
 
     return (lambda <= maxCorrectable) ? DmtxTrue : DmtxFalse;
 }
 
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFalse;     \
-    }
 /**
  * \brief Find roots of the error locator polynomial (Chien Search).
  * If the degree of elp is <= tt, we substitute alpha**i, i=1..n into the elp
  * to get the roots, hence the inverse roots, the error location numbers.
  * If the number of errors located does not equal the degree of the elp, we
  * have more than tt errors and cannot correct them.
- * \param loc
+ * \param loc 错误位置
+ * \param locLength 错误位置数
  * \param elp
+ * \param lambda 错误位置多项式的次数
  * \return Is block repairable? (DmtxTrue|DmtxFalse)
  */
-static DmtxBoolean rsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
+static DmtxBoolean rsFindErrorLocations(DmtxByte *loc, int *locLength, const DmtxByte *elp, int lambda)
 {
     int i, j;
-    int lambda = elp->length - 1;
-    DmtxPassFail passFail;
-    DmtxByte q, regStorage[MAX_ERROR_WORD_COUNT];
-    DmtxByteList reg = dmtxByteListBuild(regStorage, sizeof(regStorage));
+    DmtxByte q, reg[MAX_ERROR_WORD_COUNT];
 
-    dmtxByteListCopy(&reg, elp, &passFail);
-    CHKPASS;
-    dmtxByteListInit(loc, 0, 0, &passFail);
-    CHKPASS;
+    memcpy(reg, elp, sizeof(reg));
+    *locLength = 0;
 
     for (i = 1; i <= NN; i++) {
         for (q = 1, j = 1; j <= lambda; j++) {
-            reg.b[j] = GfMultAntilog(reg.b[j], j);
-            q = GfAdd(q, reg.b[j]);
+            reg[j] = GfMultAntilog(reg[j], j);
+            q = GfAdd(q, reg[j]);
         }
 
         if (q == 0) {
-            dmtxByteListPush(loc, NN - i, &passFail);
-            CHKPASS;
+            loc[(*locLength)++] = NN - i;
         }
     }
 
-    return (loc->length == lambda) ? DmtxTrue : DmtxFalse;
+    return (*locLength == lambda) ? DmtxTrue : DmtxFalse;
 }
 
-#undef CHKPASS
-#define CHKPASS                   \
-    {                             \
-        if (passFail == DmtxFail) \
-            return DmtxFail;      \
-    }
 /**
  * \brief Find the error values and repair.
  * Solve for the error value at the error location and correct the error. The
@@ -480,35 +568,30 @@ static DmtxBoolean rsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *e
  * \param rec
  * \param loc
  * \param elp
+ * \param lambda 错误位置多项式的次数
  * \param syn
  */
-static DmtxPassFail rsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp,
-                                   const DmtxByteList *syn)
+static void rsRepairErrors(DmtxByte *rec, const DmtxByte *loc, const DmtxByte *elp, int lambda, const DmtxByte *syn)
 {
     int i, j, q;
-    int lambda = elp->length - 1;
-    DmtxPassFail passFail;
     DmtxByte zVal, root, err;
-    DmtxByte zStorage[MAX_ERROR_WORD_COUNT + 1];
-    DmtxByteList z = dmtxByteListBuild(zStorage, sizeof(zStorage));
+    DmtxByte z[MAX_ERROR_WORD_COUNT + 1];
 
     /* Form polynomial z(x) */
-    dmtxByteListPush(&z, 1, &passFail);
-    CHKPASS;
+    z[0] = 1;
     for (i = 1; i <= lambda; i++) {
-        for (zVal = GfAdd(syn->b[i], elp->b[i]), j = 1; j < i; j++) {
-            zVal = GfAdd(zVal, GfMult(elp->b[i - j], syn->b[j]));
+        for (zVal = GfAdd(syn[i], elp[i]), j = 1; j < i; j++) {
+            zVal = GfAdd(zVal, GfMult(elp[i - j], syn[j]));
         }
-        dmtxByteListPush(&z, zVal, &passFail);
-        CHKPASS;
+        z[i] = zVal;
     }
 
     for (i = 0; i < lambda; i++) {
         /* Calculate numerator of error term */
-        root = NN - loc->b[i];
+        root = NN - loc[i];
 
         for (err = 1, j = 1; j <= lambda; j++) {
-            err = GfAdd(err, GfMultAntilog(z.b[j], j * root));
+            err = GfAdd(err, GfMultAntilog(z[j], (j * root) % NN));
         }
 
         if (err == 0) {
@@ -518,14 +601,130 @@ static DmtxPassFail rsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, c
         /* Calculate denominator of error term */
         for (q = 0, j = 0; j < lambda; j++) {
             if (j != i) {
-                q += log301[1 ^ antilog301[(loc->b[j] + root) % NN]];
+                q += log301[1 ^ antilog301[(loc[j] + root) % NN]];
             }
         }
         q %= NN;
 
         err = GfMultAntilog(err, NN - q);
-        rec->b[loc->b[i]] = GfAdd(rec->b[loc->b[i]], err);
+        rec[loc[i]] = GfAdd(rec[loc[i]], err);
     }
+}
 
-    return DmtxPass;
+/**
+ * \brief 已知部分错误位置（擦除）时的纠错
+ *
+ * 以擦除位置多项式为初值运行 Berlekamp-Massey，得到同时包含错误和擦除的位置多项式，再用 Forney 算法求错误值。
+ * 理论上错误数 e 和擦除数 s 满足 2e + s <= errorWordCount 即可纠正，但用尽全部纠错码字时任意输入都会被“纠正”，
+ * 因此至少保留一个伴随式用于检错：2e + s < errorWordCount，纠正后重新计算伴随式确认结果。
+ *
+ * \param rec 接收到的码字，rec[j] 为 x^j 的系数，成功时被修正
+ * \param recLength 码字数
+ * \param syn 伴随式，syn[1..errorWordCount]
+ * \param eraPos 擦除位置（rec 中的下标）
+ * \param eraCount 擦除数
+ * \param errorWordCount 纠错码字数
+ * \return Is block repaired? (DmtxTrue|DmtxFalse)
+ */
+static DmtxBoolean rsRepairErasures(DmtxByte *rec, int recLength, const DmtxByte *syn, const int *eraPos, int eraCount,
+                                    int errorWordCount)
+{
+    int i, j, k, r, lambdaLen, rootCount;
+    DmtxByte delta, deltaInv, num, den, val;
+    DmtxByte lambda[MAX_ERROR_WORD_COUNT + 2], prev[MAX_ERROR_WORD_COUNT + 2], next[MAX_ERROR_WORD_COUNT + 2];
+    DmtxByte omega[MAX_ERROR_WORD_COUNT + 1];
+    int roots[MAX_ERROR_WORD_COUNT + 1];
+    DmtxByte synCheck[MAX_ERROR_WORD_COUNT + 1];
+
+    if (eraCount >= errorWordCount) {
+        return DmtxFalse;
+    }
+
+    memset(lambda, 0x00, sizeof(lambda));
+
+    /* 擦除位置多项式 Γ(x) = Π(1 + α^j x) */
+    lambda[0] = 1;
+    for (k = 0; k < eraCount; k++) {
+        for (i = k + 1; i > 0; i--) {
+            lambda[i] = GfAdd(lambda[i], GfMultAntilog(lambda[i - 1], eraPos[k]));
+        }
+    }
+    memcpy(prev, lambda, sizeof(lambda));
+    lambdaLen = eraCount;
+
+    /* Berlekamp-Massey，从第 eraCount + 1 个伴随式开始 */
+    for (r = eraCount + 1; r <= errorWordCount; r++) {
+        for (delta = 0, i = 0; i < r; i++) {
+            delta = GfAdd(delta, GfMult(lambda[i], syn[r - i]));
+        }
+
+        memmove(prev + 1, prev, MAX_ERROR_WORD_COUNT + 1);
+        prev[0] = 0;
+
+        if (delta != 0) {
+            for (i = 0; i <= errorWordCount; i++) {
+                next[i] = GfAdd(lambda[i], GfMult(delta, prev[i]));
+            }
+
+            if (2 * lambdaLen <= r + eraCount - 1) {
+                lambdaLen = r + eraCount - lambdaLen;
+                deltaInv = antilog301[(NN - log301[delta]) % NN];
+                for (i = 0; i <= errorWordCount; i++) {
+                    prev[i] = GfMult(lambda[i], deltaInv);
+                }
+            }
+
+            memcpy(lambda, next, errorWordCount + 1);
+        }
+    }
+
+    if (2 * lambdaLen - eraCount >= errorWordCount) {
+        return DmtxFalse;
+    }
+
+    /* Chien 搜索：位置 j 出错时 Λ(α^-j) = 0 */
+    rootCount = 0;
+    for (j = 0; j < recLength; j++) {
+        for (val = 0, i = 0; i <= lambdaLen; i++) {
+            val = GfAdd(val, GfMultAntilog(lambda[i], (NN - (i * j) % NN) % NN));
+        }
+        if (val == 0) {
+            if (rootCount == lambdaLen) {
+                return DmtxFalse;
+            }
+            roots[rootCount++] = j;
+        }
+    }
+
+    if (rootCount != lambdaLen) {
+        return DmtxFalse;
+    }
+
+    /* Ω(x) = S(x)Λ(x) mod x^errorWordCount，S(x) = Σ S[i+1] x^i */
+    for (i = 0; i < errorWordCount; i++) {
+        for (omega[i] = 0, k = 0; k <= i; k++) {
+            omega[i] = GfAdd(omega[i], GfMult(syn[i - k + 1], lambda[k]));
+        }
+    }
+
+    /* Forney：e = Ω(X^-1) / Λ'(X^-1) */
+    for (k = 0; k < rootCount; k++) {
+        j = roots[k];
+
+        for (num = 0, i = 0; i < errorWordCount; i++) {
+            num = GfAdd(num, GfMultAntilog(omega[i], (NN - (i * j) % NN) % NN));
+        }
+        for (den = 0, i = 1; i <= lambdaLen; i += 2) {
+            den = GfAdd(den, GfMultAntilog(lambda[i], (NN - ((i - 1) * j) % NN) % NN));
+        }
+        if (den == 0) {
+            return DmtxFalse;
+        }
+
+        if (num != 0) {
+            rec[j] = GfAdd(rec[j], antilog301[log301[num] + NN - log301[den]]);
+        }
+    }
+
+    return (rsComputeSyndromes(synCheck, rec, recLength, errorWordCount) == DmtxFalse) ? DmtxTrue : DmtxFalse;
 }
@@ -64,34 +64,125 @@ extern DmtxPassFail dmtxRegionDestroy(DmtxRegion **reg)
 /**
  * \brief 寻找下一个二维码区域
  * \param dec Pointer to DmtxDecode information struct
- * \param timeout 超时时间 (如果为NULL则不限时)
+ * \param timeout 超时时间 (如果为NULL则不限时)，仅作用于本次调用，与
+ *                dmtxDecodeSetDeadline() 设置的截止时间取较早者
  */
 extern DmtxRegion *dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout)
 {
-    int locStatus;
-    DmtxPixelLoc loc;
+    int deadlineActive;
+    DmtxBoolean narrowed;
+    DmtxTime deadlineTime;
     DmtxRegion *reg;
 
+    /* 本次调用的超时临时收紧解码器截止时间，使其在各阶段内部生效 */
+    dec->deadline.abandoned = DmtxFalse;
+    deadlineActive = dec->deadline.active;
+    deadlineTime = dec->deadline.time;
+    narrowed = (timeout != NULL && (deadlineActive == DmtxFalse || timeout->sec < deadlineTime.sec ||
+                                    (timeout->sec == deadlineTime.sec && timeout->usec < deadlineTime.usec)))
+                   ? DmtxTrue
+                   : DmtxFalse;
+    if (narrowed == DmtxTrue) {
+        decodeApplyDeadline(dec, timeout);
+    }
+
     /* Continue until we find a region or run out of chances */
-    for (;;) {
-        locStatus = popGridLocation(&(dec->grid), &loc);
-        if (locStatus == DmtxRangeEnd) {
-            break;
-        }
+    dmtxDecodeStep(dec, DmtxUndefined, &reg);
 
-        /* 扫描确认loc坐标位置是否存在二维码区域 */
-        reg = dmtxRegionScanPixel(dec, loc.x, loc.y);
-        if (reg != NULL) {
-            return reg;  // 成功找到一个二维码区域
-        }
+    if (narrowed == DmtxTrue) {
+        decodeApplyDeadline(dec, (deadlineActive == DmtxTrue) ? &deadlineTime : NULL);
+    }
 
-        /* 超时检测 */
-        if (timeout != NULL && dmtxTimeExceeded(*timeout)) {
-            break;
+    return reg;
+}
+
+/**
+ * \brief 以有限的工作量推进区域搜索
+ *
+ * 与 dmtxRegionFindNext() 共用扫描状态：扫描位置、进行中的寻边和尺寸搜索都保存
+ * 在解码器中，工作量用完即返回，下次调用从中断处继续，已完成的工作不会重做。
+ * 一个工作单位约等于寻边走一步；直线拟合与校准边对齐不可中断，按寻边步数折算
+ * 后一次计入，所以单次调用可能略超出预算。
+ *
+ * \param dec 解码上下文
+ * \param workUnits 本次调用的工作量上限，DmtxUndefined 表示不限
+ * \param reg 返回 DmtxStepFound 时输出找到的区域（由调用者销毁），否则为 NULL
+ * \return \ref DmtxStepStatus
+ */
+extern int dmtxDecodeStep(DmtxDecode *dec, int workUnits, OUT DmtxRegion **reg)
+{
+    int work, budget;
+    int status;
+    DmtxPixelLoc loc;
+    DmtxScanState *st = &dec->step;
+
+    *reg = NULL;
+
+    /* 自动阈值在每帧开始扫描前确定 */
+    if (dec->edgeThreshAuto == DmtxTrue && dec->edgeThreshValid == DmtxFalse) {
+        decodeSurveyEdgeThresh(dec);
+    }
+
+    /* 空帧快速判定：几乎不可能包含二维码时直接结束本帧扫描 */
+    if (dec->presenceLevel > 0 && dec->presenceState == DmtxUndefined) {
+        dec->presenceState = decodeSurveyPresence(dec);
+    }
+    if (dec->presenceState == DmtxFalse) {
+        return DmtxStepDone;
+    }
+
+    status = DmtxStepYield;
+    for (work = 0; status == DmtxStepYield && (workUnits == DmtxUndefined || work < workUnits);) {
+        budget = (workUnits == DmtxUndefined) ? DmtxUndefined : workUnits - work;
+
+        switch (st->stage) {
+            case DmtxScanStageSeed:
+                /* 超时或取消检测 */
+                if (decodeDeadlineExceeded(dec, 1) || popScanLocation(dec, &loc) == DmtxRangeEnd) {
+                    status = DmtxStepDone;
+                    break;
+                }
+                work++;
+
+                /* 扫描确认loc坐标位置是否存在二维码区域 */
+                if (regionScanBegin(dec, st, loc) == DmtxPass) {
+                    st->stage = DmtxScanStageBlaze;
+                }
+                break;
+
+            case DmtxScanStageBlaze:
+                work += trailBlazeContinuous(dec, &st->reg, &st->blaze, budget);
+                if (st->blaze.sign >= -1) {
+                    break;
+                }
+
+                st->stage = (regionScanShape(dec, st) == DmtxPass) ? DmtxScanStageSize : DmtxScanStageSeed;
+                work += 3 * st->reg.stepsTotal;
+                break;
+
+            case DmtxScanStageSize:
+                work += matrixRegionFindSize(dec, &st->reg, &st->size, budget);
+                if (st->size.sizeIdx < st->size.sizeIdxEnd) {
+                    break;
+                }
+
+                st->stage = DmtxScanStageSeed;
+                if (matrixRegionFindSizeEnd(dec, &st->reg, &st->size) == DmtxPass) {
+                    *reg = dmtxRegionCreate(&st->reg);  // 成功找到一个二维码区域
+                    if (*reg != NULL) {
+                        status = DmtxStepFound;
+                    }
+                }
+                break;
+
+            default:
+                st->stage = DmtxScanStageSeed;
+                break;
         }
     }
+    st->work += work;
 
-    return NULL;
+    return status;
 }
 
 /**
@@ -99,66 +190,118 @@ extern DmtxRegion *dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout)
  */
 extern DmtxRegion *dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
 {
-    unsigned char *cache;
-    DmtxRegion reg;
-    DmtxPointFlow flowBegin;
+    DmtxScanState st;
     DmtxPixelLoc loc;
 
     loc.x = x;
     loc.y = y;
 
+    if (regionScanBegin(dec, &st, loc) == DmtxFail) {
+        return NULL;
+    }
+
+    trailBlazeContinuous(dec, &st.reg, &st.blaze, DmtxUndefined);
+    if (regionScanShape(dec, &st) == DmtxFail) {
+        return NULL;
+    }
+
+    /* 计算最匹配的二维码符号尺寸 */
+    matrixRegionFindSize(dec, &st.reg, &st.size, DmtxUndefined);
+    if (matrixRegionFindSizeEnd(dec, &st.reg, &st.size) == DmtxFail) {
+        return NULL;
+    }
+
+    /* Found a valid matrix region */
+    return dmtxRegionCreate(&st.reg);
+}
+
+/**
+ * \brief 检查扫描位置能否作为候选区域的起点，能则从该点开始寻边
+ */
+static DmtxPassFail regionScanBegin(DmtxDecode *dec, DmtxScanState *st, DmtxPixelLoc loc)
+{
+    unsigned char *cache;
+    DmtxPointFlow flowBegin;
+
     cache = dmtxDecodeGetCache(dec, loc.x, loc.y);
     if (cache == NULL) {
-        return NULL;
+        return DmtxFail;
     }
 
     if ((int)(*cache & 0x80) != 0x00) {
-        return NULL;
+        return DmtxFail;
     }
 
     /* Test for presence of any reasonable edge at this location */
     flowBegin = matrixRegionSeekEdge(dec, loc);
-    if (flowBegin.mag < (int)(dec->edgeThresh * 7.65 + 0.5)) {
-        return NULL;
+    if (flowBegin.mag < scaleIntensityThreshold(dec, flowBegin.plane, (int)(dec->edgeThresh * 7.65 + 0.5))) {
+        return DmtxFail;
     }
 
-    memset(&reg, 0x00, sizeof(DmtxRegion));
+    memset(&st->reg, 0x00, sizeof(DmtxRegion));
+
+    /* 以十字搜索像素点为起点，分别从正负方向寻边 */
+    return trailBlazeBegin(dec, &st->reg, &st->blaze, flowBegin, getMaxDiagonal(dec));
+}
+
+/**
+ * \brief 寻边完成后拟合L型框并对齐两条点线，成功后开始尺寸搜索
+ */
+static DmtxPassFail regionScanShape(DmtxDecode *dec, DmtxScanState *st)
+{
+    DmtxRegion *reg = &st->reg;
+
+    if (trailBlazeEnd(dec, reg, &st->blaze) == DmtxFail || reg->stepsTotal < 40) {
+        trailClear(dec, reg, 0x40);
+        return DmtxFail;
+    }
 
     /* Determine barcode orientation */
-    if (matrixRegionOrientation(dec, &reg, flowBegin) == DmtxFail) {
-        return NULL;
+    if (matrixRegionOrientation(dec, reg) == DmtxFail) {
+        return DmtxFail;
     }
-    if (dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
-        return NULL;
+    if (dmtxRegionUpdateXfrms(dec, reg) == DmtxFail) {
+        return DmtxFail;
     }
 
     /* 匹配顶部点线 */
-    if (matrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeTop) == DmtxFail) {
-        return NULL;
+    if (matrixRegionAlignCalibEdge(dec, reg, DmtxEdgeTop) == DmtxFail) {
+        return DmtxFail;
     }
-    if (dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
-        return NULL;
+    if (dmtxRegionUpdateXfrms(dec, reg) == DmtxFail) {
+        return DmtxFail;
     }
 
     /* 匹配右侧点线 */
-    if (matrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeRight) == DmtxFail) {
-        return NULL;
+    if (matrixRegionAlignCalibEdge(dec, reg, DmtxEdgeRight) == DmtxFail) {
+        return DmtxFail;
     }
-    if (dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail) {
-        return NULL;
+    if (dmtxRegionUpdateXfrms(dec, reg) == DmtxFail) {
+        return DmtxFail;
     }
 
     if (cbBuildMatrixRegion) {
-        cbBuildMatrixRegion(&reg);
+        cbBuildMatrixRegion(reg);
     }
 
-    /* 计算最匹配的二维码符号尺寸 */
-    if (matrixRegionFindSize(dec, &reg) == DmtxFail) {
-        return NULL;
+    matrixRegionFindSizeBegin(dec, reg, &st->size);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 放弃 dmtxDecodeStep() 中进行到一半的候选区域，清除它留在缓存中的寻边标记
+ */
+static void regionScanAbandon(DmtxDecode *dec)
+{
+    DmtxScanState *st = &dec->step;
+
+    if (st->stage == DmtxScanStageBlaze) {
+        trailBlazeEnd(dec, &st->reg, &st->blaze);
+        trailClear(dec, &st->reg, 0x40);
     }
 
-    /* Found a valid matrix region */
-    return dmtxRegionCreate(&reg);
+    st->stage = DmtxScanStageSeed;
 }
 
 /**
@@ -178,7 +321,7 @@ static DmtxPointFlow matrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc)
     int i;
     int strongIdx;
     int channelCount;
-    DmtxPointFlow flow, flowPlane[3] = {};
+    DmtxPointFlow flow, flowPlane[4] = {};
     DmtxPointFlow flowPos, flowPosBack;
     DmtxPointFlow flowNeg, flowNegBack;
 
@@ -186,14 +329,19 @@ static DmtxPointFlow matrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc)
 
     /* Find whether red, green, or blue shows the strongest edge */
     strongIdx = 0;
-    for (i = 0; i < channelCount; i++) {
-        flowPlane[i] = getPointFlow(dec, i, loc, dmtxNeighborNone);
-        if (i > 0 && flowPlane[i].mag > flowPlane[strongIdx].mag) {
-            strongIdx = i;
+    if (dec->luma != NULL) {
+        /* 只在预先生成的亮度平面上计算一次梯度 */
+        flowPlane[0] = getPointFlow(dec, DmtxPlaneLuma, loc, dmtxNeighborNone);
+    } else {
+        for (i = 0; i < channelCount; i++) {
+            flowPlane[i] = getPointFlow(dec, i, loc, dmtxNeighborNone);
+            if (i > 0 && flowPlane[i].mag > flowPlane[strongIdx].mag) {
+                strongIdx = i;
+            }
         }
     }
 
-    if (flowPlane[strongIdx].mag < 10) {  // 如果最强边缘的幅度小于阈值，返回空白边缘
+    if (flowPlane[strongIdx].mag < scaleIntensityThreshold(dec, flowPlane[strongIdx].plane, 10)) {  // 如果最强边缘的幅度小于阈值，返回空白边缘
         return dmtxBlankEdge;
     }
 
@@ -224,6 +372,40 @@ static DmtxPointFlow matrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc)
     return dmtxBlankEdge;
 }
 
+/**
+ * \brief 根据期望的符号尺寸判断符号形状
+ * \return DmtxSymbolSquareAuto | DmtxSymbolRectAuto | DmtxSymbolShapeAuto
+ */
+static int getSymbolShape(DmtxDecode *dec)
+{
+    if (dec->sizeIdxExpected == DmtxSymbolSquareAuto ||
+        (dec->sizeIdxExpected >= DmtxSymbol10x10 && dec->sizeIdxExpected <= DmtxSymbol144x144)) {
+        return DmtxSymbolSquareAuto;
+    } else if (dec->sizeIdxExpected == DmtxSymbolRectAuto ||
+               (dec->sizeIdxExpected >= DmtxSymbol8x18 && dec->sizeIdxExpected <= DmtxSymbol16x48)) {
+        return DmtxSymbolRectAuto;
+    }
+
+    return DmtxSymbolShapeAuto;
+}
+
+/**
+ * \brief 根据 edgeMax 计算寻边包围框的对角线上限
+ * \return 对角线上限，DmtxUndefined 表示不限
+ */
+static int getMaxDiagonal(DmtxDecode *dec)
+{
+    if (dec->edgeMax == DmtxUndefined) {
+        return DmtxUndefined;
+    }
+
+    if (getSymbolShape(dec) == DmtxSymbolRectAuto) {
+        return (int)(1.23 * dec->edgeMax + 0.5); /* sqrt(5/4) + 10% */
+    }
+
+    return (int)(1.56 * dec->edgeMax + 0.5); /* sqrt(2) + 10% */
+}
+
 /**
  * \brief 确定数据矩阵区域的方向和关键边界
  *
@@ -231,50 +413,23 @@ static DmtxPointFlow matrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc)
  * 它通过跟随边缘、查找最佳直线、评估交叉点等步骤来实现对区域的精确定位。
  *
  * \param dec 解码上下文，包含了解码设置和辅助信息
- * \param reg 待分析的数据矩阵区域结构体，用于存储识别结果
- * \param begin 起始追踪点，用于初始化追踪过程
+ * \param reg 待分析的数据矩阵区域结构体，寻边已完成，用于存储识别结果
  *
  * \retval DmtxPass 成功确定区域方向
  * \retval DmtxFail 未能成功确定区域方向或区域不符合预期条件
  */
-static DmtxPassFail matrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow begin)
+static DmtxPassFail matrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg)
 {
     int cross;
     int minArea;
     int scale;
     int symbolShape;
-    int maxDiagonal;
     DmtxPassFail err;
     DmtxBestLine line1x, line2x;
     DmtxBestLine line2n, line2p;
     DmtxFollow fTmp;
 
-    if (dec->sizeIdxExpected == DmtxSymbolSquareAuto ||
-        (dec->sizeIdxExpected >= DmtxSymbol10x10 && dec->sizeIdxExpected <= DmtxSymbol144x144)) {
-        symbolShape = DmtxSymbolSquareAuto;
-    } else if (dec->sizeIdxExpected == DmtxSymbolRectAuto ||
-               (dec->sizeIdxExpected >= DmtxSymbol8x18 && dec->sizeIdxExpected <= DmtxSymbol16x48)) {
-        symbolShape = DmtxSymbolRectAuto;
-    } else {
-        symbolShape = DmtxSymbolShapeAuto;
-    }
-
-    if (dec->edgeMax != DmtxUndefined) {
-        if (symbolShape == DmtxSymbolRectAuto) {
-            maxDiagonal = (int)(1.23 * dec->edgeMax + 0.5); /* sqrt(5/4) + 10% */
-        } else {
-            maxDiagonal = (int)(1.56 * dec->edgeMax + 0.5); /* sqrt(2) + 10% */
-        }
-    } else {
-        maxDiagonal = DmtxUndefined;
-    }
-
-    /* 以十字搜索像素点为起点，分别从正负方向寻边 */
-    err = trailBlazeContinuous(dec, reg, begin, maxDiagonal);
-    if (err == DmtxFail || reg->stepsTotal < 40) {
-        trailClear(dec, reg, 0x40);
-        return DmtxFail;
-    }
+    symbolShape = getSymbolShape(dec);
 
     /* Filter out region candidates that are smaller than expected */
     if (dec->edgeMin != DmtxUndefined) {
@@ -638,28 +793,25 @@ static double rightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2,
  * \param reg 当前处理的区域信息，用于定位和变换。
  * \param symbolRow 二维码坐标系下的行坐标
  * \param symbolCol 二维码坐标系下的列坐标
- * \param sizeIdx 二维码种类索引
+ * \param info 二维码种类的属性，见 dmtxGetSymbolInfo()
  * \param colorPlane 需要读取的颜色平面索引
  *
  * \return 返回模块位置的平均颜色值。
  */
-static int readModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, int sizeIdx, int colorPlane)
+static int readModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, const DmtxSymbolInfo *info,
+                           int colorPlane)
 {
     int i;
-    int symbolRows, symbolCols;
     int color, colorTmp;
     double sampleX[] = {0.5, 0.4, 0.5, 0.6, 0.5};
     double sampleY[] = {0.5, 0.5, 0.4, 0.5, 0.6};
     DmtxVector2 p;
 
-    symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-    symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
-
     /* 从给定坐标及其周围共5个点位获取图像像素并求平均值 */
     color = 0;
     for (i = 0; i < 5; i++) {
-        p.x = (1.0 / symbolCols) * (symbolCol + sampleX[i]);
-        p.y = (1.0 / symbolRows) * (symbolRow + sampleY[i]);
+        p.x = (1.0 / info->symbolCols) * (symbolCol + sampleX[i]);
+        p.y = (1.0 / info->symbolRows) * (symbolRow + sampleY[i]);
 
         dmtxMatrix3VMultiplyBy(&p, reg->fit2raw);  // 从二维码坐标转换到图像坐标
 
@@ -677,56 +829,123 @@ static int readModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int
 }
 
 /**
- * \brief 确定二维码尺寸（点线中黑白点的总数）
+ * \brief 同时读取模块在 0、1、2 三个颜色平面上的颜色值（Data Mosaic）
  *
- * 此函数遍历可能的条形码尺寸，通过计算校准模块上的对比度来确定最佳尺寸索引。
- * 它还会验证找到的尺寸索引是否与条形码图像的边缘和空白空间相匹配。
+ * 与分别对三个平面调用 readModuleColor() 的结果相同，但每个采样点只做一次坐标变换。
  *
- * \param[in] dec 解码上下文，包含解码设置和图像信息
- * \param reg 区域结构，用于存储找到的区域信息
+ * \param dec 解码上下文
+ * \param reg 当前处理的区域信息
+ * \param symbolRow 二维码坐标系下的行坐标
+ * \param symbolCol 二维码坐标系下的列坐标
+ * \param info 二维码种类的属性，见 dmtxGetSymbolInfo()
+ * \param colors 输出三个平面上的平均颜色值
  */
-static DmtxPassFail matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
+static void readModuleColorPlanes(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
+                                  const DmtxSymbolInfo *info, OUT int colors[3])
 {
-    int row, col;
-    int sizeIdxBeg, sizeIdxEnd;
-    int sizeIdx, bestSizeIdx;
-    int symbolRows, symbolCols;
-    int jumpCount, errors;
-    int color;
-    int colorOnAvg, bestColorOnAvg;
-    int colorOffAvg, bestColorOffAvg;
-    int contrast, bestContrast;
-    //   DmtxImage *img;
+    int i, plane;
+    int x, y;
+    int colorTmp[3];
+    double sampleX[] = {0.5, 0.4, 0.5, 0.6, 0.5};
+    double sampleY[] = {0.5, 0.5, 0.4, 0.5, 0.6};
+    DmtxVector2 p;
+
+    colors[0] = colors[1] = colors[2] = 0;
+    for (i = 0; i < 5; i++) {
+        p.x = (1.0 / info->symbolCols) * (symbolCol + sampleX[i]);
+        p.y = (1.0 / info->symbolRows) * (symbolRow + sampleY[i]);
 
-    //   img = dec->image;
-    bestSizeIdx = DmtxUndefined;
-    bestContrast = 0;
-    bestColorOnAvg = bestColorOffAvg = 0;
+        dmtxMatrix3VMultiplyBy(&p, reg->fit2raw);
+        x = (int)(p.x + 0.5);
+        y = (int)(p.y + 0.5);
+
+        if (cbPlotModule) {
+            cbPlotModule(dec, reg, x, y, 0);
+        }
+
+        for (plane = 0; plane < 3; plane++) {
+            dmtxDecodeGetPixelValue(dec, x, y, plane, &colorTmp[plane]);
+            colors[plane] += colorTmp[plane];
+        }
+    }
+
+    for (plane = 0; plane < 3; plane++) {
+        colors[plane] /= 5;
+    }
+}
+
+/**
+ * \brief 开始确定二维码尺寸：根据期望的符号尺寸设置待测试的模板范围
+ *
+ * \param dec 解码上下文
+ * \param reg 已对齐点线的区域
+ * \param size 尺寸搜索状态
+ */
+static void matrixRegionFindSizeBegin(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size)
+{
+    size->bestSizeIdx = DmtxUndefined;
+    size->bestContrast = 0;
+    size->contrastMin = scaleIntensityThreshold(dec, reg->flowBegin.plane, 20);
+    size->bestColorOnAvg = size->bestColorOffAvg = 0;
 
     if (dec->sizeIdxExpected == DmtxSymbolShapeAuto) {
-        sizeIdxBeg = 0;
-        sizeIdxEnd = DmtxSymbolSquareCount + DmtxSymbolRectCount;
+        size->sizeIdx = 0;
+        size->sizeIdxEnd = DmtxSymbolSquareCount + DmtxSymbolRectCount;
     } else if (dec->sizeIdxExpected == DmtxSymbolSquareAuto) {
-        sizeIdxBeg = 0;
-        sizeIdxEnd = DmtxSymbolSquareCount;
+        size->sizeIdx = 0;
+        size->sizeIdxEnd = DmtxSymbolSquareCount;
     } else if (dec->sizeIdxExpected == DmtxSymbolRectAuto) {
-        sizeIdxBeg = DmtxSymbolSquareCount;
-        sizeIdxEnd = DmtxSymbolSquareCount + DmtxSymbolRectCount;
+        size->sizeIdx = DmtxSymbolSquareCount;
+        size->sizeIdxEnd = DmtxSymbolSquareCount + DmtxSymbolRectCount;
     } else {
-        sizeIdxBeg = dec->sizeIdxExpected;
-        sizeIdxEnd = dec->sizeIdxExpected + 1;
+        size->sizeIdx = dec->sizeIdxExpected;
+        size->sizeIdxEnd = dec->sizeIdxExpected + 1;
     }
+}
+
+/**
+ * \brief 确定二维码尺寸（点线中黑白点的总数）
+ *
+ * 此函数遍历可能的条形码尺寸，通过计算校准模块上的对比度来确定最佳尺寸索引。
+ * 可以分多次调用，每次从上次停下的模板继续，全部测试完后 size->sizeIdx 等于
+ * size->sizeIdxEnd，再由 matrixRegionFindSizeEnd() 验证结果。
+ *
+ * \param[in] dec 解码上下文，包含解码设置和图像信息
+ * \param reg 区域结构，用于存储找到的区域信息
+ * \param size 尺寸搜索状态
+ * \param budget 工作量上限（每个模板按点线码元数计），DmtxUndefined 表示不限
+ * \return 本次完成的工作量
+ */
+static int matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size, int budget)
+{
+    int row, col;
+    int sizeIdx;
+    int symbolRows, symbolCols;
+    int color;
+    int colorOnAvg, colorOffAvg;
+    int contrast;
+    int work;
+    const DmtxSymbolInfo *info;
 
     /* 遍历每种DataMatrix种类模板，通过顶部和右侧的点线取颜色计算寻找对比度最大的模板 */
-    for (sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
-        symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-        symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
+    for (work = 0; size->sizeIdx < size->sizeIdxEnd && (budget == DmtxUndefined || work < budget);) {
+        if (decodeDeadlineExceeded(dec, DmtxDeadlineStride)) {
+            size->sizeIdx = size->sizeIdxEnd;
+            size->bestSizeIdx = DmtxUndefined;
+            break;
+        }
+
+        sizeIdx = size->sizeIdx++;
+        info = dmtxGetSymbolInfo(sizeIdx);
+        symbolRows = info->symbolRows;
+        symbolCols = info->symbolCols;
         colorOnAvg = colorOffAvg = 0;
+        work += symbolRows + symbolCols;
 
         /* 对DataMatrix顶部点线黑白码元分别求和 */
         row = symbolRows - 1;
         for (col = 0; col < symbolCols; col++) {
-            color = readModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
+            color = readModuleColor(dec, reg, row, col, info, reg->flowBegin.plane);
             if ((col & 0x01) != 0x00) {
                 colorOffAvg += color;
             } else {
@@ -737,7 +956,7 @@ static DmtxPassFail matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
         /* 对DataMatrix右侧点线黑白码元分别求和 */
         col = symbolCols - 1;
         for (row = 0; row < symbolRows; row++) {
-            color = readModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
+            color = readModuleColor(dec, reg, row, col, info, reg->flowBegin.plane);
             if ((row & 0x01) != 0x00) {
                 colorOffAvg += color;
             } else {
@@ -749,32 +968,48 @@ static DmtxPassFail matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
         colorOffAvg = (colorOffAvg * 2) / (symbolRows + symbolCols);
 
         contrast = abs(colorOnAvg - colorOffAvg);
-        if (contrast < 20) {
+        if (contrast < size->contrastMin) {
             continue;  // bit1码元与bit0码元的差值小于20直接认为该模板无效
         }
 
         /* 遍历所有类型，寻找效果最好的 */
-        if (contrast > bestContrast) {
-            bestContrast = contrast;
-            bestSizeIdx = sizeIdx;
-            bestColorOnAvg = colorOnAvg;
-            bestColorOffAvg = colorOffAvg;
+        if (contrast > size->bestContrast) {
+            size->bestContrast = contrast;
+            size->bestSizeIdx = sizeIdx;
+            size->bestColorOnAvg = colorOnAvg;
+            size->bestColorOffAvg = colorOffAvg;
         }
     }
 
+    return work;
+}
+
+/**
+ * \brief 采用对比度最大的模板，并验证它与条形码图像的边缘和空白空间相匹配
+ *
+ * \param[in] dec 解码上下文，包含解码设置和图像信息
+ * \param reg 区域结构，用于存储找到的区域信息
+ * \param size 已完成的尺寸搜索状态
+ */
+static DmtxPassFail matrixRegionFindSizeEnd(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size)
+{
+    int jumpCount, errors;
+    const DmtxSymbolInfo *info;
+
     /* 如果所有的模板都不是很匹配，直接返回错误 */
-    if (bestSizeIdx == DmtxUndefined || bestContrast < 20) {
+    if (size->bestSizeIdx == DmtxUndefined || size->bestContrast < 20) {
         return DmtxFail;
     }
 
-    reg->sizeIdx = bestSizeIdx;       // 最佳DataMatrix种类模板的索引号，共30种
-    reg->onColor = bestColorOnAvg;    // bit1的码元颜色值
-    reg->offColor = bestColorOffAvg;  // bit0的码元颜色值
+    reg->sizeIdx = size->bestSizeIdx;       // 最佳DataMatrix种类模板的索引号，共30种
+    reg->onColor = size->bestColorOnAvg;    // bit1的码元颜色值
+    reg->offColor = size->bestColorOffAvg;  // bit0的码元颜色值
 
-    reg->symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, reg->sizeIdx);
-    reg->symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, reg->sizeIdx);
-    reg->mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, reg->sizeIdx);
-    reg->mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, reg->sizeIdx);
+    info = dmtxGetSymbolInfo(reg->sizeIdx);
+    reg->symbolRows = info->symbolRows;
+    reg->symbolCols = info->symbolCols;
+    reg->mappingRows = info->mappingRows;
+    reg->mappingCols = info->mappingCols;
 
     /**
      * 以左上角水平往右检查
@@ -926,6 +1161,7 @@ static int countJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int ySta
     int tModule, tPrev;
     int darkOnLight;  // 白底黑码：1，黑底白码：0
     int color;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(reg->sizeIdx);
 
     DmtxAssert(xStart == 0 || yStart == 0);
     DmtxAssert(dir == DmtxDirRight || dir == DmtxDirUp);
@@ -942,14 +1178,14 @@ static int countJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int ySta
 
     darkOnLight = (int)(reg->offColor > reg->onColor);
     jumpThreshold = abs((int)(0.4 * (reg->onColor - reg->offColor) + 0.5));
-    color = readModuleColor(dec, reg, yStart, xStart, reg->sizeIdx, reg->flowBegin.plane);
+    color = readModuleColor(dec, reg, yStart, xStart, info, reg->flowBegin.plane);
     tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
     for (x = xStart + xInc, y = yStart + yInc;
          (dir == DmtxDirRight && x < reg->symbolCols) || (dir == DmtxDirUp && y < reg->symbolRows);
          x += xInc, y += yInc) {
         tPrev = tModule;
-        color = readModuleColor(dec, reg, y, x, reg->sizeIdx, reg->flowBegin.plane);
+        color = readModuleColor(dec, reg, y, x, info, reg->flowBegin.plane);
         tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
         if (state == DmtxModuleOff) {
@@ -1221,7 +1457,7 @@ static DmtxFollow followStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign)
 }
 
 /**
- * \brief 从flowBegin点出发，分别从正负方向寻找连续的边界线
+ * \brief 从flowBegin点出发，准备分别从正负方向寻找连续的边界线
  *
  * vaiiiooo
  * --------
@@ -1231,102 +1467,149 @@ static DmtxFollow followStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign)
  * 0x07 d = 3 bits points downstream 0-7
  *
  */
-static DmtxPassFail trailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin, int maxDiagonal)
+static DmtxPassFail trailBlazeBegin(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze, DmtxPointFlow flowBegin,
+                                    int maxDiagonal)
 {
-    int posAssigns, negAssigns, clears;
-    int sign;  // 方向标志，+1为正向，-1为负向
-    int steps;
-    unsigned char *cache, *cacheNext, *cacheBeg;
-    DmtxPointFlow flow, flowNext;
-    DmtxPixelLoc boundMin, boundMax;
-
-    boundMin = boundMax = flowBegin.loc;
-    cacheBeg = dmtxDecodeGetCache(dec, flowBegin.loc.x, flowBegin.loc.y);
-    if (cacheBeg == NULL) {
+    blaze->cacheBeg = dmtxDecodeGetCache(dec, flowBegin.loc.x, flowBegin.loc.y);
+    if (blaze->cacheBeg == NULL) {
         return DmtxFail;
     }
-    *cacheBeg = (0x80 | 0x40); /* Mark location as visited and assigned */
+    *blaze->cacheBeg = (0x80 | 0x40); /* Mark location as visited and assigned */
 
     reg->flowBegin = flowBegin;
+    reg->boundMin = reg->boundMax = flowBegin.loc;
 
-    posAssigns = negAssigns = 0;
-    for (sign = 1; sign >= -1; sign -= 2) {  // 分别进行正向和负向探索
-        flow = flowBegin;
-        cache = cacheBeg;
+    blaze->magMin = scaleIntensityThreshold(dec, flowBegin.plane, 50);
+    blaze->maxDiagonal = maxDiagonal;
+    blaze->posAssigns = blaze->negAssigns = 0;
+    blaze->sign = 1;  // 先正向，后负向
+    blaze->steps = 0;
+    blaze->flow = flowBegin;
+    blaze->cache = blaze->cacheBeg;
 
-        for (steps = 0;; steps++) {
-            // 检查是否超过最大对角线限制
-            if (maxDiagonal != DmtxUndefined &&
-                (boundMax.x - boundMin.x > maxDiagonal || boundMax.y - boundMin.y > maxDiagonal)) {
-                break;
-            }
+    return DmtxPass;
+}
 
-            /* 寻找梯度最大的下一个点 */
-            flowNext = findStrongestNeighbor(dec, flow, sign);
-            if (flowNext.mag < 50) {
-                break;
-            }
+/**
+ * \brief 沿边界线继续寻边，可分多次调用，两个方向都结束后 blaze->sign 小于 -1
+ *
+ * \param budget 最多走的步数，DmtxUndefined 表示一直走到两个方向都结束
+ * \return 本次完成的工作量（步数）
+ */
+static int trailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze, int budget)
+{
+    int work;
+    int sign;
+    unsigned char *cacheNext;
+    DmtxPointFlow flowNext;
 
-            /* Get the neighbor's cache location */
-            cacheNext = dmtxDecodeGetCache(dec, flowNext.loc.x, flowNext.loc.y);
-            if (cacheNext == NULL) {
-                break;
-            }
-            DmtxAssert(!(*cacheNext & 0x80));
-
-            /* Mark departure from current location. If flowing downstream
-             * (sign < 0) then departure vector here is the arrival vector
-             * of the next location. Upstream flow uses the opposite rule. */
-            *cache |= (sign < 0) ? flowNext.arrive : flowNext.arrive << 3;
-
-            /* Mark known direction for next location */
-            /* If testing downstream (sign < 0) then next upstream is opposite of next arrival */
-            /* If testing upstream (sign > 0) then next downstream is opposite of next arrival */
-            *cacheNext = (sign < 0) ? (((flowNext.arrive + 4) % 8) << 3) : ((flowNext.arrive + 4) % 8);
-            *cacheNext |= (0x80 | 0x40); /* Mark location as visited and assigned */
-            if (sign > 0) {
-                posAssigns++;
-            } else {
-                negAssigns++;
-            }
-            cache = cacheNext;
-            flow = flowNext;
+    for (work = 0; blaze->sign >= -1 && (budget == DmtxUndefined || work < budget); work++) {
+        sign = blaze->sign;
 
-            if (flow.loc.x > boundMax.x) {
-                boundMax.x = flow.loc.x;
-            } else if (flow.loc.x < boundMin.x) {
-                boundMin.x = flow.loc.x;
-            }
-            if (flow.loc.y > boundMax.y) {
-                boundMax.y = flow.loc.y;
-            } else if (flow.loc.y < boundMin.y) {
-                boundMin.y = flow.loc.y;
-            }
+        // 检查是否超时或超过最大对角线限制
+        if (decodeDeadlineExceeded(dec, 1) ||
+            (blaze->maxDiagonal != DmtxUndefined && (reg->boundMax.x - reg->boundMin.x > blaze->maxDiagonal ||
+                                                     reg->boundMax.y - reg->boundMin.y > blaze->maxDiagonal))) {
+            trailBlazeTurn(reg, blaze);
+            continue;
+        }
 
-            if (cbPlotPoint) {
-                cbPlotPoint(flow.loc, (sign > 0) ? 0.0F /*红*/ : 180.0F /*青*/, 1, 2);
-            }
+        /* 寻找梯度最大的下一个点 */
+        flowNext = findStrongestNeighbor(dec, blaze->flow, sign);
+        if (flowNext.mag < blaze->magMin) {
+            trailBlazeTurn(reg, blaze);
+            continue;
         }
 
+        /* Get the neighbor's cache location */
+        cacheNext = dmtxDecodeGetCache(dec, flowNext.loc.x, flowNext.loc.y);
+        if (cacheNext == NULL) {
+            trailBlazeTurn(reg, blaze);
+            continue;
+        }
+        DmtxAssert(!(*cacheNext & 0x80));
+
+        /* Mark departure from current location. If flowing downstream
+         * (sign < 0) then departure vector here is the arrival vector
+         * of the next location. Upstream flow uses the opposite rule. */
+        *blaze->cache |= (sign < 0) ? flowNext.arrive : flowNext.arrive << 3;
+
+        /* Mark known direction for next location */
+        /* If testing downstream (sign < 0) then next upstream is opposite of next arrival */
+        /* If testing upstream (sign > 0) then next downstream is opposite of next arrival */
+        *cacheNext = (sign < 0) ? (((flowNext.arrive + 4) % 8) << 3) : ((flowNext.arrive + 4) % 8);
+        *cacheNext |= (0x80 | 0x40); /* Mark location as visited and assigned */
         if (sign > 0) {
-            reg->finalPos = flow.loc;
-            reg->jumpToNeg = steps;
+            blaze->posAssigns++;
         } else {
-            reg->finalNeg = flow.loc;
-            reg->jumpToPos = steps;
+            blaze->negAssigns++;
+        }
+        blaze->cache = cacheNext;
+        blaze->flow = flowNext;
+        blaze->steps++;
+
+        if (flowNext.loc.x > reg->boundMax.x) {
+            reg->boundMax.x = flowNext.loc.x;
+        } else if (flowNext.loc.x < reg->boundMin.x) {
+            reg->boundMin.x = flowNext.loc.x;
+        }
+        if (flowNext.loc.y > reg->boundMax.y) {
+            reg->boundMax.y = flowNext.loc.y;
+        } else if (flowNext.loc.y < reg->boundMin.y) {
+            reg->boundMin.y = flowNext.loc.y;
+        }
+
+        if (cbPlotPoint) {
+            cbPlotPoint(flowNext.loc, (sign > 0) ? 0.0F /*红*/ : 180.0F /*青*/, 1, 2);
         }
     }
+
+    return work;
+}
+
+/**
+ * \brief 结束当前方向的寻边，记录终点后转到下一个方向
+ */
+static void trailBlazeTurn(DmtxRegion *reg, DmtxTrailBlaze *blaze)
+{
+    if (blaze->sign > 0) {
+        reg->finalPos = blaze->flow.loc;
+        reg->jumpToNeg = blaze->steps;
+    } else {
+        reg->finalNeg = blaze->flow.loc;
+        reg->jumpToPos = blaze->steps;
+    }
+
+    blaze->sign -= 2;
+    blaze->steps = 0;
+    blaze->flow = reg->flowBegin;
+    blaze->cache = blaze->cacheBeg;
+}
+
+/**
+ * \brief 结束寻边：清除路径上的"visited"标记并检查包围框大小
+ *
+ * 寻边未完成时（放弃候选区域）在当前位置截断。
+ */
+static DmtxPassFail trailBlazeEnd(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze)
+{
+    int clears;
+
+    while (blaze->sign >= -1) {
+        trailBlazeTurn(reg, blaze);
+    }
     reg->stepsTotal = reg->jumpToPos + reg->jumpToNeg;
-    reg->boundMin = boundMin;
-    reg->boundMax = boundMax;
 
     /* Clear "visited" bit from trail */
     clears = trailClear(dec, reg, 0x80);
-    DmtxAssert(posAssigns + negAssigns == clears - 1);
+    DmtxAssert(blaze->posAssigns + blaze->negAssigns == clears - 1);
+
+    if (dec->deadline.expired == DmtxTrue) {
+        return DmtxFail;
+    }
 
-    /* XXX clean this up ... redundant test above */
-    if (maxDiagonal != DmtxUndefined &&
-        (boundMax.x - boundMin.x > maxDiagonal || boundMax.y - boundMin.y > maxDiagonal)) {
+    if (blaze->maxDiagonal != DmtxUndefined && (reg->boundMax.x - reg->boundMin.x > blaze->maxDiagonal ||
+                                                reg->boundMax.y - reg->boundMin.y > blaze->maxDiagonal)) {
         return DmtxFail;
     }
 
@@ -1346,6 +1629,7 @@ static int trailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line,
     int travel, outward;
     int xDiff, yDiff;
     int steps;
+    int magMin;
     int stepDir, dirMap[] = {0, 1, 2, 7, 8, 3, 6, 5, 4};
     DmtxPassFail err;
     DmtxPixelLoc beforeStep, afterStep;
@@ -1354,6 +1638,7 @@ static int trailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line,
     int xStep, yStep;
 
     loc0 = line.loc;
+    magMin = scaleIntensityThreshold(dec, reg->flowBegin.plane, 50);
     flow = getPointFlow(dec, reg->flowBegin.plane, loc0, dmtxNeighborNone);
     distSqMax = (line.xDelta * line.xDelta) + (line.yDelta * line.yDelta);
     steps = 0;
@@ -1378,7 +1663,7 @@ static int trailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line,
                 return DmtxFail;
             }
 
-            if (flowNext.mag < 50 || outward < 0 || (outward == 0 && travel < 0)) {
+            if (flowNext.mag < magMin || outward < 0 || (outward == 0 && travel < 0)) {
                 onEdge = DmtxFalse;
             } else {
                 bresLineStep(&line, travel, outward);
@@ -1389,7 +1674,7 @@ static int trailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line,
         if (onEdge == DmtxFalse) {
             bresLineStep(&line, 1, 0);
             flow = getPointFlow(dec, reg->flowBegin.plane, line.loc, dmtxNeighborNone);
-            if (flow.mag > 50) {
+            if (flow.mag > magMin) {
                 onEdge = DmtxTrue;
             }
         }
@@ -1540,6 +1825,10 @@ static DmtxBestLine findBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step
 
     /* Test each angle for steps along path */
     for (step = 0; step < tripSteps; step++) {
+        if (decodeDeadlineExceeded(dec, 1)) {
+            break;
+        }
+
         xDiff = follow.loc.x - rHp.x;
         yDiff = follow.loc.y - rHp.y;
 
@@ -1578,7 +1867,7 @@ static DmtxBestLine findBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step
 
     line.angle = angleBest;
     line.hOffset = hOffsetBest;
-    line.mag = hough[hOffsetBest][angleBest];
+    line.mag = (dec->deadline.expired == DmtxTrue) ? 0 : hough[hOffsetBest][angleBest];
 
     return line;
 }
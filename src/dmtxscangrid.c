@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dmtx.h"
@@ -24,6 +25,15 @@
  * \brief 初始化扫描网格
  */
 static DmtxScanGrid initScanGrid(DmtxDecode *dec)
+{
+    return initScanGridBounds(dec, dmtxDecodeGetProp(dec, DmtxPropXmin), dmtxDecodeGetProp(dec, DmtxPropXmax),
+                              dmtxDecodeGetProp(dec, DmtxPropYmin), dmtxDecodeGetProp(dec, DmtxPropYmax));
+}
+
+/**
+ * \brief 在指定矩形范围内初始化扫描网格
+ */
+static DmtxScanGrid initScanGridBounds(DmtxDecode *dec, int xMin, int xMax, int yMin, int yMax)
 {
     int scale, smallestFeature;
     int xExtent, yExtent, maxExtent;
@@ -35,10 +45,10 @@ static DmtxScanGrid initScanGrid(DmtxDecode *dec)
     scale = dmtxDecodeGetProp(dec, DmtxPropScale);
     smallestFeature = dmtxDecodeGetProp(dec, DmtxPropScanGap) / scale;
 
-    grid.xMin = dmtxDecodeGetProp(dec, DmtxPropXmin);
-    grid.xMax = dmtxDecodeGetProp(dec, DmtxPropXmax);
-    grid.yMin = dmtxDecodeGetProp(dec, DmtxPropYmin);
-    grid.yMax = dmtxDecodeGetProp(dec, DmtxPropYmax);
+    grid.xMin = xMin;
+    grid.xMax = xMax;
+    grid.yMin = yMin;
+    grid.yMax = yMax;
 
     /* Values that get set once */
     xExtent = grid.xMax - grid.xMin;
@@ -172,3 +182,221 @@ static void setDerivedFields(DmtxScanGrid *grid)
     grid->pixelCount = 0;
     grid->xCenter = grid->yCenter = grid->startPos;
 }
+
+/**
+ * \brief 重置扫描进度：网格回到整个 ROI 的起点，按单元扫描的顺序在下次扫描前重新生成
+ */
+static void resetScanOrder(DmtxDecode *dec)
+{
+    regionScanAbandon(dec);
+
+    dec->grid = initScanGrid(dec);
+
+    free(dec->scanCells);
+    dec->scanCells = NULL;
+    dec->scanCellCount = 0;
+    dec->scanCellIdx = 0;
+}
+
+/**
+ * \brief 按单元扫描时，把 ROI 划分为边长约 cellSize 的单元，不足一个单元的余量并入最后一行/列
+ */
+static void getScanCellBounds(DmtxDecode *dec, int cell, int *xMin, int *xMax, int *yMin, int *yMax)
+{
+    int col = cell % dec->scanCellCols;
+    int row = cell / dec->scanCellCols;
+
+    *xMin = dec->xMin + col * dec->scanCellSize;
+    *xMax = (col == dec->scanCellCols - 1) ? dec->xMax : *xMin + dec->scanCellSize - 1;
+    *yMin = dec->yMin + row * dec->scanCellSize;
+    *yMax = (row == dec->scanCellRows - 1) ? dec->yMax : *yMin + dec->scanCellSize - 1;
+}
+
+/**
+ * \brief 将扫描网格切换到第 scanCellIdx 个单元
+ */
+static void setScanCell(DmtxDecode *dec)
+{
+    int xMin, xMax, yMin, yMax;
+
+    getScanCellBounds(dec, dec->scanCells[dec->scanCellIdx], &xMin, &xMax, &yMin, &yMax);
+
+    /*
+     * 网格边长按 xMax - xMin 取整到 2^n - 1，单元边长恰为 2^n 时会漏掉最后一行/列。
+     * 按多一个像素的范围生成网格，再收回到单元边界，越界的位置由 popGridLocation() 跳过。
+     */
+    dec->grid = initScanGridBounds(dec, xMin, xMax + 1, yMin, yMax + 1);
+    dec->grid.xMax = xMax;
+    dec->grid.yMax = yMax;
+}
+
+/**
+ * \brief 按 score 降序、单元索引升序比较 (score, cell) 对
+ */
+static int compareScanCells(const void *a, const void *b)
+{
+    const int *pa = (const int *)a;
+    const int *pb = (const int *)b;
+
+    if (pa[0] != pb[0]) {
+        return (pa[0] > pb[0]) ? -1 : 1;
+    }
+
+    return pa[1] - pb[1];
+}
+
+/**
+ * \brief 以负的 Morton 码作为单元得分，使降序排序后按 Z 形顺序访问
+ *
+ * 图像坐标原点在左下角，而缓冲区默认自上而下存储；行号取内存中的行序，
+ * 使遍历从缓冲区开头连续向后推进。
+ */
+static int *getMortonOrder(DmtxDecode *dec)
+{
+    int i, bit, col, row, code;
+    int *score;
+
+    score = (int *)malloc(dec->scanCellCols * dec->scanCellRows * sizeof(int));
+    if (score == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < dec->scanCellCols * dec->scanCellRows; i++) {
+        col = i % dec->scanCellCols;
+        row = i / dec->scanCellCols;
+        if (!(dec->image->imageFlip & DmtxFlipY) && dec->image->rowSizeBytes > 0) {
+            row = dec->scanCellRows - 1 - row;
+        }
+
+        for (code = 0, bit = 0; bit < 15; bit++) {
+            code |= ((col >> bit) & 0x01) << (2 * bit);
+            code |= ((row >> bit) & 0x01) << (2 * bit + 1);
+        }
+        score[i] = -code;
+    }
+
+    return score;
+}
+
+/**
+ * \brief 生成按单元扫描的访问顺序
+ *
+ * - DmtxScanOrderSaliency: 由粗略显著性图（边缘密度与正交边缘响应）决定，最可能包含二维码的单元先扫描。
+ * - DmtxScanOrderTiled: 按 Morton（Z 形）顺序逐块扫描，相邻的块在内存中也相邻，
+ *   一个块内的所有种子点集中处理，大幅减少大图像上的 cache/TLB 缺失。
+ *
+ * 每个单元内部仍按原有的由粗到细十字网格完整扫描，所有单元的并集就是整个 ROI，因此覆盖范围与默认顺序相同。
+ *
+ * \return DmtxPass | DmtxFail（内存不足时退回默认顺序）
+ */
+static DmtxPassFail buildScanCells(DmtxDecode *dec)
+{
+    int i, cellCount;
+    int *score, *pairs;
+
+    dec->scanCellSize = (dec->scanOrder == DmtxScanOrderTiled) ? 32 : 64;
+    dec->scanCellCols = max((dec->xMax - dec->xMin + 1) / dec->scanCellSize, 1);
+    dec->scanCellRows = max((dec->yMax - dec->yMin + 1) / dec->scanCellSize, 1);
+    cellCount = dec->scanCellCols * dec->scanCellRows;
+
+    dec->scanCells = (int *)malloc(cellCount * sizeof(int));
+    pairs = (int *)malloc(cellCount * 2 * sizeof(int));
+    score = (dec->scanOrder == DmtxScanOrderTiled) ? getMortonOrder(dec) : decodeSurveySaliency(dec);
+    if (dec->scanCells == NULL || pairs == NULL || score == NULL) {
+        free(dec->scanCells);
+        free(pairs);
+        free(score);
+        dec->scanCells = NULL;
+        return DmtxFail;
+    }
+
+    for (i = 0; i < cellCount; i++) {
+        pairs[i * 2] = score[i];
+        pairs[i * 2 + 1] = i;
+    }
+    qsort(pairs, cellCount, 2 * sizeof(int), compareScanCells);
+
+    for (i = 0; i < cellCount; i++) {
+        dec->scanCells[i] = pairs[i * 2 + 1];
+    }
+
+    free(pairs);
+    free(score);
+
+    dec->scanCellCount = cellCount;
+    dec->scanCellIdx = 0;
+    setScanCell(dec);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 返回下一个扫描位置；按单元扫描时，当前单元结束后自动切换到下一个单元
+ */
+static int popScanLocation(DmtxDecode *dec, DmtxPixelLoc *locPtr)
+{
+    int locStatus;
+
+    /* 生成失败时本帧按默认顺序扫描整个 ROI，scanOrder 属性保持不变，下一帧重新尝试 */
+    if (dec->scanOrder != DmtxScanOrderRaster && dec->scanCellCount == 0) {
+        if (buildScanCells(dec) == DmtxFail) {
+            dec->scanCellCount = DmtxUndefined;
+        }
+    }
+
+    for (;;) {
+        locStatus = popGridLocation(&(dec->grid), locPtr);
+        if (locStatus != DmtxRangeEnd || dec->scanCells == NULL || dec->scanCellIdx + 1 >= dec->scanCellCount) {
+            return locStatus;
+        }
+
+        dec->scanCellIdx++;
+        setScanCell(dec);
+    }
+}
+
+/**
+ * \brief 网格中已取出的位置占全部位置的比例
+ */
+static double getGridProgress(DmtxScanGrid *grid)
+{
+    int extent, side;
+    int col, row;
+    double done, all, pixelTotal;
+
+    if (grid->extent == 0 || grid->extent < grid->minExtent) {
+        return 1.0;
+    }
+
+    done = all = 0.0;
+    for (extent = grid->maxExtent, side = 1; extent > 0 && extent >= grid->minExtent; extent /= 2, side *= 2) {
+        pixelTotal = 2.0 * extent - 1.0;
+        all += side * side * pixelTotal;
+
+        if (extent > grid->extent) {
+            done += side * side * pixelTotal;
+        } else if (extent == grid->extent) {
+            col = min((grid->xCenter - grid->startPos) / grid->jumpSize, side);
+            row = min((grid->yCenter - grid->startPos) / grid->jumpSize, side);
+            done += (row * side + col) * pixelTotal + grid->pixelCount;
+        }
+    }
+
+    return min(done / all, 1.0);
+}
+
+/**
+ * \brief 本帧扫描位置的完成度
+ * \return 0~1000
+ */
+static int getScanProgress(DmtxDecode *dec)
+{
+    double progress;
+
+    progress = getGridProgress(&(dec->grid));
+    if (dec->scanCells != NULL && dec->scanCellCount > 0) {
+        progress = (dec->scanCellIdx + progress) / dec->scanCellCount;
+    }
+
+    return (int)(progress * 1000.0);
+}
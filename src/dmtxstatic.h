@@ -20,6 +20,10 @@
 #include <assert.h>
 #include <stdio.h>
 
+#if !defined(DMTX_NO_THREADS) && !defined(_WIN32)
+#    include <pthread.h>
+#endif
+
 #include "dmtx.h"
 
 #define DmtxAlmostZero 0.000001
@@ -54,6 +58,36 @@
 #define DmtxUnlatchExplicit 0
 #define DmtxUnlatchImplicit 1
 
+/* Virtual channel index addressing the decoder-owned luma plane */
+#define DmtxPlaneLuma 4
+
+/* Work units (fine loop steps) between clock reads when checking the deadline */
+#define DmtxDeadlineStride 64
+
+/* Module confidence (0~1) below which a module is marked DmtxModuleUnsure and its codeword becomes an erasure */
+#define DmtxModuleUnsureLevel 0.3
+
+/* Largest per-block error word count and interleaved block count over all symbol sizes */
+#define DmtxMaxBlockErrorWords 68
+#define DmtxMaxInterleavedBlocks 10
+
+/* Flags written by one thread and polled by another */
+#if defined(__GNUC__) || defined(__clang__)
+#    define DmtxAtomicLoad(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#    define DmtxAtomicStore(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#    define DmtxAtomicCasPtr(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#    define DmtxAtomicCasLong(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#else
+/* MSVC gives volatile accesses acquire/release semantics */
+#    include <intrin.h>
+#    define DmtxAtomicLoad(p) (*(p))
+#    define DmtxAtomicStore(p, v) (*(p) = (v))
+#    define DmtxAtomicCasPtr(p, expected, desired) \
+        (_InterlockedCompareExchangePointer((void *volatile *)(p), (desired), (expected)) == (expected))
+#    define DmtxAtomicCasLong(p, expected, desired) \
+        (_InterlockedCompareExchange((p), (desired), (expected)) == (expected))
+#endif
+
 #define DmtxChannelValid 0x00
 #define DmtxChannelUnsupportedChar 0x01 << 0
 #define DmtxChannelCannotUnlatch 0x01 << 1
@@ -109,6 +143,139 @@ typedef enum DmtxEncodeOption_enum
     DmtxEncodeFull     /* Use only fully expanded format within scheme */
 } DmtxEncodeOption;
 
+/* dmtxDecodeStep() 中候选区域所处的阶段 */
+typedef enum DmtxScanStage_enum
+{
+    DmtxScanStageSeed,  /* 取下一个扫描位置 */
+    DmtxScanStageBlaze, /* 寻边进行中 */
+    DmtxScanStageSize   /* 尺寸搜索进行中 */
+} DmtxScanStage;
+
+/* RS 纠错失败后依次尝试的模块判定策略，均基于已缓存的模块颜色 */
+typedef enum DmtxModuleThresh_enum
+{
+    DmtxModuleThreshTally,      /* 四方向跳变计数（默认，跳变阈值为对比度的 0.4） */
+    DmtxModuleThreshOtsu,       /* 所有数据模块颜色的全局 Otsu 阈值 */
+    DmtxModuleThreshLocal,      /* 5x5 邻域模块的局部阈值，邻域对比度不足时退回 Otsu */
+    DmtxModuleThreshTallyLoose, /* 跳变计数，跳变阈值为对比度的 0.25 */
+    DmtxModuleThreshTallyStrict /* 跳变计数，跳变阈值为对比度的 0.55 */
+} DmtxModuleThresh;
+
+#define DmtxModuleThreshCount 5
+
+/* 区域内每个模块的采样颜色，按 二维码坐标 row * cols + col 存放 */
+typedef struct DmtxModuleSamples_struct
+{
+    int rows;
+    int cols;
+    int *color;
+} DmtxModuleSamples;
+
+/* 码字排布表：某种符号尺寸下每个码字的每一位所在的模块 */
+typedef struct DmtxPlacementMap_struct
+{
+    int mappingRows;
+    int mappingCols;
+    int codewordCount;
+    unsigned short *moduleIdx; /* moduleIdx[chr * 8 + bit] 为第 chr 个码字第 bit 位（0 为最高位）在模块矩阵中的下标 */
+} DmtxPlacementMap;
+
+/* 工作线程的入口 */
+typedef void (*DmtxThreadFunc)(void *arg);
+
+/* 工作线程。定义 DMTX_NO_THREADS 时不创建线程，threadStart() 总是失败，由调用者在当前线程执行 */
+typedef struct DmtxThread_struct
+{
+#if defined(DMTX_NO_THREADS)
+    int handle;
+#elif defined(_WIN32)
+    void *handle; /* HANDLE */
+#else
+    pthread_t handle;
+#endif
+    DmtxThreadFunc func;
+    void *arg;
+} DmtxThread;
+
+/* 计数信号量，供线程在队列为空时阻塞等待 */
+typedef struct DmtxSemaphore_struct
+{
+#if defined(DMTX_NO_THREADS)
+    long count;
+#elif defined(_WIN32)
+    void *handle; /* HANDLE */
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    long count;
+#endif
+} DmtxSemaphore;
+
+/* 有界无锁多生产者多消费者队列的一格，seq 表示该格当前可供哪个位置的入队或出队使用 */
+typedef struct DmtxRingCell_struct
+{
+    volatile long seq;
+    void *data;
+} DmtxRingCell;
+
+/* 有界无锁多生产者多消费者队列，容量为 2 的幂 */
+typedef struct DmtxRing_struct
+{
+    long mask;          /* 容量 - 1 */
+    DmtxRingCell *cell; /* mask + 1 格 */
+    volatile long head; /* 下一个出队位置 */
+    volatile long tail; /* 下一个入队位置 */
+} DmtxRing;
+
+/* dmtxDecodePipeline() 中交给解码线程的一个候选区域 */
+typedef struct DmtxPipelineItem_struct
+{
+    long seq;         /* 找到区域的次序，结果按此排序 */
+    DmtxRegion reg;   /* 候选区域 */
+    DmtxMessage *msg; /* 解码结果，失败时为 NULL */
+} DmtxPipelineItem;
+
+/* dmtxDecodePipeline() 中寻找线程与解码线程共享的状态 */
+typedef struct DmtxPipelineRun_struct
+{
+    DmtxDecode *dec;       /* 调用者的解码器，只由寻找线程修改 */
+    int fix;               /* 纠错上限 */
+    DmtxRing todo;         /* 待解码的区域 */
+    DmtxRing done;         /* 解码完成的区域 */
+    DmtxSemaphore todoSem; /* todo 中每个区域一个计数；寻找结束后每个解码线程再加一个，取不到区域即退出 */
+    DmtxSemaphore doneSem; /* done 中每个区域一个计数 */
+} DmtxPipelineRun;
+
+/* dmtxDecodePipeline() 的一个解码线程 */
+typedef struct DmtxPipelineWorker_struct
+{
+    DmtxBoolean started;
+    DmtxThread thread;
+    DmtxDecode dec; /* 调用者解码器的浅拷贝，只用于采样和解码，不能销毁 */
+    DmtxPipelineRun *run;
+} DmtxPipelineWorker;
+
+/* dmtxDecodeVariants() 中所有变体共享的状态 */
+typedef struct DmtxVariantRun_struct
+{
+    DmtxImage *img;
+    DmtxDecode **dec;
+    DmtxDecodeAllOpts *opts;
+    int count;            /* 变体数 */
+    int required;         /* 成功所需的符号数 */
+    volatile long winner; /* 最先成功的变体，DmtxUndefined 表示还没有 */
+} DmtxVariantRun;
+
+/* dmtxDecodeVariants() 中的一个变体 */
+typedef struct DmtxVariantJob_struct
+{
+    int idx;
+    DmtxBoolean started; /* 是否在工作线程中运行 */
+    DmtxThread thread;
+    DmtxVariantRun *run;
+    DmtxDecodeResults results;
+} DmtxVariantJob;
+
 typedef enum DmtxRange_enum
 {
     DmtxRangeGood,
@@ -192,11 +359,21 @@ typedef void (*DmtxLogLockFn)(DmtxBoolean lock, void *udata);
 /* dmtxregion.c */
 static double rightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2, double angle);
 static DmtxPointFlow matrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc0);
-static DmtxPassFail matrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin);
+static DmtxPassFail regionScanBegin(DmtxDecode *dec, DmtxScanState *st, DmtxPixelLoc loc);
+static DmtxPassFail regionScanShape(DmtxDecode *dec, DmtxScanState *st);
+static void regionScanAbandon(DmtxDecode *dec);
+static int getSymbolShape(DmtxDecode *dec);
+static int getMaxDiagonal(DmtxDecode *dec);
+static DmtxPassFail matrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg);
 static long distanceSquared(DmtxPixelLoc a, DmtxPixelLoc b);
-static int readModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, int sizeIdx, int colorPlane);
-
-static DmtxPassFail matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg);
+static int readModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, const DmtxSymbolInfo *info,
+                           int colorPlane);
+static void readModuleColorPlanes(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
+                                  const DmtxSymbolInfo *info, OUT int colors[3]);
+
+static void matrixRegionFindSizeBegin(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size);
+static int matrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size, int budget);
+static DmtxPassFail matrixRegionFindSizeEnd(DmtxDecode *dec, DmtxRegion *reg, DmtxSizeSearch *size);
 static int countJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir);
 static DmtxPointFlow getPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive);
 static DmtxPointFlow findStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign);
@@ -204,7 +381,11 @@ static DmtxFollow followSeek(DmtxDecode *dec, DmtxRegion *reg, int seek);
 static DmtxFollow followSeekLoc(DmtxDecode *dec, DmtxPixelLoc loc);
 static DmtxFollow followStep(DmtxDecode *dec, DmtxRegion *reg, DmtxFollow followBeg, int sign);
 static DmtxFollow followStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign);
-static DmtxPassFail trailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin, int maxDiagonal);
+static DmtxPassFail trailBlazeBegin(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze, DmtxPointFlow flowBegin,
+                                    int maxDiagonal);
+static int trailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze, int budget);
+static void trailBlazeTurn(DmtxRegion *reg, DmtxTrailBlaze *blaze);
+static DmtxPassFail trailBlazeEnd(DmtxDecode *dec, DmtxRegion *reg, DmtxTrailBlaze *blaze);
 static int trailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int streamDir);
 static int trailClear(DmtxDecode *dec, DmtxRegion *reg, int clearMask);
 static DmtxBestLine findBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step0, int step1, int streamDir,
@@ -218,24 +399,81 @@ static DmtxPassFail bresLineStep(DmtxBresLine *line, int travel, int outward);
 /*static void WriteDiagnosticImage(DmtxDecode *dec, DmtxRegion *reg, char *imagePath);*/
 
 /* dmtxdecode.c */
-static void tallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, INOUT int tally[][24], int xOrigin, int yOrigin,
-                             int mapWidth, int mapHeight, DmtxDirection dir);
-static DmtxPassFail populateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxMessage *msg);
+static void decodeApplyDeadline(DmtxDecode *dec, DmtxTime *deadline);
+static DmtxBoolean decodeDeadlineExceeded(DmtxDecode *dec, int cost);
+static int scaleIntensityThreshold(DmtxDecode *dec, int channel, int threshold);
+static DmtxMessage *decodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxBoolean useOutputBuffer);
+static void decodeDeliverOutput(DmtxDecode *dec, DmtxMessage *msg);
+static DmtxPassFail decodeResultsAppend(DmtxDecode *dec, INOUT DmtxDecodeResults *results, DmtxRegion *reg,
+                                        DmtxMessage *msg);
+static DmtxPassFail decodePopulatedArray(int sizeIdx, INOUT DmtxMessage *msg, int fix);
+static unsigned char *getCodewordErasures(DmtxMessage *msg, int sizeIdx);
+static void tallyModuleJumps(DmtxRegion *reg, const DmtxModuleSamples *samples, INOUT int tally[][24], int xOrigin,
+                             int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir, double jumpRatio);
+static DmtxPassFail sampleModuleColors(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxModuleSamples *samples);
+static DmtxPassFail sampleModuleColorPlanes(DmtxDecode *dec, DmtxRegion *reg, OUT DmtxModuleSamples samples[3]);
+static void cacheFillRegion(DmtxDecode *dec, DmtxRegion *reg);
+static DmtxPassFail decodeModuleSamples(DmtxDecode *dec, DmtxRegion *reg, const DmtxModuleSamples *samples, int fix,
+                                        INOUT DmtxMessage *msg);
+static int compareModuleColors(const void *a, const void *b);
+static int getModuleOtsuThreshold(DmtxRegion *reg, const DmtxModuleSamples *samples);
+static int getModuleLocalThreshold(DmtxRegion *reg, const DmtxModuleSamples *samples, int symbolRow, int symbolCol,
+                                   int globalThreshold);
+static void populateArrayFromMatrix(DmtxRegion *reg, const DmtxModuleSamples *samples, int policy,
+                                    OUT DmtxMessage *msg);
+
+/* dmtxdecodecache.c */
+static DmtxPassFail resultCacheSetCapacity(DmtxResultCache *cache, int capacity);
+static void resultCacheClear(DmtxResultCache *cache);
+static void resultCacheFree(DmtxResultCache *cache);
+static unsigned int resultCacheHash(const unsigned char *array, size_t size);
+static DmtxPassFail resultCacheLookup(DmtxResultCache *cache, unsigned int hash, int sizeIdx, int fix,
+                                      INOUT DmtxMessage *msg);
+static void resultCacheStore(DmtxResultCache *cache, unsigned int hash, int sizeIdx, int fix, const unsigned char *key,
+                             const DmtxMessage *msg);
+static DmtxPassFail decodeCachedArray(DmtxDecode *dec, int sizeIdx, INOUT DmtxMessage *msg, int fix);
+
+/* dmtxdecodevariant.c */
+static void variantRun(void *arg);
+
+/* dmtxdecodepipeline.c */
+static void pipelineWork(void *arg);
+static void pipelineFree(DmtxPipelineRun *run);
+static DmtxMessage *pipelineDecodeRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
+static int comparePipelineItems(const void *a, const void *b);
+
+/* dmtxdecodeplane.c */
+static DmtxPassFail decodeBuildLumaPlane(DmtxDecode *dec);
+static int getSmoothedSample(unsigned char *src, int width, int height, int x, int y);
+static DmtxPassFail decodeBinarizePlane(DmtxDecode *dec);
+static DmtxPassFail decodeUpdatePlane(DmtxDecode *dec);
+
+/* dmtxdecodesurvey.c */
+static DmtxPointFlow surveyFlow(DmtxDecode *dec, DmtxPixelLoc loc);
+static void decodeSurveyEdgeThresh(DmtxDecode *dec);
+static int *surveyCellHistogram(DmtxDecode *dec, int step, int cellSize, int cellCols, int cellRows);
+static DmtxBoolean decodeSurveyPresence(DmtxDecode *dec);
+static int *decodeSurveySaliency(DmtxDecode *dec);
 
 /* dmtxdecodescheme.c */
 static DmtxPassFail decodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned char *outputStart);
 static int getEncodationScheme(unsigned char cw);
-static void pushOutputWord(DmtxMessage *msg, int value);
-static void pushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value);
-static void pushOutputMacroHeader(DmtxMessage *msg, int macroType);
-static void pushOutputMacroTrailer(DmtxMessage *msg);
+static DmtxBoolean outputHasRoom(const DmtxMessage *msg, size_t count);
+static DmtxPassFail pushOutputWord(DmtxMessage *msg, int value);
+static DmtxPassFail pushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value);
+static DmtxPassFail pushOutputMacroHeader(DmtxMessage *msg, int macroType);
+static DmtxPassFail pushOutputMacroTrailer(DmtxMessage *msg);
 static unsigned char *decodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
+static void unpackC40TextTriplet(const unsigned char *ptr, int values[3]);
 static unsigned char *decodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd,
                                           DmtxScheme encScheme);
 static unsigned char *decodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
 static unsigned char *decodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
 static unsigned char *decodeSchemeBase256(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
 
+/* dmtxmessage.c */
+static DmtxMessage *messageCreate(int sizeIdx, int symbolFormat, unsigned char *output, size_t outputSize);
+
 /* dmtxencode.c */
 static void printPattern(DmtxEncode *encode);
 static int encodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme,
@@ -244,32 +482,43 @@ static int encodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int si
 /* dmtxplacemod.c */
 static int modulePlacementEcc200(INOUT unsigned char *modules, OUT unsigned char *codewords, int sizeIdx,
                                  int moduleOnColor);
-static void patternShapeStandard(unsigned char *modules, int mappingRows, int mappingCols, int row, int col,
-                                 unsigned char *codeword, int moduleOnColor);
-static void patternShapeSpecial1(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor);
-static void patternShapeSpecial2(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor);
-static void patternShapeSpecial3(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor);
-static void patternShapeSpecial4(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword,
-                                 int moduleOnColor);
-static void placeModule(unsigned char *modules, int mappingRows, int mappingCols, int row, int col,
-                        unsigned char *codeword, int mask, int moduleOnColor);
+static const DmtxPlacementMap *getPlacementMap(int sizeIdx);
+static DmtxPlacementMap *buildPlacementMap(int sizeIdx);
+static void patternShapeStandard(DmtxPlacementMap *map, unsigned char *visited, int chr, int row, int col);
+static void patternShapeSpecial1(DmtxPlacementMap *map, unsigned char *visited, int chr);
+static void patternShapeSpecial2(DmtxPlacementMap *map, unsigned char *visited, int chr);
+static void patternShapeSpecial3(DmtxPlacementMap *map, unsigned char *visited, int chr);
+static void patternShapeSpecial4(DmtxPlacementMap *map, unsigned char *visited, int chr);
+static void placeModule(DmtxPlacementMap *map, unsigned char *visited, int row, int col, int chr, int bit);
 
 /* dmtxreedsol.c */
 static DmtxPassFail rsEncode(DmtxMessage *message, int sizeIdx);
-static DmtxPassFail rsDecode(unsigned char *code, int sizeIdx, int fix);
-static DmtxPassFail rsGenPoly(DmtxByteList *gen, int errorWordCount);
-static DmtxBoolean rsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords);
-static DmtxBoolean rsFindErrorLocatorPoly(DmtxByteList *elp, const DmtxByteList *syn, int errorWordCount,
+static DmtxPassFail rsDecode(unsigned char *code, int sizeIdx, int fix, const unsigned char *erasures);
+static const DmtxByte *rsGetGenPolyLog(int errorWordCount);
+static void rsShiftRemainder(DmtxByte *rem, const DmtxByte *genLog, int errorWordCount, DmtxByte word);
+static void rsAddSyndromeTerms(DmtxByte *syn, DmtxByte value, int j, int errorWordCount);
+static DmtxBoolean rsComputeBlockSyndromes(DmtxByte syn[][DmtxMaxBlockErrorWords + 1], const unsigned char *code,
+                                           const DmtxSymbolInfo *info);
+static DmtxBoolean rsComputeSyndromes(DmtxByte *syn, const DmtxByte *rec, int recLength, int blockErrorWords);
+static DmtxBoolean rsFindErrorLocatorPoly(DmtxByte *elpOut, int *lambdaOut, const DmtxByte *syn, int errorWordCount,
                                           int maxCorrectable);
-static DmtxBoolean rsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp);
-static DmtxPassFail rsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp,
-                                   const DmtxByteList *syn);
+static DmtxBoolean rsFindErrorLocations(DmtxByte *loc, int *locLength, const DmtxByte *elp, int lambda);
+static void rsRepairErrors(DmtxByte *rec, const DmtxByte *loc, const DmtxByte *elp, int lambda, const DmtxByte *syn);
+static DmtxBoolean rsRepairErasures(DmtxByte *rec, int recLength, const DmtxByte *syn, const int *eraPos, int eraCount,
+                                    int errorWordCount);
 
 /* dmtxscangrid.c */
 static DmtxScanGrid initScanGrid(DmtxDecode *dec);
+static DmtxScanGrid initScanGridBounds(DmtxDecode *dec, int xMin, int xMax, int yMin, int yMax);
+static void resetScanOrder(DmtxDecode *dec);
+static void getScanCellBounds(DmtxDecode *dec, int cell, int *xMin, int *xMax, int *yMin, int *yMax);
+static void setScanCell(DmtxDecode *dec);
+static int compareScanCells(const void *a, const void *b);
+static int *getMortonOrder(DmtxDecode *dec);
+static DmtxPassFail buildScanCells(DmtxDecode *dec);
+static int popScanLocation(DmtxDecode *dec, DmtxPixelLoc *locPtr);
+static double getGridProgress(DmtxScanGrid *grid);
+static int getScanProgress(DmtxDecode *dec);
 static int popGridLocation(DmtxScanGrid *grid, OUT DmtxPixelLoc *locPtr);
 static int getGridCoordinates(DmtxScanGrid *grid, OUT DmtxPixelLoc *locPtr);
 static void setDerivedFields(DmtxScanGrid *grid);
@@ -277,8 +526,25 @@ static void setDerivedFields(DmtxScanGrid *grid);
 /* dmtxsymbol.c */
 static int findSymbolSize(int dataWords, int sizeIdxRequest);
 
+/* dmtxthread.c */
+static DmtxPassFail threadStart(DmtxThread *thread, DmtxThreadFunc func, void *arg);
+static void threadJoin(DmtxThread *thread);
+static DmtxPassFail semaphoreInit(DmtxSemaphore *sem);
+static void semaphoreFree(DmtxSemaphore *sem);
+static void semaphorePost(DmtxSemaphore *sem, int count);
+static void semaphoreWait(DmtxSemaphore *sem);
+static DmtxBoolean semaphoreTryWait(DmtxSemaphore *sem);
+
+/* dmtxring.c */
+static DmtxPassFail ringInit(DmtxRing *ring, long capacity);
+static void ringFree(DmtxRing *ring);
+static DmtxPassFail ringPush(DmtxRing *ring, void *data);
+static DmtxPassFail ringPop(DmtxRing *ring, OUT void **data);
+
 /* dmtximage.c */
 static int getBitsPerPixel(int pack);
+static int getPixelOffset(DmtxImage *img, int x, int y);
+static int getBayerGreen(DmtxImage *img, int x, int y, int offset);
 
 /* dmtxencodestream.c */
 static DmtxEncodeStream streamInit(DmtxByteList *input, DmtxByteList *output);
@@ -17,6 +17,40 @@
 
 #include "dmtx.h"
 
+/* 各种符号尺寸的属性，按 sizeIdx 排列 */
+static const DmtxSymbolInfo symbolInfo[DmtxSymbolSquareCount + DmtxSymbolRectCount] = {
+    {10, 10, 8, 8, 1, 1, 8, 8, 1, 5, 2, 3, 5, 2},                   /* 10x10 */
+    {12, 12, 10, 10, 1, 1, 10, 10, 1, 7, 3, 5, 7, 3},               /* 12x12 */
+    {14, 14, 12, 12, 1, 1, 12, 12, 1, 10, 5, 8, 10, 5},             /* 14x14 */
+    {16, 16, 14, 14, 1, 1, 14, 14, 1, 12, 6, 12, 12, 6},            /* 16x16 */
+    {18, 18, 16, 16, 1, 1, 16, 16, 1, 14, 7, 18, 14, 7},            /* 18x18 */
+    {20, 20, 18, 18, 1, 1, 18, 18, 1, 18, 9, 22, 18, 9},            /* 20x20 */
+    {22, 22, 20, 20, 1, 1, 20, 20, 1, 20, 10, 30, 20, 10},          /* 22x22 */
+    {24, 24, 22, 22, 1, 1, 22, 22, 1, 24, 12, 36, 24, 12},          /* 24x24 */
+    {26, 26, 24, 24, 1, 1, 24, 24, 1, 28, 14, 44, 28, 14},          /* 26x26 */
+    {32, 32, 14, 14, 2, 2, 28, 28, 1, 36, 18, 62, 36, 18},          /* 32x32 */
+    {36, 36, 16, 16, 2, 2, 32, 32, 1, 42, 21, 86, 42, 21},          /* 36x36 */
+    {40, 40, 18, 18, 2, 2, 36, 36, 1, 48, 24, 114, 48, 24},         /* 40x40 */
+    {44, 44, 20, 20, 2, 2, 40, 40, 1, 56, 28, 144, 56, 28},         /* 44x44 */
+    {48, 48, 22, 22, 2, 2, 44, 44, 1, 68, 34, 174, 68, 34},         /* 48x48 */
+    {52, 52, 24, 24, 2, 2, 48, 48, 2, 42, 21, 204, 84, 42},         /* 52x52 */
+    {64, 64, 14, 14, 4, 4, 56, 56, 2, 56, 28, 280, 112, 56},        /* 64x64 */
+    {72, 72, 16, 16, 4, 4, 64, 64, 4, 36, 18, 368, 144, 72},        /* 72x72 */
+    {80, 80, 18, 18, 4, 4, 72, 72, 4, 48, 24, 456, 192, 96},        /* 80x80 */
+    {88, 88, 20, 20, 4, 4, 80, 80, 4, 56, 28, 576, 224, 112},       /* 88x88 */
+    {96, 96, 22, 22, 4, 4, 88, 88, 4, 68, 34, 696, 272, 136},       /* 96x96 */
+    {104, 104, 24, 24, 4, 4, 96, 96, 6, 56, 28, 816, 336, 168},     /* 104x104 */
+    {120, 120, 18, 18, 6, 6, 108, 108, 6, 68, 34, 1050, 408, 204},  /* 120x120 */
+    {132, 132, 20, 20, 6, 6, 120, 120, 8, 62, 31, 1304, 496, 248},  /* 132x132 */
+    {144, 144, 22, 22, 6, 6, 132, 132, 10, 62, 31, 1558, 620, 310}, /* 144x144 */
+    {8, 18, 6, 16, 1, 1, 6, 16, 1, 7, 3, 5, 7, 3},                  /* 8x18 */
+    {8, 32, 6, 14, 2, 1, 6, 28, 1, 11, 5, 10, 11, 5},               /* 8x32 */
+    {12, 26, 10, 24, 1, 1, 10, 24, 1, 14, 7, 16, 14, 7},            /* 12x26 */
+    {12, 36, 10, 16, 2, 1, 10, 32, 1, 18, 9, 22, 18, 9},            /* 12x36 */
+    {16, 36, 14, 16, 2, 1, 14, 32, 1, 24, 12, 32, 24, 12},          /* 16x36 */
+    {16, 48, 14, 22, 2, 1, 14, 44, 1, 28, 14, 49, 28, 14},          /* 16x48 */
+};
+
 /**
  * \brief Retrieve symbol index from rows and columns
  * \param rows
@@ -25,17 +59,32 @@
  */
 extern int getSizeIdxFromSymbolDimension(int rows, int cols)
 {
-    int symbolRows, symbolCols, i;
-    for (i = 0; i < 30; i++) {
-        symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, i);
-        symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, i);
-        if (rows == symbolRows && cols == symbolCols) {
+    int i;
+    for (i = 0; i < DmtxSymbolSquareCount + DmtxSymbolRectCount; i++) {
+        if (rows == symbolInfo[i].symbolRows && cols == symbolInfo[i].symbolCols) {
             return i;
         }
     }
     return -1;
 }
 
+/**
+ * \brief 根据规格索引返回二维码规格的全部参数
+ *
+ * 需要同一尺寸的多个属性（尤其在循环中）时，先取一次描述表再直接读取字段，比逐个调用 dmtxGetSymbolAttribute() 便宜。
+ *
+ * \param[in] sizeIdx 规格索引
+ * \return 只读的属性表，sizeIdx 无效时返回 NULL
+ */
+extern const DmtxSymbolInfo *dmtxGetSymbolInfo(int sizeIdx)
+{
+    if (sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount) {
+        return NULL;
+    }
+
+    return &symbolInfo[sizeIdx];
+}
+
 /**
  * \brief 根据规格索引返回二维码规格各个参数
  * \param[in] attribute 属性 \ref DmtxSymAttribute
@@ -44,66 +93,41 @@ extern int getSizeIdxFromSymbolDimension(int rows, int cols)
  */
 extern int dmtxGetSymbolAttribute(int attribute, int sizeIdx)
 {
-    static const int symbolRows[] = {10, 12, 14, 16, 18, 20,  22,  24,  26,  32, 36, 40, 44, 48, 52,
-                                     64, 72, 80, 88, 96, 104, 120, 132, 144, 8,  8,  12, 12, 16, 16};
-
-    static const int symbolCols[] = {10, 12, 14, 16, 18, 20,  22,  24,  26,  32, 36, 40, 44, 48, 52,
-                                     64, 72, 80, 88, 96, 104, 120, 132, 144, 18, 32, 26, 36, 36, 48};
-
-    static const int dataRegionRows[] = {8,  10, 12, 14, 16, 18, 20, 22, 24, 14, 16, 18, 20, 22, 24,
-                                         14, 16, 18, 20, 22, 24, 18, 20, 22, 6,  6,  10, 10, 14, 14};
-
-    static const int dataRegionCols[] = {8,  10, 12, 14, 16, 18, 20, 22, 24, 14, 16, 18, 20, 22, 24,
-                                         14, 16, 18, 20, 22, 24, 18, 20, 22, 16, 14, 24, 16, 16, 22};
-
-    static const int horizDataRegions[] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2,
-                                           4, 4, 4, 4, 4, 4, 6, 6, 6, 1, 2, 1, 2, 2, 2};
-
-    static const int interleavedBlocks[] = {1, 1, 1, 1, 1, 1, 1, 1, 1,  1, 1, 1, 1, 1, 2,
-                                            2, 4, 4, 4, 4, 6, 6, 8, 10, 1, 1, 1, 1, 1, 1};
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(sizeIdx);
 
-    static const int symbolDataWords[] = {3,   5,   8,   12,  18,  22,  30,   36,   44,   62, 86, 114, 144, 174, 204,
-                                          280, 368, 456, 576, 696, 816, 1050, 1304, 1558, 5,  10, 16,  22,  32,  49};
-
-    static const int blockErrorWords[] = {5,  7,  10, 12, 14, 18, 20, 24, 28, 36, 42, 48, 56, 68, 42,
-                                          56, 36, 48, 56, 68, 56, 68, 62, 62, 7,  11, 14, 18, 24, 28};
-
-    static const int blockMaxCorrectable[] = {2,  3,  5,  6,  7,  9,  10, 12, 14, 18, 21, 24, 28, 34, 21,
-                                              28, 18, 24, 28, 34, 28, 34, 31, 31, 3,  5,  7,  9,  12, 14};
-
-    if (sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount) {
+    if (info == NULL) {
         return DmtxUndefined;
     }
 
     switch (attribute) {
         case DmtxSymAttribSymbolRows:
-            return symbolRows[sizeIdx];
+            return info->symbolRows;
         case DmtxSymAttribSymbolCols:
-            return symbolCols[sizeIdx];
+            return info->symbolCols;
         case DmtxSymAttribDataRegionRows:
-            return dataRegionRows[sizeIdx];
+            return info->dataRegionRows;
         case DmtxSymAttribDataRegionCols:
-            return dataRegionCols[sizeIdx];
+            return info->dataRegionCols;
         case DmtxSymAttribHorizDataRegions:
-            return horizDataRegions[sizeIdx];
+            return info->horizDataRegions;
         case DmtxSymAttribVertDataRegions:
-            return (sizeIdx < DmtxSymbolSquareCount) ? horizDataRegions[sizeIdx] : 1;
+            return info->vertDataRegions;
         case DmtxSymAttribMappingMatrixRows:
-            return dataRegionRows[sizeIdx] * dmtxGetSymbolAttribute(DmtxSymAttribVertDataRegions, sizeIdx);
+            return info->mappingRows;
         case DmtxSymAttribMappingMatrixCols:
-            return dataRegionCols[sizeIdx] * horizDataRegions[sizeIdx];
+            return info->mappingCols;
         case DmtxSymAttribInterleavedBlocks:
-            return interleavedBlocks[sizeIdx];
+            return info->interleavedBlocks;
         case DmtxSymAttribBlockErrorWords:
-            return blockErrorWords[sizeIdx];
+            return info->blockErrorWords;
         case DmtxSymAttribBlockMaxCorrectable:
-            return blockMaxCorrectable[sizeIdx];
+            return info->blockMaxCorrectable;
         case DmtxSymAttribSymbolDataWords:
-            return symbolDataWords[sizeIdx];
+            return info->symbolDataWords;
         case DmtxSymAttribSymbolErrorWords:
-            return blockErrorWords[sizeIdx] * interleavedBlocks[sizeIdx];
+            return info->symbolErrorWords;
         case DmtxSymAttribSymbolMaxCorrectable:
-            return blockMaxCorrectable[sizeIdx] * interleavedBlocks[sizeIdx];
+            return info->symbolMaxCorrectable;
     }
 
     return DmtxUndefined;
@@ -117,18 +141,14 @@ extern int dmtxGetSymbolAttribute(int attribute, int sizeIdx)
  */
 extern int dmtxGetBlockDataSize(int sizeIdx, int blockIdx)
 {
-    int symbolDataWords;
-    int interleavedBlocks;
+    const DmtxSymbolInfo *info = dmtxGetSymbolInfo(sizeIdx);
     int count;
 
-    symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-    interleavedBlocks = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
-
-    if (symbolDataWords < 1 || interleavedBlocks < 1) {
+    if (info == NULL) {
         return DmtxUndefined;
     }
 
-    count = (int)(symbolDataWords / interleavedBlocks);
+    count = info->symbolDataWords / info->interleavedBlocks;
 
     return (sizeIdx == DmtxSymbol144x144 && blockIdx < 8) ? count + 1 : count;
 }
@@ -158,7 +178,7 @@ static int findSymbolSize(int dataWords, int sizeIdxRequest)
         }
 
         for (sizeIdx = idxBeg; sizeIdx < idxEnd; sizeIdx++) {
-            if (dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx) >= dataWords) {
+            if (symbolInfo[sizeIdx].symbolDataWords >= dataWords) {
                 break;
             }
         }
@@ -418,6 +418,7 @@ static void printPattern(DmtxEncode *enc)
     int symbolRow, symbolCol;
     int pixelRow, pixelCol;
     int moduleStatus;
+    int white;
     size_t rowSize, height;
     int rgb[3];
     double sxy, txy;
@@ -439,6 +440,7 @@ static void printPattern(DmtxEncode *enc)
     height = dmtxImageGetProp(enc->image, DmtxPropHeight);
 
     memset(enc->image->pxl, 0xff, rowSize * height);
+    white = (1 << enc->image->bitsPerChannel[0]) - 1;
 
     for (symbolRow = 0; symbolRow < enc->region.symbolRows; symbolRow++) {
         for (symbolCol = 0; symbolCol < enc->region.symbolCols; symbolCol++) {
@@ -452,10 +454,10 @@ static void printPattern(DmtxEncode *enc)
 
             moduleStatus = dmtxSymbolModuleStatus(enc->message, enc->region.sizeIdx, symbolRow, symbolCol);
 
-            if (enc->image->bytesPerPixel == 1) {
+            if (enc->image->channelCount < 3) {
                 for (i = pixelRow; i < pixelRow + enc->moduleSize; i++) {
                     for (j = pixelCol; j < pixelCol + enc->moduleSize; j++) {
-                        rgb[0] = ((moduleStatus & DmtxModuleOnRed) != 0x00) ? 0 : 255;
+                        rgb[0] = ((moduleStatus & DmtxModuleOnRed) != 0x00) ? 0 : white;
                         dmtxImageSetPixelValue(enc->image, j, i, 0, rgb[0]);
                     }
                 }
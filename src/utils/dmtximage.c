@@ -68,6 +68,22 @@
  *     bottom-to-top; use DmtxFlipY
  *   - Many popular image formats (e.g., PNG, GIF) store rows
  *     top-to-bottom; use DmtxFlipNone
+ *   - YUV camera frames (DmtxPackYUYV, DmtxPackNV12, DmtxPackI420, ...) are
+ *     read in place: pass a pointer to the luma plane (or to the packed YUYV
+ *     data) and its stride via DmtxPropRowSizeBytes. Chroma is never touched,
+ *     so semi-planar and planar formats only need the Y plane to be mapped.
+ *   - 16 bpp grayscale (DmtxPack16bppK, DmtxPack16bppKBE) is read at native
+ *     precision. Sensors delivering fewer bits (e.g., Mono12) should set
+ *     DmtxPropSignificantBits so that edge thresholds are scaled to match.
+ *   - Raw Bayer frames (DmtxPackBayerRGGB, ...) are not demosaiced. Green
+ *     sites are sampled directly; a coordinate landing on a red or blue site
+ *     returns the mean of the two green sites of its 2x2 cell. The pattern
+ *     names the colors of the first two rows in memory, starting at pxl.
+ *   - dmtxImageCreateView() wraps a sub-rectangle of a larger buffer: pxl
+ *     points at the first pixel of the first row in memory and strideBytes
+ *     is the distance between rows, which may be negative for buffers stored
+ *     bottom-up (e.g., cv::Mat ROIs, Windows DIBs). Bayer views starting at
+ *     an odd column or row must name the pattern seen at that position.
  */
 
 /**
@@ -114,14 +130,12 @@ extern DmtxImage *dmtxImageCreate(unsigned char *pxl, int width, int height, int
             break;
         case DmtxPack16bppRGB:
         case DmtxPack16bppBGR:
-        case DmtxPack16bppYCbCr:
             dmtxImageSetChannel(img, 0, 5);
             dmtxImageSetChannel(img, 5, 5);
             dmtxImageSetChannel(img, 10, 5);
             break;
         case DmtxPack24bppRGB:
         case DmtxPack24bppBGR:
-        case DmtxPack24bppYCbCr:
         case DmtxPack32bppRGBX:
         case DmtxPack32bppBGRX:
             dmtxImageSetChannel(img, 0, 8);
@@ -152,6 +166,30 @@ extern DmtxImage *dmtxImageCreate(unsigned char *pxl, int width, int height, int
             dmtxImageSetChannel(img, 16, 8);
             dmtxImageSetChannel(img, 24, 8);
             break;
+        case DmtxPack16bppYCbCr: /* Y0 Cb Y1 Cr */
+        case DmtxPack24bppYCbCr:
+        case DmtxPackYUYV:
+        case DmtxPackNV12:
+        case DmtxPackNV21:
+        case DmtxPackI420:
+        case DmtxPackYV12:
+            /* 只读取亮度（Y）通道，色度数据不参与解码 */
+            dmtxImageSetChannel(img, 0, 8);
+            break;
+        case DmtxPackUYVY:
+            dmtxImageSetChannel(img, 8, 8);
+            break;
+        case DmtxPackBayerRGGB:
+        case DmtxPackBayerBGGR:
+        case DmtxPackBayerGRBG:
+        case DmtxPackBayerGBRG:
+            /* 单一的亮度（绿色）逻辑通道 */
+            dmtxImageSetChannel(img, 0, 8);
+            break;
+        case DmtxPack16bppK:
+        case DmtxPack16bppKBE:
+            dmtxImageSetChannel(img, 0, 16);
+            break;
         default:
             return NULL;
     }
@@ -159,6 +197,32 @@ extern DmtxImage *dmtxImageCreate(unsigned char *pxl, int width, int height, int
     return img;
 }
 
+/**
+ * \brief 创建一个引用已有像素缓冲区的图像视图
+ *
+ * 与 dmtxImageCreate 相同，但显式指定行跨度，可指向更大帧中的任意子矩形，无需拷贝。
+ *
+ * \param[in] pxl 子图像第一行第一个像素的地址
+ * \param[in] strideBytes 相邻两行起始地址的字节差，可以为负数（自下而上存储的缓冲区）
+ * \return 失败返回 NULL
+ */
+extern DmtxImage *dmtxImageCreateView(unsigned char *pxl, int width, int height, int strideBytes, int pack)
+{
+    DmtxImage *img;
+
+    img = dmtxImageCreate(pxl, width, height, pack);
+    if (img == NULL) {
+        return NULL;
+    }
+
+    if (dmtxImageSetProp(img, DmtxPropRowSizeBytes, strideBytes) == DmtxFail) {
+        dmtxImageDestroy(&img);
+        return NULL;
+    }
+
+    return img;
+}
+
 /**
  * \brief Free libdmtx image memory
  * \param[in] img pointer to img location
@@ -209,7 +273,21 @@ extern DmtxPassFail dmtxImageSetProp(DmtxImage *img, int prop, int value)
     switch (prop) {
         case DmtxPropRowPadBytes:
             img->rowPadBytes = value;
-            img->rowSizeBytes = img->width * (img->bitsPerPixel / 8) + img->rowPadBytes;
+            img->rowSizeBytes = img->width * img->bytesPerPixel + img->rowPadBytes;
+            break;
+        case DmtxPropRowSizeBytes:
+            /* 显式指定行跨度（例如 V4L2 的 bytesperline），负数表示行在内存中逆序排列 */
+            if (abs(value) < img->width * img->bytesPerPixel) {
+                return DmtxFail;
+            }
+            img->rowSizeBytes = value;
+            img->rowPadBytes = abs(value) - img->width * img->bytesPerPixel;
+            break;
+        case DmtxPropSignificantBits:
+            if (img->bitsPerPixel != 16 || img->channelCount != 1 || value < 9 || value > 16) {
+                return DmtxFail;
+            }
+            img->bitsPerChannel[0] = value;
             break;
         case DmtxPropImageFlip:
             img->imageFlip = value;
@@ -250,6 +328,8 @@ extern int dmtxImageGetProp(DmtxImage *img, int prop)
             return img->imageFlip;
         case DmtxPropChannelCount:
             return img->channelCount;
+        case DmtxPropSignificantBits:
+            return img->bitsPerChannel[0];
         default:
             break;
     }
@@ -259,6 +339,9 @@ extern int dmtxImageGetProp(DmtxImage *img, int prop)
 
 /**
  * \brief 根据给定的坐标 (x, y) 计算并返回图像中对应像素的字节偏移量
+ *
+ * \note 行跨度为负数时偏移量也可能为负数，此时应先用 dmtxImageContainsInt 判断坐标是否有效，
+ *       不能依赖 DmtxUndefined 判断。
  */
 extern int dmtxImageGetByteOffset(DmtxImage *img, int x, int y)
 {
@@ -269,11 +352,7 @@ extern int dmtxImageGetByteOffset(DmtxImage *img, int x, int y)
         return DmtxUndefined;
     }
 
-    if (img->imageFlip & DmtxFlipY) {
-        return (y * img->rowSizeBytes + x * img->bytesPerPixel);
-    }
-
-    return ((img->height - y - 1) * img->rowSizeBytes + x * img->bytesPerPixel);
+    return getPixelOffset(img, x, y);
 }
 
 /**
@@ -293,18 +372,23 @@ extern int dmtxImageGetByteOffset(DmtxImage *img, int x, int y)
 extern DmtxPassFail dmtxImageGetPixelValue(DmtxImage *img, int x, int y, int channel, int *value)
 {
     int offset;
-    /* unsigned char *pixelPtr;
-       int pixelValue;
+    unsigned char *pixelPtr;
+    /* int pixelValue;
        int mask;
        int bitShift; */
 
     DmtxAssert(img != NULL);
     DmtxAssert(channel < img->channelCount);
 
-    offset = dmtxImageGetByteOffset(img, x, y);
-    if (offset == DmtxUndefined) {
+    if (dmtxImageContainsInt(img, 0, x, y) == DmtxFalse) {
         return DmtxFail;
     }
+    offset = getPixelOffset(img, x, y);
+
+    if (img->pixelPacking >= DmtxPackBayerRGGB && img->pixelPacking <= DmtxPackBayerGBRG) {
+        *value = getBayerGreen(img, x, y, offset);
+        return DmtxPass;
+    }
 
     switch (img->bitsPerChannel[channel]) {
         case 1:
@@ -324,7 +408,18 @@ extern DmtxPassFail dmtxImageGetPixelValue(DmtxImage *img, int x, int y, int cha
         case 8:
             DmtxAssert(img->channelStart[channel] % 8 == 0);
             DmtxAssert(img->bitsPerPixel % 8 == 0);
-            *value = img->pxl[offset + channel];
+            *value = img->pxl[offset + img->channelStart[channel] / 8];
+            break;
+        default:
+            /* 9~16 位有效数据存放在 2 字节字中，低位对齐 */
+            DmtxAssert(img->bitsPerChannel[channel] <= 16);
+            pixelPtr = img->pxl + offset + img->channelStart[channel] / 8;
+            if (img->pixelPacking == DmtxPack16bppKBE) {
+                *value = (pixelPtr[0] << 8) | pixelPtr[1];
+            } else {
+                *value = pixelPtr[0] | (pixelPtr[1] << 8);
+            }
+            *value &= (1 << img->bitsPerChannel[channel]) - 1;
             break;
     }
 
@@ -337,7 +432,7 @@ extern DmtxPassFail dmtxImageGetPixelValue(DmtxImage *img, int x, int y, int cha
 extern DmtxPassFail dmtxImageSetPixelValue(DmtxImage *img, int x, int y, int channel, int value)
 {
     int offset;
-    /* unsigned char *pixelPtr; */
+    unsigned char *pixelPtr;
     /* int pixelValue; */
     /* int mask; */
     /* int bitShift; */
@@ -345,10 +440,10 @@ extern DmtxPassFail dmtxImageSetPixelValue(DmtxImage *img, int x, int y, int cha
     DmtxAssert(img != NULL);
     DmtxAssert(channel < img->channelCount);
 
-    offset = dmtxImageGetByteOffset(img, x, y);
-    if (offset == DmtxUndefined) {
+    if (dmtxImageContainsInt(img, 0, x, y) == DmtxFalse) {
         return DmtxFail;
     }
+    offset = getPixelOffset(img, x, y);
 
     switch (img->bitsPerChannel[channel]) {
         case 1:
@@ -368,7 +463,19 @@ extern DmtxPassFail dmtxImageSetPixelValue(DmtxImage *img, int x, int y, int cha
         case 8:
             DmtxAssert(img->channelStart[channel] % 8 == 0);
             DmtxAssert(img->bitsPerPixel % 8 == 0);
-            img->pxl[offset + channel] = value;
+            img->pxl[offset + img->channelStart[channel] / 8] = value;
+            break;
+        default:
+            DmtxAssert(img->bitsPerChannel[channel] <= 16);
+            pixelPtr = img->pxl + offset + img->channelStart[channel] / 8;
+            value &= (1 << img->bitsPerChannel[channel]) - 1;
+            if (img->pixelPacking == DmtxPack16bppKBE) {
+                pixelPtr[0] = (unsigned char)(value >> 8);
+                pixelPtr[1] = (unsigned char)(value & 0xff);
+            } else {
+                pixelPtr[0] = (unsigned char)(value & 0xff);
+                pixelPtr[1] = (unsigned char)(value >> 8);
+            }
             break;
     }
 
@@ -412,6 +519,51 @@ extern DmtxBoolean dmtxImageContainsFloat(DmtxImage *img, double x, double y)
     return DmtxFalse;
 }
 
+/**
+ * \brief 计算坐标 (x, y) 相对 pxl 的字节偏移量，不做边界检查
+ */
+static int getPixelOffset(DmtxImage *img, int x, int y)
+{
+    if (img->imageFlip & DmtxFlipY) {
+        return (y * img->rowSizeBytes + x * img->bytesPerPixel);
+    }
+
+    return ((img->height - y - 1) * img->rowSizeBytes + x * img->bytesPerPixel);
+}
+
+/**
+ * \brief 读取 Bayer 马赛克图像在 (x, y) 处的亮度
+ *
+ * 绿色采样点直接返回原始值；落在红色或蓝色采样点时，返回所在 2x2 单元中
+ * 两个绿色采样点的均值，只对实际访问的像素做这一廉价插值，无需整幅去马赛克。
+ */
+static int getBayerGreen(DmtxImage *img, int x, int y, int offset)
+{
+    int row;
+    int greenOnDiagonal;
+    unsigned char *cell;
+
+    row = (img->imageFlip & DmtxFlipY) ? y : img->height - y - 1;
+
+    /* RGGB/BGGR 的绿色位于 (x + row) 为奇数处，GRBG/GBRG 位于偶数处 */
+    greenOnDiagonal = (img->pixelPacking == DmtxPackBayerGRBG || img->pixelPacking == DmtxPackBayerGBRG);
+    if ((((x + row) & 0x01) == 0) == greenOnDiagonal) {
+        return img->pxl[offset];
+    }
+
+    /* 奇数尺寸图像的最后一行/列没有完整的 2x2 单元 */
+    if ((x | 0x01) >= img->width || (row | 0x01) >= img->height) {
+        return img->pxl[offset];
+    }
+
+    cell = img->pxl + offset - (row & 0x01) * img->rowSizeBytes - (x & 0x01);
+    if (greenOnDiagonal) {
+        return (cell[0] + cell[img->rowSizeBytes + 1]) >> 1;
+    }
+
+    return (cell[1] + cell[img->rowSizeBytes]) >> 1;
+}
+
 /**
  * \brief 根据给定的打包方式（pack）返回每个像素所占的位数
  */
@@ -421,6 +573,14 @@ static int getBitsPerPixel(int pack)
         case DmtxPack1bppK:
             return 1;
         case DmtxPack8bppK:
+        case DmtxPackBayerRGGB:
+        case DmtxPackBayerBGGR:
+        case DmtxPackBayerGRBG:
+        case DmtxPackBayerGBRG:
+        case DmtxPackNV12: /* 按亮度平面寻址 */
+        case DmtxPackNV21:
+        case DmtxPackI420:
+        case DmtxPackYV12:
             return 8;
         case DmtxPack16bppRGB:
         case DmtxPack16bppRGBX:
@@ -429,6 +589,10 @@ static int getBitsPerPixel(int pack)
         case DmtxPack16bppBGRX:
         case DmtxPack16bppXBGR:
         case DmtxPack16bppYCbCr:
+        case DmtxPackYUYV:
+        case DmtxPackUYVY:
+        case DmtxPack16bppK:
+        case DmtxPack16bppKBE:
             return 16;
         case DmtxPack24bppRGB:
         case DmtxPack24bppBGR:
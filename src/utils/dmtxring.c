@@ -0,0 +1,115 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxring.c
+ * \brief Bounded lock-free multi-producer multi-consumer queue
+ *
+ * 每格带一个序号：入队者等待序号等于自己的位置，出队者等待序号等于位置 + 1。
+ * 入队位置和出队位置各用 CAS 推进，放入和取出数据本身不需要加锁。
+ * 队列满或空时立即返回 DmtxFail，需要等待时由调用者配合信号量阻塞。
+ */
+
+#include <stdlib.h>
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+/**
+ * \brief 初始化队列
+ * \param capacity 容量，向上取整为 2 的幂
+ * \return DmtxPass | DmtxFail（内存不足）
+ */
+static DmtxPassFail ringInit(DmtxRing *ring, long capacity)
+{
+    long i, size;
+
+    size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    ring->cell = (DmtxRingCell *)malloc(sizeof(DmtxRingCell) * size);
+    if (ring->cell == NULL) {
+        return DmtxFail;
+    }
+
+    for (i = 0; i < size; i++) {
+        ring->cell[i].seq = i;
+        ring->cell[i].data = NULL;
+    }
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 释放队列，队列中剩余的数据由调用者负责
+ */
+static void ringFree(DmtxRing *ring)
+{
+    free(ring->cell);
+    ring->cell = NULL;
+}
+
+/**
+ * \brief 入队
+ * \return DmtxPass | DmtxFail（队列已满）
+ */
+static DmtxPassFail ringPush(DmtxRing *ring, void *data)
+{
+    long pos, diff;
+    DmtxRingCell *cell;
+
+    pos = DmtxAtomicLoad(&ring->tail);
+    for (;;) {
+        cell = &ring->cell[pos & ring->mask];
+        diff = DmtxAtomicLoad(&cell->seq) - pos;
+        if (diff == 0) {
+            if (DmtxAtomicCasLong(&ring->tail, pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return DmtxFail;
+        }
+        pos = DmtxAtomicLoad(&ring->tail);
+    }
+
+    cell->data = data;
+    DmtxAtomicStore(&cell->seq, pos + 1);
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 出队
+ * \return DmtxPass | DmtxFail（队列为空）
+ */
+static DmtxPassFail ringPop(DmtxRing *ring, OUT void **data)
+{
+    long pos, diff;
+    DmtxRingCell *cell;
+
+    pos = DmtxAtomicLoad(&ring->head);
+    for (;;) {
+        cell = &ring->cell[pos & ring->mask];
+        diff = DmtxAtomicLoad(&cell->seq) - (pos + 1);
+        if (diff == 0) {
+            if (DmtxAtomicCasLong(&ring->head, pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return DmtxFail;
+        }
+        pos = DmtxAtomicLoad(&ring->head);
+    }
+
+    *data = cell->data;
+    DmtxAtomicStore(&cell->seq, pos + ring->mask + 1);
+
+    return DmtxPass;
+}
@@ -0,0 +1,253 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file dmtxthread.c
+ * \brief Minimal worker thread wrapper
+ *
+ * 只提供创建、等待结束两个线程操作，以及供线程阻塞等待的计数信号量。POSIX 下使用 pthread
+ * （信号量由互斥量和条件变量实现，macOS 不支持未命名的 sem_t），Windows 下使用 _beginthreadex 和 CreateSemaphore。
+ * 定义 DMTX_NO_THREADS 时不创建线程，调用者应在 threadStart() 失败时直接在当前线程执行；
+ * 此时信号量只是一个计数，等待不会阻塞。
+ */
+
+#include "dmtx.h"
+#include "dmtxstatic.h"
+
+#if defined(DMTX_NO_THREADS)
+
+static DmtxPassFail threadStart(DmtxThread *thread, DmtxThreadFunc func, void *arg)
+{
+    (void)thread;
+    (void)func;
+    (void)arg;
+
+    return DmtxFail;
+}
+
+static void threadJoin(DmtxThread *thread)
+{
+    (void)thread;
+}
+
+static DmtxPassFail semaphoreInit(DmtxSemaphore *sem)
+{
+    sem->count = 0;
+
+    return DmtxPass;
+}
+
+static void semaphoreFree(DmtxSemaphore *sem)
+{
+    (void)sem;
+}
+
+static void semaphorePost(DmtxSemaphore *sem, int count)
+{
+    sem->count += count;
+}
+
+static void semaphoreWait(DmtxSemaphore *sem)
+{
+    sem->count--;
+}
+
+static DmtxBoolean semaphoreTryWait(DmtxSemaphore *sem)
+{
+    if (sem->count <= 0) {
+        return DmtxFalse;
+    }
+    sem->count--;
+
+    return DmtxTrue;
+}
+
+#elif defined(_WIN32)
+
+#    include <process.h>
+#    include <windows.h>
+
+static unsigned __stdcall threadMain(void *arg)
+{
+    DmtxThread *thread = (DmtxThread *)arg;
+
+    (*thread->func)(thread->arg);
+
+    return 0;
+}
+
+/**
+ * \brief 创建线程执行 func(arg)
+ * \param thread 线程，在 threadJoin() 之前必须保持有效
+ * \return DmtxPass | DmtxFail（无法创建线程）
+ */
+static DmtxPassFail threadStart(DmtxThread *thread, DmtxThreadFunc func, void *arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = (void *)_beginthreadex(NULL, 0, threadMain, thread, 0, NULL);
+
+    return (thread->handle != NULL) ? DmtxPass : DmtxFail;
+}
+
+/**
+ * \brief 等待线程结束并释放线程资源
+ */
+static void threadJoin(DmtxThread *thread)
+{
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+}
+
+/**
+ * \brief 初始化计数为 0 的信号量
+ * \return DmtxPass | DmtxFail（无法创建）
+ */
+static DmtxPassFail semaphoreInit(DmtxSemaphore *sem)
+{
+    sem->handle = (void *)CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+
+    return (sem->handle != NULL) ? DmtxPass : DmtxFail;
+}
+
+/**
+ * \brief 释放信号量，此时不能有线程在等待
+ */
+static void semaphoreFree(DmtxSemaphore *sem)
+{
+    CloseHandle((HANDLE)sem->handle);
+}
+
+/**
+ * \brief 计数增加 count，唤醒至多 count 个等待的线程
+ */
+static void semaphorePost(DmtxSemaphore *sem, int count)
+{
+    ReleaseSemaphore((HANDLE)sem->handle, count, NULL);
+}
+
+/**
+ * \brief 阻塞到计数大于 0，然后减 1
+ */
+static void semaphoreWait(DmtxSemaphore *sem)
+{
+    WaitForSingleObject((HANDLE)sem->handle, INFINITE);
+}
+
+/**
+ * \brief 计数大于 0 时减 1，不阻塞
+ * \return DmtxTrue: 已减 1 | DmtxFalse: 计数为 0
+ */
+static DmtxBoolean semaphoreTryWait(DmtxSemaphore *sem)
+{
+    return (WaitForSingleObject((HANDLE)sem->handle, 0) == WAIT_OBJECT_0) ? DmtxTrue : DmtxFalse;
+}
+
+#else
+
+static void *threadMain(void *arg)
+{
+    DmtxThread *thread = (DmtxThread *)arg;
+
+    (*thread->func)(thread->arg);
+
+    return NULL;
+}
+
+/**
+ * \brief 创建线程执行 func(arg)
+ * \param thread 线程，在 threadJoin() 之前必须保持有效
+ * \return DmtxPass | DmtxFail（无法创建线程）
+ */
+static DmtxPassFail threadStart(DmtxThread *thread, DmtxThreadFunc func, void *arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+
+    return (pthread_create(&thread->handle, NULL, threadMain, thread) == 0) ? DmtxPass : DmtxFail;
+}
+
+/**
+ * \brief 等待线程结束并释放线程资源
+ */
+static void threadJoin(DmtxThread *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+/**
+ * \brief 初始化计数为 0 的信号量
+ * \return DmtxPass | DmtxFail（无法创建）
+ */
+static DmtxPassFail semaphoreInit(DmtxSemaphore *sem)
+{
+    sem->count = 0;
+    if (pthread_mutex_init(&sem->mutex, NULL) != 0) {
+        return DmtxFail;
+    }
+    if (pthread_cond_init(&sem->cond, NULL) != 0) {
+        pthread_mutex_destroy(&sem->mutex);
+        return DmtxFail;
+    }
+
+    return DmtxPass;
+}
+
+/**
+ * \brief 释放信号量，此时不能有线程在等待
+ */
+static void semaphoreFree(DmtxSemaphore *sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->mutex);
+}
+
+/**
+ * \brief 计数增加 count，唤醒至多 count 个等待的线程
+ */
+static void semaphorePost(DmtxSemaphore *sem, int count)
+{
+    pthread_mutex_lock(&sem->mutex);
+    sem->count += count;
+    if (count == 1) {
+        pthread_cond_signal(&sem->cond);
+    } else {
+        pthread_cond_broadcast(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+/**
+ * \brief 阻塞到计数大于 0，然后减 1
+ */
+static void semaphoreWait(DmtxSemaphore *sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count <= 0) {
+        pthread_cond_wait(&sem->cond, &sem->mutex);
+    }
+    sem->count--;
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+/**
+ * \brief 计数大于 0 时减 1，不阻塞
+ * \return DmtxTrue: 已减 1 | DmtxFalse: 计数为 0
+ */
+static DmtxBoolean semaphoreTryWait(DmtxSemaphore *sem)
+{
+    DmtxBoolean taken;
+
+    pthread_mutex_lock(&sem->mutex);
+    taken = (sem->count > 0) ? DmtxTrue : DmtxFalse;
+    if (taken == DmtxTrue) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->mutex);
+
+    return taken;
+}
+
+#endif
@@ -20,56 +20,79 @@
 
 #define DMTX_USEC_PER_SEC 1000000
 
-#if defined(HAVE_SYS_TIME_H) && defined(HAVE_GETTIMEOFDAY)
+/*
+ * dmtxTimeNow() 只用于计算超时，优先使用单调时钟，避免系统时间被调整时
+ * 超时提前或永不到期。返回值不是日历时间。
+ */
+#if defined(_WIN32)
+
+#    include <windows.h>
+#    define DMTX_TIME_PREC_USEC 1
+
+/**
+ * \brief QueryPerformanceCounter version
+ * \return Time now
+ */
+extern DmtxTime dmtxTimeNow(void)
+{
+    LARGE_INTEGER freq, count;
+    DmtxTime tNow;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+
+    tNow.sec = (time_t)(count.QuadPart / freq.QuadPart);
+    tNow.usec = (unsigned long)((count.QuadPart % freq.QuadPart) * DMTX_USEC_PER_SEC / freq.QuadPart);
+
+    return tNow;
+}
+
+#elif defined(CLOCK_MONOTONIC)
 
-#    include <sys/time.h>
 #    include <time.h>
 #    define DMTX_TIME_PREC_USEC 1
 
 /**
- * \brief GETTIMEOFDAY version
+ * \brief CLOCK_MONOTONIC version (nanosecond source)
  * \return Time now
  */
 extern DmtxTime dmtxTimeNow(void)
 {
-    DmtxPassFail err;
-    struct timeval tv;
+    struct timespec ts;
     DmtxTime tNow;
 
-    err = gettimeofday(&tv, NULL);
-    if (err != 0)
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
         ; /* XXX handle error better here */
+    }
 
-    tNow.sec = tv.tv_sec;
-    tNow.usec = tv.tv_usec;
+    tNow.sec = ts.tv_sec;
+    tNow.usec = (unsigned long)(ts.tv_nsec / 1000);
 
     return tNow;
 }
 
-#elif defined(_MSC_VER)
+#elif defined(HAVE_SYS_TIME_H) && defined(HAVE_GETTIMEOFDAY)
 
-#    include <Windows.h>
+#    include <sys/time.h>
+#    include <time.h>
 #    define DMTX_TIME_PREC_USEC 1
 
 /**
- * \brief MICROSOFT VC++ version
+ * \brief GETTIMEOFDAY version
  * \return Time now
  */
 extern DmtxTime dmtxTimeNow(void)
 {
-    FILETIME ft;
-    unsigned __int64 tm;
+    DmtxPassFail err;
+    struct timeval tv;
     DmtxTime tNow;
 
-    GetSystemTimeAsFileTime(&ft);
-
-    tm = ft.dwHighDateTime;
-    tm <<= 32;
-    tm |= ft.dwLowDateTime;
-    tm /= 10;
+    err = gettimeofday(&tv, NULL);
+    if (err != 0)
+        ; /* XXX handle error better here */
 
-    tNow.sec = tm / 1000000UL;
-    tNow.usec = tm % 1000000UL;
+    tNow.sec = tv.tv_sec;
+    tNow.usec = tv.tv_usec;
 
     return tNow;
 }
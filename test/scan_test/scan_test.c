@@ -0,0 +1,104 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file scan_test.c
+ * \brief Benchmark scan orders on large frames
+ *
+ * Usage: scan_test [width height]
+ *
+ * Synthesizes a large 8 bpp frame with sensor noise and a single symbol near
+ * the last-scanned corner, then reports the time to the first region and the
+ * time to exhaust an empty frame for each DmtxScanOrder.
+ */
+
+#include <dmtx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double findFirst(unsigned char *pxl, int width, int height, int scanOrder, int *found)
+{
+    clock_t t0;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+
+    t0 = clock();
+
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    dec = dmtxDecodeCreate(img, 1);
+    dmtxDecodeSetProp(dec, DmtxPropScanOrder, scanOrder);
+
+    reg = dmtxRegionFindNext(dec, NULL);
+    *found = (reg != NULL);
+
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+    dmtxImageDestroy(&img);
+
+    return (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, x, y, found;
+    double secs;
+    int width, height, symWidth, symHeight;
+    unsigned char str[] = "30Q324343430794<OQQ";
+    unsigned char *pxl, *sym;
+    const char *names[] = {"raster", "saliency", "tiled"};
+    DmtxEncode *enc;
+
+    width = (argc > 2) ? atoi(argv[1]) : 6000;
+    height = (argc > 2) ? atoi(argv[2]) : 4000;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 6);
+    dmtxEncodeDataMatrix(enc, (int)strlen((const char *)str), str);
+    symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    sym = enc->image->pxl;
+
+    pxl = (unsigned char *)malloc((size_t)width * height);
+    if (pxl == NULL || symWidth >= width || symHeight >= height) {
+        dmtxEncodeDestroy(&enc);
+        free(pxl);
+        return 1;
+    }
+
+    srand(1);
+    for (i = 0; i < width * height; i++) {
+        pxl[i] = (unsigned char)(120 + rand() % 9);
+    }
+
+    printf("%dx%d empty frame\n", width, height);
+    for (i = DmtxScanOrderRaster; i <= DmtxScanOrderTiled; i++) {
+        secs = findFirst(pxl, width, height, i, &found);
+        printf("  %-8s %8.3f s\n", names[i], secs);
+        fflush(stdout);
+    }
+
+    /* Symbol near the top-right corner of the buffer */
+    for (y = 0; y < symHeight; y++) {
+        for (x = 0; x < symWidth; x++) {
+            pxl[(size_t)(y + 100) * width + width - symWidth - 100 + x] = sym[y * symWidth + x];
+        }
+    }
+
+    printf("%dx%d frame, first region\n", width, height);
+    for (i = DmtxScanOrderRaster; i <= DmtxScanOrderTiled; i++) {
+        secs = findFirst(pxl, width, height, i, &found);
+        printf("  %-8s %8.3f s%s\n", names[i], secs, found ? "" : " (not found)");
+        fflush(stdout);
+    }
+
+    dmtxEncodeDestroy(&enc);
+    free(pxl);
+
+    return 0;
+}
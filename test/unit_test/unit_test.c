@@ -14,7 +14,13 @@
 #    include <unistd.h>
 #endif
 
+#if !defined(_WIN32) && !defined(DMTX_NO_THREADS)
+#    include <pthread.h>
+#    include <time.h>
+#endif
+
 #include <dmtx.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,11 +35,71 @@ static void FatalError(int idx, char *msg)
 
 static void timeAddTest(void);
 static void timePrint(DmtxTime t);
+static void imageYuvTest(void);
+static void imageBayerTest(void);
+static int bayerExpected(const unsigned char *first, int stride, int width, int height, const char *pattern, int x,
+                         int row);
+static void image16bppTest(void);
+static void imageViewTest(void);
+static void lumaPlaneTest(void);
+static void binarizeTest(void);
+static void edgeThreshTest(void);
+static void presenceTest(void);
+static void scanOrderTest(void);
+static void deadlineTest(void);
+static void decodeStepTest(void);
+static void decodeAllTest(void);
+static void moduleRetryTest(void);
+static void erasureTest(void);
+static void reedSolomonTest(void);
+static void symbolInfoTest(void);
+static void outputBufferTest(void);
+static void mosaicTest(void);
+static void resultCacheTest(void);
+static void verifyTest(void);
+static void variantsTest(void);
+static void pipelineTest(void);
+static void pipelineCancelTest(void);
+static void outputSinkCount(void *userData, const unsigned char *data, size_t length);
+static void placementReference(int *map, int rows, int cols);
+#if !defined(_WIN32) && !defined(DMTX_NO_THREADS)
+typedef struct
+{
+    DmtxDecode *dec;
+    long usec;
+    DmtxTime cancelled;
+} CancelAfter;
+static long usecBetween(DmtxTime start, DmtxTime end);
+static void *cancelAfter(void *arg);
+#endif
 
 int main(int argc, char *argv[])
 {
     programName = argv[0];
 
+    imageYuvTest();
+    imageBayerTest();
+    image16bppTest();
+    imageViewTest();
+    lumaPlaneTest();
+    binarizeTest();
+    edgeThreshTest();
+    presenceTest();
+    scanOrderTest();
+    deadlineTest();
+    decodeStepTest();
+    decodeAllTest();
+    moduleRetryTest();
+    erasureTest();
+    reedSolomonTest();
+    symbolInfoTest();
+    outputBufferTest();
+    mosaicTest();
+    resultCacheTest();
+    verifyTest();
+    variantsTest();
+    pipelineTest();
+    pipelineCancelTest();
     timeAddTest();
 
     exit(0);
@@ -97,6 +163,1589 @@ static void timeAddTest(void)
     }
 }
 
+/**
+ * Luma of YUV frames must be read in place, honoring stride and pixel layout
+ */
+static void imageYuvTest(void)
+{
+    int value;
+    unsigned char nv12[8 * 2 + 8];  /* 4x2 Y plane with stride 8, then UV */
+    unsigned char uyvy[4 * 2 * 2];  /* 4x2, 2 bytes per pixel */
+    DmtxImage *img;
+
+    memset(nv12, 0x80, sizeof(nv12));
+    nv12[0 * 8 + 3] = 10; /* top-right */
+    nv12[1 * 8 + 0] = 20; /* bottom-left */
+
+    img = dmtxImageCreate(nv12, 4, 2, DmtxPackNV12);
+    if (img == NULL || dmtxImageSetProp(img, DmtxPropRowSizeBytes, 8) != DmtxPass) {
+        FatalError(1, "imageYuvTest\n");
+    }
+    dmtxImageGetPixelValue(img, 3, 1, 0, &value);
+    if (value != 10) {
+        FatalError(2, "imageYuvTest\n");
+    }
+    dmtxImageGetPixelValue(img, 0, 0, 0, &value);
+    if (value != 20 || dmtxImageGetProp(img, DmtxPropChannelCount) != 1) {
+        FatalError(3, "imageYuvTest\n");
+    }
+    dmtxImageDestroy(&img);
+
+    memset(uyvy, 0x80, sizeof(uyvy));
+    uyvy[4 * 2 + 2 * 2 + 1] = 30; /* Y of pixel (2,0) */
+
+    img = dmtxImageCreate(uyvy, 4, 2, DmtxPackUYVY);
+    dmtxImageGetPixelValue(img, 2, 0, 0, &value);
+    if (value != 30 || dmtxImageGetProp(img, DmtxPropBytesPerPixel) != 2) {
+        FatalError(4, "imageYuvTest\n");
+    }
+    dmtxImageDestroy(&img);
+}
+
+/**
+ * Bayer green is read directly on green sites and averaged from the 2x2 cell elsewhere,
+ * for every pattern, both row orders, negative strides and odd sizes
+ */
+static void imageBayerTest(void)
+{
+    int i, size, pack, flip, view, x, y, row, stride, value;
+    int width = 4, height = 4;
+    char *pattern[] = {"RGGB", "BGGR", "GRBG", "GBRG"};
+    unsigned char buf[5 * 4];
+    unsigned char *first;
+    DmtxImage *img;
+
+    for (i = 0; i < (int)sizeof(buf); i++) {
+        buf[i] = (unsigned char)(10 + 13 * i);
+    }
+
+    /* RGGB: the red top-left site averages the greens to its right and below */
+    img = dmtxImageCreate(buf, width, height, DmtxPackBayerRGGB);
+    dmtxImageGetPixelValue(img, 0, height - 1, 0, &value);
+    if (img == NULL || value != (buf[1] + buf[width]) / 2) {
+        FatalError(1, "imageBayerTest\n");
+    }
+    dmtxImageDestroy(&img);
+
+    /* Even 4x4, then odd 5x3 where the last column and row have no complete cell */
+    for (size = 0; size < 2; size++) {
+        width = (size) ? 5 : 4;
+        height = (size) ? 3 : 4;
+        for (pack = 0; pack < 4; pack++) {
+            for (flip = 0; flip < 2; flip++) {
+                for (view = 0; view < 2; view++) {
+                    /* The view walks the same buffer bottom-up, so its first row is the last one in memory */
+                    first = (view) ? buf + (height - 1) * width : buf;
+                    stride = (view) ? -width : width;
+                    img = dmtxImageCreateView(first, width, height, stride, DmtxPackBayerRGGB + pack);
+                    if (img == NULL) {
+                        FatalError(2, "imageBayerTest\n");
+                    }
+                    if (flip) {
+                        dmtxImageSetProp(img, DmtxPropImageFlip, DmtxFlipY);
+                    }
+
+                    for (y = 0; y < height; y++) {
+                        row = (flip) ? y : height - y - 1;
+                        for (x = 0; x < width; x++) {
+                            if (dmtxImageGetPixelValue(img, x, y, 0, &value) != DmtxPass ||
+                                value != bayerExpected(first, stride, width, height, pattern[pack], x, row)) {
+                                FatalError(3, "imageBayerTest\n");
+                            }
+                        }
+                    }
+                    dmtxImageDestroy(&img);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * 按 Bayer 排列逐格求绿色值的参考实现，row 为内存中的行号（0 为第一行）
+ */
+static int bayerExpected(const unsigned char *first, int stride, int width, int height, const char *pattern, int x,
+                         int row)
+{
+    int r, c, sum, count;
+    int cellRow = row - row % 2;
+    int cellCol = x - x % 2;
+
+    if (pattern[(row % 2) * 2 + x % 2] == 'G' || cellRow + 1 >= height || cellCol + 1 >= width) {
+        return first[row * stride + x];
+    }
+
+    sum = count = 0;
+    for (r = 0; r < 2; r++) {
+        for (c = 0; c < 2; c++) {
+            if (pattern[r * 2 + c] == 'G') {
+                sum += first[(cellRow + r) * stride + cellCol + c];
+                count++;
+            }
+        }
+    }
+
+    return sum / count;
+}
+
+/**
+ * 16 bpp grayscale samples honor byte order and significant bits
+ */
+static void image16bppTest(void)
+{
+    int value;
+    unsigned char pxl[2] = {0x12, 0xf4};
+    DmtxImage *img;
+
+    img = dmtxImageCreate(pxl, 1, 1, DmtxPack16bppK);
+    dmtxImageGetPixelValue(img, 0, 0, 0, &value);
+    if (value != 0xf412) {
+        FatalError(1, "image16bppTest\n");
+    }
+    if (dmtxImageSetProp(img, DmtxPropSignificantBits, 12) != DmtxPass) {
+        FatalError(2, "image16bppTest\n");
+    }
+    dmtxImageGetPixelValue(img, 0, 0, 0, &value);
+    if (value != 0x412) {
+        FatalError(3, "image16bppTest\n");
+    }
+    dmtxImageDestroy(&img);
+
+    img = dmtxImageCreate(pxl, 1, 1, DmtxPack16bppKBE);
+    dmtxImageGetPixelValue(img, 0, 0, 0, &value);
+    if (value != 0x12f4) {
+        FatalError(4, "image16bppTest\n");
+    }
+    dmtxImageDestroy(&img);
+}
+
+/**
+ * Views address a sub-rectangle of a larger buffer, including negative strides
+ */
+static void imageViewTest(void)
+{
+    int value;
+    unsigned char frame[4 * 4];
+    DmtxImage *img;
+
+    for (value = 0; value < 16; value++) {
+        frame[value] = (unsigned char)value;
+    }
+
+    /* 2x2 view at column 1, row 1 of a 4x4 frame */
+    img = dmtxImageCreateView(frame + 5, 2, 2, 4, DmtxPack8bppK);
+    dmtxImageGetPixelValue(img, 0, 1, 0, &value); /* top-left */
+    if (value != 5) {
+        FatalError(1, "imageViewTest\n");
+    }
+    if (dmtxImageGetPixelValue(img, 2, 0, 0, &value) != DmtxFail) {
+        FatalError(2, "imageViewTest\n");
+    }
+    dmtxImageDestroy(&img);
+
+    /* Same view of a frame stored bottom-up */
+    img = dmtxImageCreateView(frame + 9, 2, 2, -4, DmtxPack8bppK);
+    dmtxImageGetPixelValue(img, 1, 0, 0, &value); /* bottom-right */
+    if (value != 6) {
+        FatalError(3, "imageViewTest\n");
+    }
+    dmtxImageDestroy(&img);
+}
+
+/**
+ * The luma plane matches BT.601 luma of every sampled pixel and decodes like the per-channel path
+ */
+static void lumaPlaneTest(void)
+{
+    int i, x, y, scale, width, height, rgb[3], expected, bytes;
+    char *str = "30Q324343430794<OQQ";
+    unsigned char *src, *pxlRgb, *pxlBgr, *pxlGray, *pxlTint;
+    DmtxEncode *enc;
+    DmtxImage *img, *imgBgr, *imgGray, *imgTint;
+    DmtxDecode *dec, *decOther;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack24bppRGB);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    src = enc->image->pxl;
+    bytes = width * height;
+
+    /* Tinted copy: dark modules blue-ish, light ones warm, with a small ramp so channels differ per pixel */
+    pxlRgb = (unsigned char *)malloc(bytes * 3);
+    pxlBgr = (unsigned char *)malloc(bytes * 3);
+    pxlGray = (unsigned char *)malloc(bytes);
+    pxlTint = (unsigned char *)malloc(bytes * 3);
+    for (i = 0; i < bytes; i++) {
+        x = i % width;
+        pxlRgb[i * 3 + 0] = (unsigned char)((src[i * 3] < 128) ? 40 + x % 9 : 250 - x % 11);
+        pxlRgb[i * 3 + 1] = (unsigned char)((src[i * 3] < 128) ? 20 + x % 5 : 215 + x % 13);
+        pxlRgb[i * 3 + 2] = (unsigned char)((src[i * 3] < 128) ? 90 - x % 7 : 180 + x % 3);
+        pxlBgr[i * 3 + 0] = pxlRgb[i * 3 + 2];
+        pxlBgr[i * 3 + 1] = pxlRgb[i * 3 + 1];
+        pxlBgr[i * 3 + 2] = pxlRgb[i * 3 + 0];
+        pxlGray[i] = pxlRgb[i * 3 + 1];
+        memset(pxlTint + i * 3, pxlGray[i], 3);
+    }
+    img = dmtxImageCreate(pxlRgb, width, height, DmtxPack24bppRGB);
+    imgBgr = dmtxImageCreate(pxlBgr, width, height, DmtxPack24bppBGR);
+    imgGray = dmtxImageCreate(pxlGray, width, height, DmtxPack8bppK);
+    imgTint = dmtxImageCreate(pxlTint, width, height, DmtxPack24bppRGB);
+
+    for (scale = 1; scale <= 2; scale++) {
+        dec = dmtxDecodeCreate(img, scale);
+        if (dec->luma != NULL) {
+            FatalError(1, "lumaPlaneTest\n");
+        }
+
+        /* Reference luma from the per-channel pixel reads */
+        dmtxDecodeSetProp(dec, DmtxPropLumaPlane, 1);
+        if (dec->luma == NULL) {
+            FatalError(2, "lumaPlaneTest\n");
+        }
+        for (y = 0; y < height / scale; y++) {
+            for (x = 0; x < width / scale; x++) {
+                for (i = 0; i < 3; i++) {
+                    dmtxImageGetPixelValue(img, x * scale, y * scale, i, &rgb[i]);
+                }
+                expected = (int)(0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2] + 0.5);
+                if (abs(dec->luma[y * (width / scale) + x] - expected) > 1) {
+                    FatalError(3, "lumaPlaneTest\n");
+                }
+            }
+        }
+
+        /* BGR byte order yields the same plane */
+        decOther = dmtxDecodeCreate(imgBgr, scale);
+        dmtxDecodeSetProp(decOther, DmtxPropLumaPlane, 1);
+        if (memcmp(dec->luma, decOther->luma, (width / scale) * (height / scale)) != 0) {
+            FatalError(4, "lumaPlaneTest\n");
+        }
+        dmtxDecodeDestroy(&decOther);
+        dmtxDecodeDestroy(&dec);
+    }
+
+    /* Same symbol decoded with the plane off and on */
+    for (i = 0; i < 2; i++) {
+        dec = dmtxDecodeCreate(img, 1);
+        dmtxDecodeSetProp(dec, DmtxPropLumaPlane, i);
+        reg = dmtxRegionFindNext(dec, NULL);
+        msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+        if (msg == NULL || strcmp((char *)msg->output, str) != 0) {
+            FatalError(5, "lumaPlaneTest\n");
+        }
+        dmtxMessageDestroy(&msg);
+        dmtxRegionDestroy(&reg);
+        dmtxDecodeDestroy(&dec);
+    }
+
+    /*
+     * 8 bpp frames are copied into the plane only when it is binarized; a gray RGB frame with the same
+     * values has an exact fixed-point luma, so both binarized planes must agree
+     */
+    dec = dmtxDecodeCreate(imgGray, 1);
+    decOther = dmtxDecodeCreate(imgTint, 1);
+    dmtxDecodeSetProp(dec, DmtxPropBinarize, DmtxBinarizeLocalMean);
+    dmtxDecodeSetProp(decOther, DmtxPropBinarize, DmtxBinarizeLocalMean);
+    if (dec->luma == NULL || decOther->luma == NULL || memcmp(dec->luma, decOther->luma, bytes) != 0) {
+        FatalError(6, "lumaPlaneTest\n");
+    }
+    dmtxDecodeDestroy(&decOther);
+    dmtxDecodeDestroy(&dec);
+
+    dmtxImageDestroy(&img);
+    dmtxImageDestroy(&imgBgr);
+    dmtxImageDestroy(&imgGray);
+    dmtxImageDestroy(&imgTint);
+    free(pxlRgb);
+    free(pxlBgr);
+    free(pxlGray);
+    free(pxlTint);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Local binarization recovers a symbol under strong shading, and bad window radii are rejected or clamped
+ */
+static void binarizeTest(void)
+{
+    int i, x, y, width, height, side, value, binarize;
+    char *str = "30Q324343430794<OQQ";
+    unsigned char *pxl, *plane;
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, 10);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+    /* Illumination falls to 10% from left to right over a coarse paper texture */
+    pxl = (unsigned char *)malloc(width * height);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            value = (enc->image->pxl[y * width + x] < 128) ? 40 : 255;
+            value = value * (10 * (width - 1) - 9 * x) / (10 * (width - 1)) + 20 * ((x * 7 + y * 13) % 5 - 2);
+            pxl[y * width + x] = (unsigned char)((value < 0) ? 0 : (value > 255) ? 255 : value);
+        }
+    }
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+
+    for (binarize = DmtxBinarizeNone; binarize <= DmtxBinarizeSauvola; binarize++) {
+        dec = dmtxDecodeCreate(img, 1);
+        dmtxDecodeSetProp(dec, DmtxPropBinarize, binarize);
+        reg = dmtxRegionFindNext(dec, NULL);
+        msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+        if (binarize == DmtxBinarizeNone && msg != NULL) {
+            FatalError(1, "binarizeTest\n");
+        }
+        if (binarize != DmtxBinarizeNone && (msg == NULL || strcmp((char *)msg->output, str) != 0)) {
+            FatalError(2, "binarizeTest\n");
+        }
+        dmtxMessageDestroy(&msg);
+        dmtxRegionDestroy(&reg);
+        dmtxDecodeDestroy(&dec);
+    }
+
+    /* Radius below 1 is rejected and leaves the previous value */
+    dec = dmtxDecodeCreate(img, 1);
+    dmtxDecodeSetProp(dec, DmtxPropBinarize, DmtxBinarizeSauvola);
+    if (dmtxDecodeSetProp(dec, DmtxPropBinarizeRadius, -5) != DmtxFail ||
+        dmtxDecodeSetProp(dec, DmtxPropBinarizeRadius, 0) != DmtxFail ||
+        dmtxDecodeGetProp(dec, DmtxPropBinarizeRadius) != DmtxUndefined) {
+        FatalError(3, "binarizeTest\n");
+    }
+
+    /* Any radius covering the whole plane gives the same result */
+    side = (width > height) ? width : height;
+    plane = (unsigned char *)malloc(width * height);
+    if (dmtxDecodeSetProp(dec, DmtxPropBinarizeRadius, 2 * side) != DmtxPass) {
+        FatalError(4, "binarizeTest\n");
+    }
+    memcpy(plane, dec->luma, width * height);
+    for (i = 0; i < 2; i++) {
+        if (dmtxDecodeSetProp(dec, DmtxPropBinarizeRadius, (i == 0) ? side : INT_MAX) != DmtxPass ||
+            memcmp(plane, dec->luma, width * height) != 0) {
+            FatalError(5, "binarizeTest\n");
+        }
+    }
+    dmtxDecodeDestroy(&dec);
+    free(plane);
+    dmtxImageDestroy(&img);
+    free(pxl);
+
+    /* A white frame over 2^32 / 255 pixels with one dark block: the window sum must not wrap */
+    width = 4200;
+    height = 4100;
+    pxl = (unsigned char *)malloc(width * height);
+    memset(pxl, 255, width * height);
+    for (y = height / 2 - 8; y < height / 2 + 8; y++) {
+        memset(pxl + y * width + width / 2 - 8, 0, 16);
+    }
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    dec = dmtxDecodeCreate(img, 1);
+    dmtxDecodeSetProp(dec, DmtxPropBinarizeRadius, INT_MAX);
+    dmtxDecodeSetProp(dec, DmtxPropBinarize, DmtxBinarizeLocalMean);
+    if (dec->luma == NULL || dec->luma[(height / 2) * width + width / 2] != 0 || dec->luma[0] != 255) {
+        FatalError(6, "binarizeTest\n");
+    }
+    dmtxDecodeDestroy(&dec);
+    dmtxImageDestroy(&img);
+    free(pxl);
+
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Automatic edge threshold sits between sensor noise and symbol edges, and holds across similar frames
+ */
+static void edgeThreshTest(void)
+{
+    int i, frame, width, height, thresh, threshHigh;
+    unsigned int seed;
+    char *str = "30Q324343430794<OQQ";
+    static const int level[3][2] = {{20, 235}, {21, 236}, {110, 150}};
+    unsigned char *pxl;
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec, *decSeq;
+    DmtxRegion *reg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, 10);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+    pxl = (unsigned char *)malloc(width * height);
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    decSeq = NULL;
+    threshHigh = 0;
+    seed = 1;
+
+    /* High contrast, a near-identical frame, then low contrast; all with uniform noise in [0, 8] */
+    for (frame = 0; frame < 3; frame++) {
+        for (i = 0; i < width * height; i++) {
+            seed = seed * 1103515245u + 12345u;
+            pxl[i] = (unsigned char)(level[frame][enc->image->pxl[i] < 128 ? 0 : 1] + ((seed >> 16) & 0x7fff) % 9);
+        }
+
+        /*
+         * A fresh decoder picks a threshold above the typical noise response (about 2 * 8) and below the
+         * symbol edge response (4 * contrast), in edgeThresh units of 7.65 per gradient step
+         */
+        dec = dmtxDecodeCreate(img, 1);
+        dmtxDecodeSetProp(dec, DmtxPropEdgeThreshAuto, 1);
+        thresh = dmtxDecodeGetProp(dec, DmtxPropEdgeThresh);
+        if (thresh * 7.65 <= 2 * 8 || thresh * 7.65 >= 4 * (level[frame][1] - level[frame][0])) {
+            FatalError(1, "edgeThreshTest\n");
+        }
+        reg = dmtxRegionFindNext(dec, NULL);
+        if (reg == NULL) {
+            FatalError(2, "edgeThreshTest\n");
+        }
+        dmtxRegionDestroy(&reg);
+        dmtxDecodeDestroy(&dec);
+
+        /* The same decoder reused across frames keeps its value until the scene really changes */
+        if (decSeq == NULL) {
+            decSeq = dmtxDecodeCreate(img, 1);
+            dmtxDecodeSetProp(decSeq, DmtxPropEdgeThreshAuto, 1);
+        } else {
+            dmtxDecodeSetImage(decSeq, img);
+        }
+        thresh = dmtxDecodeGetProp(decSeq, DmtxPropEdgeThresh);
+        if (frame == 0) {
+            threshHigh = thresh;
+        } else if ((frame == 1) != (thresh == threshHigh)) {
+            FatalError(3, "edgeThreshTest\n");
+        }
+    }
+    dmtxDecodeDestroy(&decSeq);
+
+    dmtxImageDestroy(&img);
+    free(pxl);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Presence survey ends flat and noise frames before the first scan location, but still accepts a symbol
+ */
+static void presenceTest(void)
+{
+    int i, frame, level, width, height, status;
+    unsigned int seed;
+    char *str = "30Q324343430794<OQQ";
+    unsigned char *pxl;
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, 10);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+    pxl = (unsigned char *)malloc(width * height);
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    seed = 1;
+
+    /* Flat gray, then mild uniform noise in [120, 136] */
+    for (frame = 0; frame < 2; frame++) {
+        for (i = 0; i < width * height; i++) {
+            seed = seed * 1103515245u + 12345u;
+            pxl[i] = (unsigned char)((frame == 0) ? 128 : 120 + ((seed >> 16) & 0x7fff) % 17);
+        }
+
+        /* Without the survey one work unit scans one location; with it the frame ends immediately */
+        for (level = 0; level <= 50; level += 50) {
+            dec = dmtxDecodeCreate(img, 1);
+            dmtxDecodeSetProp(dec, DmtxPropPresenceLevel, level);
+            status = dmtxDecodeStep(dec, 1, &reg);
+            if (reg != NULL || status != ((level == 0) ? DmtxStepYield : DmtxStepDone)) {
+                FatalError(1, "presenceTest\n");
+            }
+            dmtxDecodeDestroy(&dec);
+        }
+    }
+
+    /* The verdict is per frame: the same decoder accepts the next frame carrying a symbol */
+    dec = dmtxDecodeCreate(img, 1);
+    dmtxDecodeSetProp(dec, DmtxPropPresenceLevel, 50);
+    if (dmtxRegionFindNext(dec, NULL) != NULL) {
+        FatalError(2, "presenceTest\n");
+    }
+    memcpy(pxl, enc->image->pxl, width * height);
+    dmtxDecodeSetImage(dec, img);
+    reg = dmtxRegionFindNext(dec, NULL);
+    msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+    if (msg == NULL || strcmp((char *)msg->output, str) != 0) {
+        FatalError(3, "presenceTest\n");
+    }
+    dmtxMessageDestroy(&msg);
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+
+    dmtxImageDestroy(&img);
+    free(pxl);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Cell scan orders visit every location of the ROI, and saliency order reaches an off-center symbol first
+ */
+static void scanOrderTest(void)
+{
+    int y, order, side, steps, status, stepsRaster;
+    int symbolWidth, symbolHeight;
+    char *str = "30Q324343430794<OQQ";
+    unsigned char *pxl;
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    /* Blank frames: every pop is one work unit; 128 also checks cells whose side is a power of two */
+    pxl = (unsigned char *)malloc(200 * 150);
+    for (side = 128; side <= 200; side += 72) {
+        memset(pxl, 255, side * 150);
+        img = dmtxImageCreate(pxl, side, (side == 128) ? 128 : 150, DmtxPack8bppK);
+        for (order = DmtxScanOrderSaliency; order <= DmtxScanOrderTiled; order++) {
+            dec = dmtxDecodeCreate(img, 1);
+            dmtxDecodeSetProp(dec, DmtxPropScanOrder, order);
+            steps = 0;
+            while ((status = dmtxDecodeStep(dec, 1, &reg)) == DmtxStepYield) {
+                steps++;
+            }
+            if (status != DmtxStepDone || steps != img->width * img->height ||
+                dmtxDecodeGetProp(dec, DmtxPropScanOrder) != order) {
+                FatalError(1, "scanOrderTest\n");
+            }
+            dmtxDecodeDestroy(&dec);
+        }
+        dmtxImageDestroy(&img);
+    }
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 3);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, 6);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    symbolWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    symbolHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+    /* Symbol near the lower right corner of a 200x150 frame, far from where the raster order starts */
+    memset(pxl, 255, 200 * 150);
+    for (y = 0; y < symbolHeight; y++) {
+        memcpy(pxl + (90 + y) * 200 + 130, enc->image->pxl + y * symbolWidth, symbolWidth);
+    }
+    img = dmtxImageCreate(pxl, 200, 150, DmtxPack8bppK);
+
+    stepsRaster = 0;
+    for (order = DmtxScanOrderRaster; order <= DmtxScanOrderSaliency; order++) {
+        dec = dmtxDecodeCreate(img, 1);
+        dmtxDecodeSetProp(dec, DmtxPropScanOrder, order);
+        steps = 0;
+        while ((status = dmtxDecodeStep(dec, 1, &reg)) == DmtxStepYield) {
+            steps++;
+        }
+        msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+        if (status != DmtxStepFound || msg == NULL || strcmp((char *)msg->output, str) != 0) {
+            FatalError(2, "scanOrderTest\n");
+        }
+        if (order == DmtxScanOrderRaster) {
+            stepsRaster = steps;
+        } else if (steps >= stepsRaster) {
+            FatalError(3, "scanOrderTest\n");
+        }
+        dmtxMessageDestroy(&msg);
+        dmtxRegionDestroy(&reg);
+        dmtxDecodeDestroy(&dec);
+    }
+
+    dmtxImageDestroy(&img);
+    free(pxl);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Cancellation and expired deadlines stop region search until the next frame
+ */
+static void deadlineTest(void)
+{
+    unsigned char str[] = "30Q324343430794<OQQ";
+    DmtxTime past, future;
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeDataMatrix(enc, (int)strlen((const char *)str), str);
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    dmtxDecodeCancel(dec);
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg != NULL || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxTrue) {
+        FatalError(1, "deadlineTest\n");
+    }
+
+    /* A new frame clears the cancellation, but not an expired deadline */
+    past = dmtxTimeAdd(dmtxTimeNow(), -1000);
+    dmtxDecodeSetImage(dec, enc->image);
+    dmtxDecodeSetDeadline(dec, &past);
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg != NULL || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxTrue) {
+        FatalError(2, "deadlineTest\n");
+    }
+
+    /* A per-call timeout that ran out is still reported after the decoder deadline is restored */
+    dmtxDecodeSetImage(dec, enc->image);
+    dmtxDecodeSetDeadline(dec, NULL);
+    reg = dmtxRegionFindNext(dec, &past);
+    if (reg != NULL || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxTrue) {
+        FatalError(3, "deadlineTest\n");
+    }
+
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg == NULL || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxFalse) {
+        FatalError(4, "deadlineTest\n");
+    }
+    dmtxRegionDestroy(&reg);
+
+    /* A scan that finished in time is not reported once the deadline passes later */
+    future = dmtxTimeAdd(dmtxTimeNow(), 200);
+    dmtxDecodeSetImage(dec, enc->image);
+    dmtxDecodeSetDeadline(dec, &future);
+    reg = dmtxRegionFindNext(dec, NULL);
+    while (!dmtxTimeExceeded(future)) {
+        /* Busy-wait until the deadline has passed */
+    }
+    if (reg == NULL || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxFalse) {
+        FatalError(5, "deadlineTest\n");
+    }
+
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Small work budgets yield and resume without losing or repeating work
+ */
+static void decodeStepTest(void)
+{
+    int status, calls, progress;
+    unsigned char str[] = "30Q324343430794<OQQ";
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeDataMatrix(enc, (int)strlen((const char *)str), str);
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    calls = progress = 0;
+    do {
+        status = dmtxDecodeStep(dec, 8, &reg);
+        if (dmtxDecodeGetProp(dec, DmtxPropScanProgress) < progress) {
+            FatalError(1, "decodeStepTest\n");
+        }
+        progress = dmtxDecodeGetProp(dec, DmtxPropScanProgress);
+        calls++;
+    } while (status == DmtxStepYield);
+
+    if (status != DmtxStepFound || reg == NULL || calls < 2) {
+        FatalError(2, "decodeStepTest\n");
+    }
+    msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+    if (msg == NULL || strcmp((const char *)msg->output, (const char *)str) != 0) {
+        FatalError(3, "decodeStepTest\n");
+    }
+    dmtxMessageDestroy(&msg);
+    dmtxRegionDestroy(&reg);
+
+    /* Scan the rest of the frame */
+    while (dmtxDecodeStep(dec, DmtxUndefined, &reg) == DmtxStepFound) {
+        dmtxRegionDestroy(&reg);
+    }
+    if (reg != NULL || dmtxDecodeGetProp(dec, DmtxPropScanProgress) != 1000) {
+        FatalError(4, "decodeStepTest\n");
+    }
+
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Every symbol of a frame is returned once, honoring max and expected counts
+ */
+static void decodeAllTest(void)
+{
+    int i, row, width, height, symWidth, symHeight;
+    char *str[] = {"first", "second", "third"};
+    unsigned char pxl[3 * 80 * 80];
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxDecodeAllOpts opts;
+    DmtxDecodeResults results;
+
+    /* Three symbols side by side on a white 240x80 frame */
+    width = 3 * 80;
+    height = 80;
+    memset(pxl, 0xff, sizeof(pxl));
+    for (i = 0; i < 3; i++) {
+        enc = dmtxEncodeCreate();
+        dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+        dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+        dmtxEncodeDataMatrix(enc, (int)strlen(str[i]), (unsigned char *)str[i]);
+        symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+        symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+        if (symWidth > 80 || symHeight > height) {
+            FatalError(1, "decodeAllTest\n");
+        }
+        for (row = 0; row < symHeight; row++) {
+            memcpy(pxl + row * width + i * 80, enc->image->pxl + row * symWidth, symWidth);
+        }
+        dmtxEncodeDestroy(&enc);
+    }
+
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    dec = dmtxDecodeCreate(img, 1);
+    if (dmtxDecodeAll(dec, NULL, &results) != DmtxPass || results.count != 3) {
+        FatalError(2, "decodeAllTest\n");
+    }
+    for (i = 0; i < results.count; i++) {
+        if (results.result[i].message == NULL || results.result[i].corners[2].x <= results.result[i].corners[0].x) {
+            FatalError(3, "decodeAllTest\n");
+        }
+    }
+    dmtxDecodeResultsFree(&results);
+
+    /* Stop after the first symbol */
+    opts.maxCount = 1;
+    opts.expectedCount = DmtxUndefined;
+    opts.fix = DmtxUndefined;
+    dmtxDecodeSetImage(dec, img);
+    if (dmtxDecodeAll(dec, &opts, &results) != DmtxPass || results.count != 1) {
+        FatalError(4, "decodeAllTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    /* One more symbol than the frame holds */
+    opts.maxCount = DmtxUndefined;
+    opts.expectedCount = 4;
+    dmtxDecodeSetImage(dec, img);
+    if (dmtxDecodeAll(dec, &opts, &results) != DmtxFail || results.count != 3) {
+        FatalError(5, "decodeAllTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    dmtxDecodeDestroy(&dec);
+    dmtxImageDestroy(&img);
+}
+
+/**
+ * Faded dark modules defeat the jump tally but are recovered by the retry ladder
+ */
+static void moduleRetryTest(void)
+{
+    int x, y, width, height, margin, moduleSize;
+    char *str = "30Q324343430794<OQQ";
+    unsigned char *pxl;
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    margin = moduleSize = 4;
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, moduleSize);
+    dmtxEncodeSetProp(enc, DmtxPropMarginSize, margin);
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    pxl = enc->image->pxl;
+
+    /* Fade dark data modules in the right half, leaving the finder and clock tracks intact */
+    for (y = margin + moduleSize; y < height - margin - moduleSize; y++) {
+        for (x = width / 2; x < width - margin - moduleSize; x++) {
+            if (pxl[y * width + x] == 0) {
+                pxl[y * width + x] = 170;
+            }
+        }
+    }
+
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    dec = dmtxDecodeCreate(img, 1);
+    if (dmtxDecodeGetProp(dec, DmtxPropModuleRetry) != DmtxTrue) {
+        FatalError(1, "moduleRetryTest\n");
+    }
+
+    dmtxDecodeSetProp(dec, DmtxPropModuleRetry, DmtxFalse);
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg == NULL) {
+        FatalError(2, "moduleRetryTest\n");
+    }
+    msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+    if (msg != NULL) {
+        FatalError(3, "moduleRetryTest\n");
+    }
+
+    dmtxDecodeSetProp(dec, DmtxPropModuleRetry, DmtxTrue);
+    msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+    if (msg == NULL || strcmp((char *)msg->output, str) != 0) {
+        FatalError(4, "moduleRetryTest\n");
+    }
+
+    dmtxMessageDestroy(&msg);
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+    dmtxImageDestroy(&img);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Corrupted modules flagged as unsure are decoded as erasures
+ */
+static void erasureTest(void)
+{
+    int i, flag, sizeIdx, mappingCols;
+    char *str = "30Q324343430794<OQQ";
+    DmtxEncode *enc;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+    sizeIdx = enc->region.sizeIdx;
+    mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+
+    /* Invert the top three rows of the mapping matrix: too many errors without the unsure flag */
+    for (flag = 0; flag < 2; flag++) {
+        msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+        for (i = 0; i < (int)msg->arraySize; i++) {
+            msg->array[i] = (enc->message->array[i] & DmtxModuleOnRGB) | DmtxModuleAssigned;
+            if (i < 3 * mappingCols) {
+                msg->array[i] ^= DmtxModuleOnRGB;
+                msg->array[i] |= (flag) ? DmtxModuleUnsure : 0;
+            }
+        }
+
+        msg = dmtxDecodePopulatedArray(sizeIdx, msg, DmtxUndefined);
+        if (flag == 0 && msg != NULL) {
+            FatalError(1, "erasureTest\n");
+        }
+        if (flag == 1 && (msg == NULL || strcmp((char *)msg->output, str) != 0)) {
+            FatalError(2, "erasureTest\n");
+        }
+        dmtxMessageDestroy(&msg);
+    }
+
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * ECC200 placement recomputed from the standard: map[row * cols + col] = codeword * 8 + bit (bit 0 is the MSB),
+ * -1 for the fixed corner modules
+ */
+static void placementReference(int *map, int rows, int cols)
+{
+    int i, r, c, rr, cc, cw, shape;
+    static const int utah[8][2] = {{-2, -2}, {-2, -1}, {-1, -2}, {-1, -1}, {-1, 0}, {0, -2}, {0, -1}, {0, 0}};
+    /* Corner shapes as {row base, row offset, col base, col offset}, base 1 meaning counted from rows/cols */
+    static const int corner[4][8][4] = {
+        {{1, -1, 0, 0}, {1, -1, 0, 1}, {1, -1, 0, 2}, {0, 0, 1, -2},
+         {0, 0, 1, -1}, {0, 1, 1, -1}, {0, 2, 1, -1}, {0, 3, 1, -1}},
+        {{1, -3, 0, 0}, {1, -2, 0, 0}, {1, -1, 0, 0}, {0, 0, 1, -4},
+         {0, 0, 1, -3}, {0, 0, 1, -2}, {0, 0, 1, -1}, {0, 1, 1, -1}},
+        {{1, -3, 0, 0}, {1, -2, 0, 0}, {1, -1, 0, 0}, {0, 0, 1, -2},
+         {0, 0, 1, -1}, {0, 1, 1, -1}, {0, 2, 1, -1}, {0, 3, 1, -1}},
+        {{1, -1, 0, 0}, {1, -1, 1, -1}, {0, 0, 1, -3}, {0, 0, 1, -2},
+         {0, 0, 1, -1}, {0, 1, 1, -3}, {0, 1, 1, -2}, {0, 1, 1, -1}}};
+
+    for (i = 0; i < rows * cols; i++) {
+        map[i] = -1;
+    }
+
+    cw = 0;
+    r = 4;
+    c = 0;
+    do {
+        shape = -1;
+        if (r == rows && c == 0) {
+            shape = 0;
+        } else if (r == rows - 2 && c == 0 && cols % 4 != 0) {
+            shape = 1;
+        } else if (r == rows - 2 && c == 0 && cols % 8 == 4) {
+            shape = 2;
+        } else if (r == rows + 4 && c == 2 && cols % 8 == 0) {
+            shape = 3;
+        }
+        if (shape >= 0) {
+            for (i = 0; i < 8; i++) {
+                map[(corner[shape][i][0] * rows + corner[shape][i][1]) * cols + corner[shape][i][2] * cols +
+                    corner[shape][i][3]] = cw * 8 + i;
+            }
+            cw++;
+        }
+
+        /* Sweep up-right, then down-left, placing a Utah shape at each free anchor */
+        for (shape = 0; shape < 2; shape++) {
+            do {
+                if (r >= 0 && r < rows && c >= 0 && c < cols && map[r * cols + c] == -1) {
+                    for (i = 0; i < 8; i++) {
+                        rr = r + utah[i][0];
+                        cc = c + utah[i][1];
+                        if (rr < 0) {
+                            rr += rows;
+                            cc += 4 - ((rows + 4) % 8);
+                        }
+                        if (cc < 0) {
+                            cc += cols;
+                            rr += 4 - ((cols + 4) % 8);
+                        }
+                        map[rr * cols + cc] = cw * 8 + i;
+                    }
+                    cw++;
+                }
+                r += (shape == 0) ? -2 : 2;
+                c += (shape == 0) ? 2 : -2;
+            } while ((shape == 0) ? (r >= 0 && c < cols) : (r < rows && c >= 0));
+            r += (shape == 0) ? 1 : 3;
+            c += (shape == 0) ? 3 : 1;
+        }
+    } while (r < rows || c < cols);
+}
+
+/**
+ * Error codewords of every symbol size match a generator polynomial rebuilt from GF(256) / 301, and a symbol
+ * with as many codeword errors in every block as it can correct is repaired exactly
+ */
+static void reedSolomonTest(void)
+{
+    int i, j, k, x, sizeIdx, blocks, blockErrorWords, dataWords, totalWords, rows, cols;
+    int block, count, pick, cw, feedback;
+    int gfExp[512], gfLog[256], gen[69], rem[68]; /* At most 68 error words per block */
+    int *map, *blockWords;
+    unsigned char *corrupt;
+    char *str = "123456";
+    DmtxEncode *enc;
+    DmtxMessage *msg;
+
+    for (x = 1, i = 0; i < 255; i++) {
+        gfExp[i] = gfExp[i + 255] = x;
+        gfLog[x] = i;
+        x = (x & 0x80) ? (x << 1) ^ 0x12d : x << 1;
+    }
+    gfExp[510] = gfExp[0];
+    gfExp[511] = gfExp[1];
+
+    for (sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+        blocks = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
+        blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
+        dataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
+        totalWords = dataWords + dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+        rows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx);
+        cols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+
+        enc = dmtxEncodeCreate();
+        dmtxEncodeSetProp(enc, DmtxPropSizeRequest, sizeIdx);
+        if (dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str) == DmtxFail ||
+            enc->region.sizeIdx != sizeIdx) {
+            FatalError(1, "reedSolomonTest\n");
+        }
+
+        /* g(x) = (x + a^1)(x + a^2)...(x + a^n), highest coefficient first */
+        gen[0] = 1;
+        for (i = 1; i <= blockErrorWords; i++) {
+            gen[i] = 0;
+            for (k = i; k > 0; k--) {
+                gen[k] ^= (gen[k - 1] == 0) ? 0 : gfExp[gfLog[gen[k - 1]] + i];
+            }
+        }
+
+        /* Remainder of each interleaved block's data, emitted highest degree first */
+        for (block = 0; block < blocks; block++) {
+            memset(rem, 0x00, sizeof(rem));
+            for (i = block; i < dataWords; i += blocks) {
+                feedback = enc->message->code[i] ^ rem[0];
+                for (k = 0; k < blockErrorWords; k++) {
+                    rem[k] = ((k + 1 < blockErrorWords) ? rem[k + 1] : 0) ^
+                             ((feedback == 0) ? 0 : gfExp[gfLog[feedback] + gfLog[gen[k + 1]]]);
+                }
+            }
+            for (k = 0, i = dataWords + block; i < totalWords; k++, i += blocks) {
+                if (enc->message->code[i] != rem[k]) {
+                    FatalError(2, "reedSolomonTest\n");
+                }
+            }
+        }
+
+        /* The encoder's module matrix follows the reference placement of its codewords */
+        map = (int *)malloc(rows * cols * sizeof(int));
+        placementReference(map, rows, cols);
+        for (i = 0; i < rows * cols; i++) {
+            if (map[i] != -1 && ((enc->message->array[i] & DmtxModuleOnRGB) != 0) !=
+                                    (((enc->message->code[map[i] / 8] << (map[i] % 8)) & 0x80) != 0)) {
+                FatalError(3, "reedSolomonTest\n");
+            }
+        }
+
+        /* Corrupt blockErrorWords / 2 codewords spread over every block, flipping 1..8 of their bits */
+        corrupt = (unsigned char *)calloc(totalWords, 1);
+        blockWords = (int *)malloc(totalWords * sizeof(int));
+        for (block = 0; block < blocks; block++) {
+            count = 0;
+            for (i = block; i < dataWords; i += blocks) {
+                blockWords[count++] = i;
+            }
+            for (i = dataWords + block; i < totalWords; i += blocks) {
+                blockWords[count++] = i;
+            }
+            for (j = 0; j < blockErrorWords / 2; j++) {
+                pick = blockWords[j * count / (blockErrorWords / 2)];
+                corrupt[pick] = (unsigned char)(j % 8 + 1);
+            }
+        }
+
+        msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+        for (i = 0; i < rows * cols; i++) {
+            msg->array[i] = (enc->message->array[i] & DmtxModuleOnRGB) | DmtxModuleAssigned;
+            cw = (map[i] == -1) ? -1 : map[i] / 8;
+            if (cw != -1 && map[i] % 8 < corrupt[cw]) {
+                msg->array[i] ^= DmtxModuleOnRGB;
+            }
+        }
+        msg = dmtxDecodePopulatedArray(sizeIdx, msg, DmtxUndefined);
+        if (msg == NULL || memcmp(msg->code, enc->message->code, totalWords) != 0 ||
+            strcmp((char *)msg->output, str) != 0) {
+            FatalError(4, "reedSolomonTest\n");
+        }
+
+        dmtxMessageDestroy(&msg);
+        free(blockWords);
+        free(corrupt);
+        free(map);
+        dmtxEncodeDestroy(&enc);
+    }
+}
+
+/**
+ * 尺寸描述表与 dmtxGetSymbolAttribute() 一致，派生字段自洽
+ */
+static void symbolInfoTest(void)
+{
+    int sizeIdx;
+    const DmtxSymbolInfo *info;
+
+    if (dmtxGetSymbolInfo(-1) != NULL || dmtxGetSymbolInfo(DmtxSymbolSquareCount + DmtxSymbolRectCount) != NULL) {
+        FatalError(1, "symbolInfoTest\n");
+    }
+
+    for (sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+        info = dmtxGetSymbolInfo(sizeIdx);
+        if (info == NULL || info->symbolRows != dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx) ||
+            info->symbolDataWords != dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx)) {
+            FatalError(2, "symbolInfoTest\n");
+        }
+
+        if (info->mappingRows != info->dataRegionRows * info->vertDataRegions ||
+            info->mappingCols != info->dataRegionCols * info->horizDataRegions ||
+            info->symbolRows != info->mappingRows + 2 * info->vertDataRegions ||
+            info->symbolCols != info->mappingCols + 2 * info->horizDataRegions) {
+            FatalError(3, "symbolInfoTest\n");
+        }
+
+        if (info->symbolErrorWords != info->blockErrorWords * info->interleavedBlocks ||
+            info->symbolMaxCorrectable != info->blockMaxCorrectable * info->interleavedBlocks ||
+            info->blockMaxCorrectable != info->blockErrorWords / 2) {
+            FatalError(4, "symbolInfoTest\n");
+        }
+    }
+}
+
+/**
+ * 解码结果依次写入调用者的缓冲区，空间不足时解码失败，回调只收到成功的结果
+ */
+static void outputBufferTest(void)
+{
+    int i, count, length;
+    char *str = "0123456789 base256";
+    unsigned char buf[40];
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    length = (int)strlen(str);
+    count = 0;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropScheme, DmtxSchemeBase256);
+    dmtxEncodeDataMatrix(enc, length, (unsigned char *)str);
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    dmtxDecodeSetOutputBuffer(dec, buf, sizeof(buf));
+    dmtxDecodeSetOutputSink(dec, outputSinkCount, &count);
+
+    /* Two decodes of the same frame fit back to back, the third does not */
+    for (i = 0; i < 3; i++) {
+        dmtxDecodeSetImage(dec, enc->image);
+        reg = dmtxRegionFindNext(dec, NULL);
+        if (reg == NULL) {
+            FatalError(1, "outputBufferTest\n");
+        }
+
+        msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+        if (i < 2 && (msg == NULL || msg->output != buf + i * length || msg->outputIdx != length ||
+                      memcmp(msg->output, str, length) != 0)) {
+            FatalError(2, "outputBufferTest\n");
+        }
+        if (i == 2 && msg != NULL) {
+            FatalError(3, "outputBufferTest\n");
+        }
+
+        dmtxMessageDestroy(&msg);
+        dmtxRegionDestroy(&reg);
+    }
+
+    if (count != 2 * length) {
+        FatalError(4, "outputBufferTest\n");
+    }
+
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Data Mosaic 的三个平面一次采样，输出依次接在一起
+ */
+static void mosaicTest(void)
+{
+    int length;
+    char *str = "Mosaic: red, green and blue planes 0123456789";
+    unsigned char buf[128];
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    length = (int)strlen(str);
+
+    enc = dmtxEncodeCreate();
+    if (dmtxEncodeDataMosaic(enc, length, (unsigned char *)str) != DmtxPass) {
+        FatalError(1, "mosaicTest\n");
+    }
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg == NULL) {
+        FatalError(2, "mosaicTest\n");
+    }
+
+    msg = dmtxDecodeMosaicRegion(dec, reg, DmtxUndefined);
+    if (msg == NULL || msg->outputIdx != length || memcmp(msg->output, str, length) != 0) {
+        FatalError(3, "mosaicTest\n");
+    }
+    dmtxMessageDestroy(&msg);
+
+    /* The combined output goes straight into the caller's buffer */
+    dmtxDecodeSetOutputBuffer(dec, buf, sizeof(buf));
+    msg = dmtxDecodeMosaicRegion(dec, reg, DmtxUndefined);
+    if (msg == NULL || msg->output != buf || msg->outputIdx != length || memcmp(buf, str, length) != 0) {
+        FatalError(4, "mosaicTest\n");
+    }
+    dmtxMessageDestroy(&msg);
+
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * 同一个符号再次解码时命中结果缓存，结果与完整解码相同
+ */
+static void resultCacheTest(void)
+{
+    int i;
+    char *str = "30Q324343430794<OQQ";
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    if (dmtxDecodeGetProp(dec, DmtxPropResultCacheSize) != 0 ||
+        dmtxDecodeSetProp(dec, DmtxPropResultCacheSize, -1) != DmtxFail ||
+        dmtxDecodeSetProp(dec, DmtxPropResultCacheSize, 4) != DmtxPass) {
+        FatalError(1, "resultCacheTest\n");
+    }
+
+    /* The cache survives dmtxDecodeSetImage(), so the second frame is a hit */
+    for (i = 0; i < 2; i++) {
+        dmtxDecodeSetImage(dec, enc->image);
+        reg = dmtxRegionFindNext(dec, NULL);
+        msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+        if (msg == NULL || strcmp((char *)msg->output, str) != 0 ||
+            memcmp(msg->code, enc->message->code, msg->codeSize) != 0) {
+            FatalError(2, "resultCacheTest\n");
+        }
+        dmtxMessageDestroy(&msg);
+        dmtxRegionDestroy(&reg);
+    }
+
+    if (dmtxDecodeGetProp(dec, DmtxPropResultCacheHits) != 1 ||
+        dmtxDecodeGetProp(dec, DmtxPropResultCacheMisses) != 1) {
+        FatalError(3, "resultCacheTest\n");
+    }
+
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * 与期望内容逐个模块比较，相同的符号不一致数为 0，内容不同时报告不一致的模块
+ */
+static void verifyTest(void)
+{
+    int i, count;
+    char *str = "30Q324343430794<OQQ";
+    char *other = "30Q324343430794<OQR";
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxVerifyResult result;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+
+    dec = dmtxDecodeCreate(enc->image, 1);
+    reg = dmtxRegionFindNext(dec, NULL);
+    if (reg == NULL || dmtxDecodeVerifyRegion(dec, reg, 0, &result) != DmtxFail) {
+        FatalError(1, "verifyTest\n");
+    }
+
+    dmtxDecodeSetExpected(dec, (int)strlen(str), (unsigned char *)str, DmtxSymbolSquareAuto, DmtxSchemeAscii);
+    if (dmtxDecodeVerifyRegion(dec, reg, 0, &result) != DmtxPass || result.mismatchCount != 0 ||
+        result.sizeIdx != reg->sizeIdx) {
+        FatalError(2, "verifyTest\n");
+    }
+    dmtxVerifyResultFree(&result);
+
+    /* Same size, different content: the full map marks every differing module */
+    dmtxDecodeSetExpected(dec, (int)strlen(other), (unsigned char *)other, DmtxSymbolSquareAuto, DmtxSchemeAscii);
+    if (dmtxDecodeVerifyRegion(dec, reg, INT_MAX, &result) != DmtxPass || result.mismatchCount <= 1) {
+        FatalError(3, "verifyTest\n");
+    }
+    for (i = count = 0; i < result.mapRows * result.mapCols; i++) {
+        count += result.map[i];
+    }
+    if (count != result.mismatchCount) {
+        FatalError(4, "verifyTest\n");
+    }
+    dmtxVerifyResultFree(&result);
+
+    /* The limit only decides the verdict; the count and map stay complete */
+    if (dmtxDecodeVerifyRegion(dec, reg, 0, &result) != DmtxFail || result.mismatchCount != count) {
+        FatalError(5, "verifyTest\n");
+    }
+    dmtxVerifyResultFree(&result);
+
+    /* A different symbol size never matches */
+    dmtxDecodeSetExpected(dec, 40, (unsigned char *)"0123456789012345678901234567890123456789",
+                          DmtxSymbolSquareAuto, DmtxSchemeAscii);
+    if (dmtxDecodeVerifyRegion(dec, reg, INT_MAX, &result) != DmtxFail || result.mismatchCount != DmtxUndefined) {
+        FatalError(6, "verifyTest\n");
+    }
+    dmtxVerifyResultFree(&result);
+
+    dmtxRegionDestroy(&reg);
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * 多组参数同时解码，只有能读出符号的变体胜出；全部失败时返回 DmtxFail
+ */
+static void variantsTest(void)
+{
+    int i, winner;
+    char *str = "30Q324343430794<OQQ";
+    DmtxEncode *enc;
+    DmtxDecode *dec[3], *dup[2];
+    DmtxDecodeResults results;
+
+    enc = dmtxEncodeCreate();
+    dmtxEncodeDataMatrix(enc, (int)strlen(str), (unsigned char *)str);
+
+    /* Only the variant expecting the right symbol size can succeed */
+    for (i = 0; i < 3; i++) {
+        dec[i] = dmtxDecodeCreate(enc->image, (i == 2) ? 2 : 1);
+        dmtxDecodeSetProp(dec[i], DmtxPropSymbolSize, (i == 1) ? DmtxSymbolSquareAuto : DmtxSymbol144x144);
+    }
+
+    if (dmtxDecodeVariants(enc->image, dec, 3, NULL, &results, &winner) != DmtxPass || winner != 1 ||
+        results.count != 1 || strcmp((char *)results.result[0].message->output, str) != 0) {
+        FatalError(1, "variantsTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    /* The cancelled variants are usable again on the next call */
+    dmtxDecodeSetProp(dec[1], DmtxPropSymbolSize, DmtxSymbol144x144);
+    dmtxDecodeSetProp(dec[2], DmtxPropSymbolSize, DmtxSymbolSquareAuto);
+    if (dmtxDecodeVariants(enc->image, dec, 3, NULL, &results, &winner) != DmtxPass || winner != 2 ||
+        results.count != 1) {
+        FatalError(2, "variantsTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    if (dmtxDecodeVariants(enc->image, dec, 2, NULL, &results, &winner) != DmtxFail || winner != DmtxUndefined ||
+        results.count != 0) {
+        FatalError(3, "variantsTest\n");
+    }
+
+    /* The same decoder listed twice is rejected before any thread starts */
+    dup[0] = dup[1] = dec[2];
+    if (dmtxDecodeVariants(enc->image, dup, 2, NULL, &results, &winner) != DmtxFail || winner != DmtxUndefined ||
+        results.count != 0) {
+        FatalError(4, "variantsTest\n");
+    }
+
+    for (i = 0; i < 3; i++) {
+        dmtxDecodeDestroy(&dec[i]);
+    }
+    dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * 寻找与解码流水线的结果与 dmtxDecodeAll() 相同，次序也相同
+ */
+static void pipelineTest(void)
+{
+    int i, row, width, height, symWidth, symHeight, count;
+    char *str[] = {"one", "two", "three", "four", "five", "six"};
+    unsigned char pxl[6 * 80 * 80];
+    DmtxEncode *enc;
+    DmtxImage *img;
+    DmtxDecode *dec;
+    DmtxDecodeAllOpts opts;
+    DmtxDecodeResults expected, results;
+
+    /* Six symbols in two rows on a white 240x160 frame */
+    width = 3 * 80;
+    height = 2 * 80;
+    memset(pxl, 0xff, sizeof(pxl));
+    for (i = 0; i < 6; i++) {
+        enc = dmtxEncodeCreate();
+        dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+        dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+        dmtxEncodeDataMatrix(enc, (int)strlen(str[i]), (unsigned char *)str[i]);
+        symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+        symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+        for (row = 0; row < symHeight; row++) {
+            memcpy(pxl + ((i / 3) * 80 + row) * width + (i % 3) * 80, enc->image->pxl + row * symWidth, symWidth);
+        }
+        dmtxEncodeDestroy(&enc);
+    }
+
+    img = dmtxImageCreate(pxl, width, height, DmtxPack8bppK);
+    dec = dmtxDecodeCreate(img, 1);
+    if (dmtxDecodeAll(dec, NULL, &expected) != DmtxPass || expected.count != 6) {
+        FatalError(1, "pipelineTest\n");
+    }
+
+    count = 0;
+    dmtxDecodeSetOutputSink(dec, outputSinkCount, &count);
+    dmtxDecodeSetImage(dec, img);
+    if (dmtxDecodePipeline(dec, 3, NULL, &results) != DmtxPass || results.count != expected.count) {
+        FatalError(2, "pipelineTest\n");
+    }
+    for (i = 0; i < results.count; i++) {
+        if (strcmp((char *)results.result[i].message->output, (char *)expected.result[i].message->output) != 0) {
+            FatalError(3, "pipelineTest\n");
+        }
+        count -= results.result[i].message->outputIdx;
+    }
+    if (count != 0) {
+        FatalError(4, "pipelineTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+    dmtxDecodeSetOutputSink(dec, NULL, NULL);
+
+    /* Results stop at maxCount in detection order even if later regions finished first */
+    opts.maxCount = 2;
+    opts.expectedCount = DmtxUndefined;
+    opts.fix = DmtxUndefined;
+    dmtxDecodeSetImage(dec, img);
+    if (dmtxDecodePipeline(dec, 4, &opts, &results) != DmtxPass || results.count != 2 ||
+        strcmp((char *)results.result[1].message->output, (char *)expected.result[1].message->output) != 0) {
+        FatalError(5, "pipelineTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    opts.maxCount = DmtxUndefined;
+    opts.expectedCount = 7;
+    dmtxDecodeSetImage(dec, img);
+    if (dmtxDecodePipeline(dec, 1, &opts, &results) != DmtxFail || results.count != 6) {
+        FatalError(6, "pipelineTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    dmtxDecodeResultsFree(&expected);
+    dmtxDecodeDestroy(&dec);
+    dmtxImageDestroy(&img);
+}
+
+/**
+ * Cancelling the caller's decoder stops a region decode that a pipeline worker has already started
+ */
+static void pipelineCancelTest(void)
+{
+#if !defined(_WIN32) && !defined(DMTX_NO_THREADS)
+    int i, x, y, width, height, side;
+    long findUsec, pipelineUsec, cancelUsec;
+    unsigned int seed;
+    unsigned char str[1500];
+    unsigned char *pxl;
+    DmtxTime start, end;
+    DmtxEncode *enc;
+    DmtxDecode *dec;
+    DmtxRegion *reg;
+    DmtxMessage *msg;
+    DmtxDecodeResults results;
+    pthread_t thread;
+    CancelAfter cancel;
+
+    /* A 144x144 symbol with 30% of its inner modules flipped: detected, but every retry fails */
+    for (i = 0; i < (int)sizeof(str); i++) {
+        str[i] = (unsigned char)('0' + i % 10);
+    }
+    enc = dmtxEncodeCreate();
+    dmtxEncodeSetProp(enc, DmtxPropPixelPacking, DmtxPack8bppK);
+    dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+    dmtxEncodeSetProp(enc, DmtxPropSizeRequest, DmtxSymbol144x144);
+    dmtxEncodeDataMatrix(enc, (int)sizeof(str), str);
+    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    pxl = enc->image->pxl;
+    seed = 1;
+    for (y = 80; y + 4 <= height - 80; y += 4) {
+        for (x = 80; x + 4 <= width - 80; x += 4) {
+            seed = seed * 1103515245u + 12345u;
+            if (((seed >> 16) & 0x7fff) % 10 < 3) {
+                for (side = 0; side < 4; side++) {
+                    memset(pxl + (y + side) * width + x, (seed & 0x100) ? 0 : 255, 4);
+                }
+            }
+        }
+    }
+
+    /* Time the search on this thread, and check the symbol is found but never decodes */
+    dec = dmtxDecodeCreate(enc->image, 1);
+    start = dmtxTimeNow();
+    reg = dmtxRegionFindNext(dec, NULL);
+    findUsec = usecBetween(start, dmtxTimeNow());
+    msg = (reg != NULL) ? dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined) : NULL;
+    if (reg == NULL || msg != NULL) {
+        FatalError(1, "pipelineCancelTest\n");
+    }
+    dmtxRegionDestroy(&reg);
+
+    /* An uncancelled pipeline runs the whole retry ladder, competing with the caller's search */
+    dmtxDecodeSetImage(dec, enc->image);
+    start = dmtxTimeNow();
+    dmtxDecodePipeline(dec, 1, NULL, &results);
+    pipelineUsec = usecBetween(start, dmtxTimeNow());
+    if (results.count != 0 || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxFalse) {
+        FatalError(2, "pipelineCancelTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    /* Cancel early in the worker's decode; it must give up well before the ladder would end */
+    cancel.dec = dec;
+    cancel.usec = findUsec + (pipelineUsec - findUsec) / 8;
+    dmtxDecodeSetImage(dec, enc->image);
+    if (pthread_create(&thread, NULL, cancelAfter, &cancel) != 0) {
+        FatalError(3, "pipelineCancelTest\n");
+    }
+    dmtxDecodePipeline(dec, 1, NULL, &results);
+    end = dmtxTimeNow();
+    pthread_join(thread, NULL);
+    cancelUsec = usecBetween(cancel.cancelled, end);
+    if (results.count != 0 || dmtxDecodeGetProp(dec, DmtxPropDeadlineExpired) != DmtxTrue ||
+        cancelUsec > (pipelineUsec - findUsec) / 6) {
+        FatalError(4, "pipelineCancelTest\n");
+    }
+    dmtxDecodeResultsFree(&results);
+
+    dmtxDecodeDestroy(&dec);
+    dmtxEncodeDestroy(&enc);
+#endif
+}
+
+/**
+ * 累计回调收到的字节数
+ */
+static void outputSinkCount(void *userData, const unsigned char *data, size_t length)
+{
+    (void)data;
+
+    *(int *)userData += (int)length;
+}
+
+#if !defined(_WIN32) && !defined(DMTX_NO_THREADS)
+/**
+ * 从 start 到 end 的微秒数
+ */
+static long usecBetween(DmtxTime start, DmtxTime end)
+{
+    return (long)(end.sec - start.sec) * 1000000L + (long)end.usec - (long)start.usec;
+}
+
+/**
+ * 等待 usec 微秒后从另一个线程取消解码器，并记下实际取消的时刻
+ */
+static void *cancelAfter(void *arg)
+{
+    CancelAfter *cancel = (CancelAfter *)arg;
+    struct timespec delay;
+
+    delay.tv_sec = cancel->usec / 1000000L;
+    delay.tv_nsec = (cancel->usec % 1000000L) * 1000L;
+    nanosleep(&delay, NULL);
+    cancel->cancelled = dmtxTimeNow();
+    dmtxDecodeCancel(cancel->dec);
+
+    return NULL;
+}
+#endif
+
 /**
  *
  *